@@ -1,17 +1,25 @@
 #include "App.h"
 #include "Logger.h"
+#include "Hash.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
 
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
+#include <chrono>
 #include <climits>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <sstream>
+#include <unordered_map>
 using namespace std;
 
 static_assert(CHAR_BIT == 8 && sizeof(int) == 4, "char must be 8 bits, int must be 4 bytes!");
@@ -22,8 +30,19 @@ constexpr glm::mat4 convertMatrix(const aiMatrix4x4& aiMat) noexcept {
             aiMat.a3, aiMat.b3, aiMat.c3, aiMat.d3, aiMat.a4, aiMat.b4, aiMat.c4, aiMat.d4};
 }
 
-void processMesh(aiMesh* aiMesh, const aiScene* scene, std::string_view basePath, std::vector<sge::Mesh>& meshes,
-                 glm::mat4 posMat) {
+// Node transform followed by the per-mesh normalization to a 10 units box
+glm::mat4 instanceMatrix(const aiMesh* aiMesh, glm::mat4 posMat) {
+    const glm::vec3 bbMin = {aiMesh->mAABB.mMin.x, aiMesh->mAABB.mMin.y, aiMesh->mAABB.mMin.z};
+    const glm::vec3 bbMax = {aiMesh->mAABB.mMax.x, aiMesh->mAABB.mMax.y, aiMesh->mAABB.mMax.z};
+    glm::vec3 result_min = posMat * glm::vec4(bbMin, 1.f);
+    glm::vec3 result_max = posMat * glm::vec4(bbMax, 1.f);
+    glm::vec3 v = glm::abs(result_max - result_min);
+    const auto max = std::max(std::max(v.x, v.y), v.z);
+    const float d = 1.f / (max / 10.f);
+    return glm::scale(posMat, glm::vec3(d));
+}
+
+void processMesh(aiMesh* aiMesh, const aiScene* scene, std::string_view basePath, std::vector<sge::Mesh>& meshes) {
     sge::Mesh mesh;
     mesh.m_pos.resize(aiMesh->mNumVertices);
 
@@ -35,6 +54,8 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, std::string_view basePath
         mesh.m_pos[i].m_normal = {aiMesh->mNormals[i].x, aiMesh->mNormals[i].y, aiMesh->mNormals[i].z};
         if (aiMesh->mTextureCoords[0] != nullptr) {
             mesh.m_pos[i].m_UV = {aiMesh->mTextureCoords[0][i].x, aiMesh->mTextureCoords[0][i].y};
+        } else {
+            mesh.m_pos[i].m_UV = {0.f, 0.f};
         }
     }
     for (unsigned int i = 0; i < aiMesh->mNumFaces; ++i) {
@@ -64,12 +85,10 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, std::string_view basePath
 
     aiString str1;
     ai_material->GetTexture(aiTextureType_LIGHTMAP, 0, &str1);
-    static size_t meshID = 0;
     const std::filesystem::path unicodePath = basePath;
     std::string parentPath = reinterpret_cast<const char*>(unicodePath.parent_path().u8string().c_str());
     parentPath = parentPath + "/";
-    mesh.setName(std::to_string(meshID) + " | " + std::string(basePath));
-    ++meshID;
+    mesh.setName(basePath);
 
     if (mesh.m_material.m_hasColorMap) {
         aiString str;
@@ -106,45 +125,156 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, std::string_view basePath
 
     mesh.m_boundingBox.min = {aiMesh->mAABB.mMin.x, aiMesh->mAABB.mMin.y, aiMesh->mAABB.mMin.z};
     mesh.m_boundingBox.max = {aiMesh->mAABB.mMax.x, aiMesh->mAABB.mMax.y, aiMesh->mAABB.mMax.z};
-
-    glm::vec3 result_min = posMat * glm::vec4(mesh.m_boundingBox.min, 1.f);
-    glm::vec3 result_max = posMat * glm::vec4(mesh.m_boundingBox.max, 1.f);
-    glm::vec3 v = glm::abs(result_max - result_min);
-    const auto max = std::max(std::max(v.x, v.y), v.z);
-    const float d = 1.f / (max / 10.f);
-    posMat = glm::scale(posMat, glm::vec3(d));
-    mesh.setModelMatrix(std::move(posMat));
     meshes.push_back(std::move(mesh));
 }
 
+// Every aiMesh becomes one sge::Mesh, nodes referencing it again only add an instance
 void processNode(aiNode* node, const aiScene* scene, const std::string_view basePath, std::vector<sge::Mesh>& meshes,
-                 glm::mat4 const& parentMat = glm::mat4(1.0f)) {
+                 std::unordered_map<unsigned int, size_t>& meshIndices, glm::mat4 const& parentMat = glm::mat4(1.0f)) {
+    const glm::mat4 nodeMat = parentMat * convertMatrix(node->mTransformation);
     for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
         aiMesh* aiMesh = scene->mMeshes[node->mMeshes[i]];
-        processMesh(aiMesh, scene, basePath, meshes, parentMat * convertMatrix(node->mTransformation));
+        const auto [it, isNewMesh] = meshIndices.try_emplace(node->mMeshes[i], meshes.size());
+        if (isNewMesh) processMesh(aiMesh, scene, basePath, meshes);
+        meshes[it->second].m_instances.emplace_back(instanceMatrix(aiMesh, nodeMat));
     }
     for (unsigned int i = 0; i < node->mNumChildren; ++i)
-        processNode(node->mChildren[i], scene, basePath, meshes, parentMat * convertMatrix(node->mTransformation));
+        processNode(node->mChildren[i], scene, basePath, meshes, meshIndices, nodeMat);
 }
 
-void load_model(sge::App& app, const std::string_view path, const glm::mat4 rootMatrix = glm::mat4{1.f}) {
-    Assimp::Importer importer;
+// Also called for cached meshes, the statistics of their import come from the mesh cache
+void report_optimization(const std::string_view path, const std::vector<sge::Mesh>& meshes,
+                         const std::vector<sge::MeshOptimizer::Statistics>& statistics) {
+    for (size_t i = 0; i < meshes.size() && i < statistics.size(); ++i) {
+        const auto& stats = statistics[i];
+        LOG_MSG("Mesh optimization: " << path << " #" << i << ": vertices " << stats.verticesBefore << " -> "
+                                      << stats.verticesAfter << ", ACMR " << stats.acmrBefore << " -> "
+                                      << stats.acmrAfter << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter
+                                      << ", overdraw " << stats.overdrawBefore << " -> " << stats.overdrawAfter)
+        std::stringstream lods;
+        for (const auto& lod : meshes[i].m_lods) lods << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+        LOG_MSG("Mesh LODs: " << path << " #" << i << ": triangles (error)" << lods.str())
+    }
+}
+
+std::vector<sge::MeshOptimizer::Statistics> optimize_meshes(std::vector<sge::Mesh>& meshes) {
+    std::vector<sge::MeshOptimizer::Statistics> statistics;
+    statistics.reserve(meshes.size());
+    for (auto& mesh : meshes) {
+        statistics.push_back(sge::MeshOptimizer::optimize(mesh));
+        sge::MeshOptimizer::generateLods(mesh);
+    }
+    return statistics;
+}
+
+void quantize_meshes(const std::string_view path, std::vector<sge::Mesh>& meshes) {
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const auto error = sge::MeshOptimizer::quantizeVertices(meshes[i]);
+        LOG_MSG("Vertex quantization: " << path << " #" << i << ": max position error " << error.maxPositionError
+                                        << " (" << error.maxPositionErrorRelative * 100.f
+                                        << "% of bounds), max normal error " << error.maxNormalErrorDegrees
+                                        << " deg, max UV error " << error.maxUVError)
+    }
+}
+
+struct ImportSettings {
+    bool quantizeVertices = false;
+};
+
+// Remembers every file the importer opened, the mesh cache has to notice edits of external buffers too
+class RecordingIOSystem : public Assimp::DefaultIOSystem {
+ public:
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override {
+        auto* stream = Assimp::DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr) openedFiles.emplace_back(file);
+        return stream;
+    }
+
+    std::vector<std::string> openedFiles;
+};
+
+// Files besides the model itself, an entry per file
+std::vector<std::string> get_import_dependencies(const std::filesystem::path& modelPath,
+                                                 const std::vector<std::string>& openedFiles) {
+    std::vector<std::string> dependencies;
+    for (const auto& file : openedFiles) {
+        std::error_code ec;
+        if (std::filesystem::equivalent(modelPath, file, ec) ||
+            std::find(dependencies.begin(), dependencies.end(), file) != dependencies.end())
+            continue;
+        dependencies.push_back(file);
+    }
+    return dependencies;
+}
+
+struct ImportResult {
+    std::vector<sge::Mesh> meshes;
+    std::chrono::duration<double, std::milli> importTime{};
+    bool isValid = false;
+    bool isFromCache = false;
+};
+
+ImportResult import_model(const std::string_view path, const ImportSettings& settings,
+                          const glm::mat4 rootMatrix = glm::mat4{1.f}) {
+    const auto start = std::chrono::steady_clock::now();
+    ImportResult result;
     unsigned int flags = aiProcess_FlipUVs | aiProcess_Triangulate | aiProcess_GenBoundingBoxes |
                          aiProcess_GenUVCoords | aiProcess_GenSmoothNormals;
     const std::filesystem::path unicodePath = path;
-    
+
+    const sge::MeshCache meshCache(unicodePath, flags, sge::hashValue(rootMatrix));
+    std::vector<sge::MeshOptimizer::Statistics> statistics;
+    if (auto cachedMeshes = meshCache.load(&statistics)) {
+        result.meshes = std::move(*cachedMeshes);
+        report_optimization(path, result.meshes, statistics);
+        if (settings.quantizeVertices) quantize_meshes(path, result.meshes);
+        result.importTime = std::chrono::steady_clock::now() - start;
+        result.isValid = true;
+        result.isFromCache = true;
+        return result;
+    }
+
+    Assimp::Importer importer;
+    // Owned and destroyed by the importer
+    auto* ioSystem = new RecordingIOSystem;
+    importer.SetIOHandler(ioSystem);
     auto scene = importer.ReadFile(reinterpret_cast<const char*>(unicodePath.u8string().c_str()), flags);
     if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || scene->mRootNode == nullptr) {
         LOG_ERROR("CLIENT: Can't open file:" << path);
-        app.loadModels(std::vector<sge::Mesh>());
-        return;
+        result.importTime = std::chrono::steady_clock::now() - start;
+        return result;
     }
 
-    std::vector<sge::Mesh> meshes;
     auto& m = rootMatrix;
 
-    processNode(scene->mRootNode, scene, path, meshes, m);
-    app.loadModels(std::move(meshes));
+    std::unordered_map<unsigned int, size_t> meshIndices;
+    processNode(scene->mRootNode, scene, path, result.meshes, meshIndices, m);
+    statistics = optimize_meshes(result.meshes);
+    report_optimization(path, result.meshes, statistics);
+    if (!meshCache.store(result.meshes, statistics, get_import_dependencies(unicodePath, ioSystem->openedFiles)))
+        LOG_MSG("Mesh cache: can't bake " << path)
+    if (settings.quantizeVertices) quantize_meshes(path, result.meshes);
+    result.importTime = std::chrono::steady_clock::now() - start;
+    result.isValid = true;
+    return result;
+}
+
+// Runs on the App streaming workers, one call per model file. The App publishes and numbers the meshes in
+// command-line order
+sge::App::ModelLoader make_model_loader(const ImportSettings settings) {
+    return [settings](const std::string& path) {
+        auto result = import_model(path, settings);
+        if (result.isValid) {
+            size_t instanceCount = 0;
+            for (const auto& mesh : result.meshes) instanceCount += mesh.getInstanceCount();
+            LOG_MSG("Loading model: " << path << " Complete! (" << result.meshes.size() << " meshes, "
+                                      << instanceCount << " instances, " << result.importTime.count() << " ms"
+                                      << (result.isFromCache ? ", cached" : "") << ")")
+        } else {
+            LOG_MSG("Loading model: " << path << " Failed! (" << result.importTime.count() << " ms)")
+        }
+        return std::move(result.meshes);
+    };
 }
 
 int main(int argc, char* argv[]) {
@@ -164,11 +294,32 @@ int main(int argc, char* argv[]) {
 
         sge::App my_app({1280, 720}, "Vulkan engine");
 
-        for (auto i = 1; i < argc; ++i) { 
-            LOG_MSG("Loading model: " << argv[i])
-            load_model(my_app, argv[i]); 
-            LOG_MSG("Loading model: " << argv[i] << " Complete!")
+        ImportSettings settings;
+        std::vector<std::string> paths;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--quantize") {
+                settings.quantizeVertices = true;
+            } else if (arg == "--material-mode" && i + 1 < argc) {
+                const std::string_view mode = argv[++i];
+                if (mode == "defines")
+                    my_app.setMaterialMode(sge::App::MaterialMode::Defines);
+                else if (mode == "specialization")
+                    my_app.setMaterialMode(sge::App::MaterialMode::Specialization);
+                else if (mode == "dynamic")
+                    my_app.setMaterialMode(sge::App::MaterialMode::Dynamic);
+                else if (mode == "bindless")
+                    my_app.setMaterialMode(sge::App::MaterialMode::Bindless);
+                else
+                    LOG_ERROR("Unknown material mode " << mode
+                                                       << ", expected defines, specialization, dynamic or bindless")
+            } else {
+                paths.emplace_back(argv[i]);
+            }
         }
+        // The window comes up right away, models show up as they finish streaming in
+        my_app.setModelLoader(make_model_loader(settings));
+        for (auto& path : paths) my_app.loadModelAsync(std::move(path));
 
         my_app.run();
     }
@@ -0,0 +1,111 @@
+#include "Logger.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+#include <assimp/Importer.hpp>
+
+#include <assimp/scene.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+using TextureSet = std::set<std::pair<std::string, sge::Texture::Role>>;
+
+// Same material slots and path resolution as processMesh in the Editor, so the bakes hash the files the app loads
+bool collectTextures(const std::string_view modelPath, TextureSet& textures) {
+    const std::filesystem::path unicodePath = modelPath;
+    Assimp::Importer importer;
+    const auto scene = importer.ReadFile(reinterpret_cast<const char*>(unicodePath.u8string().c_str()), 0);
+    if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
+        LOG_ERROR("Can't open model: " << modelPath)
+        return false;
+    }
+    std::string parentPath = reinterpret_cast<const char*>(unicodePath.parent_path().u8string().c_str());
+    parentPath = parentPath + "/";
+
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+        const aiMaterial* material = scene->mMaterials[scene->mMeshes[i]->mMaterialIndex];
+        const auto addTexture = [&](aiTextureType type, sge::Texture::Role role) {
+            aiString str;
+            if (material->GetTextureCount(type) == 0 || material->GetTexture(type, 0, &str) != aiReturn_SUCCESS ||
+                str.length == 0)
+                return false;
+            // "*N" names an embedded texture, the app can't load those from a path either
+            if (str.C_Str()[0] != '*') textures.emplace(parentPath + str.C_Str(), role);
+            return true;
+        };
+        if (!addTexture(aiTextureType_BASE_COLOR, sge::Texture::Role::Color))
+            addTexture(aiTextureType_DIFFUSE, sge::Texture::Role::Color);
+        addTexture(aiTextureType_UNKNOWN, sge::Texture::Role::Data);
+        addTexture(aiTextureType_EMISSIVE, sge::Texture::Role::Color);
+        addTexture(aiTextureType_NORMALS, sge::Texture::Role::Normal);
+    }
+    return true;
+}
+
+void printUsage() {
+    LOG_MSG("Usage: sge_texbake [--cache <directory>] [--force] <model>...\n"
+            "Bakes the textures of the models into the cache the app reads, \"cache/textures\" by default.\n"
+            "Run it from the directory the app is started in.")
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path cacheDirectory = "cache/textures";
+    bool force = false;
+    std::vector<std::string> models;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--cache" && i + 1 < argc)
+            cacheDirectory = argv[++i];
+        else if (arg == "--force")
+            force = true;
+        else
+            models.emplace_back(arg);
+    }
+    if (models.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    TextureSet textures;
+    bool succeeded = true;
+    for (const auto& model : models) succeeded = collectTextures(model, textures) && succeeded;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> bakedCount = 0;
+    std::atomic<size_t> upToDateCount = 0;
+    std::vector<std::future<bool>> bakes;
+    bakes.reserve(textures.size());
+    for (const auto& [path, role] : textures) {
+        bakes.push_back(sge::ThreadPool::Instance().submit([&, path = path, role = role]() {
+            const sge::TextureCache cache(path, role, cacheDirectory);
+            if (!cache.isValid()) {
+                LOG_ERROR("Can't read texture: " << path)
+                return false;
+            }
+            if (!force && cache.isBaked()) {
+                ++upToDateCount;
+                return true;
+            }
+            if (!cache.bake()) return false;
+            LOG_MSG("Baked " << path << " -> " << cache.getCachePath().string())
+            ++bakedCount;
+            return true;
+        }));
+    }
+    for (auto& bake : bakes) succeeded = bake.get() && succeeded;
+
+    const std::chrono::duration<double, std::milli> bakeTime = std::chrono::steady_clock::now() - start;
+    LOG_MSG("Texture bake: " << textures.size() << " textures, " << bakedCount << " baked, " << upToDateCount
+                             << " up to date, " << bakeTime.count() << " ms")
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+# cmake -DMANIFEST=<manifest.txt> -DOUTPUT=<EmbeddedShaderTable.cpp> -P EmbedShaders.cmake
+# Writes the SPIR-V listed in the manifest (one "<spv>|<source>|<defines>" line per permutation) as the table behind
+# getEmbeddedShaders(). Defines are spelled the way Shader receives them: one "#define X\n" line each.
+cmake_minimum_required(VERSION 3.12)
+
+# 16 bytes per line
+set(linePattern "")
+foreach(i RANGE 1 16)
+	string(APPEND linePattern "0x[0-9a-f][0-9a-f],")
+endforeach()
+
+file(STRINGS ${MANIFEST} entries)
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(entry IN LISTS entries)
+	string(REPLACE "|" ";" fields "${entry}")
+	list(GET fields 0 spirvPath)
+	list(GET fields 1 source)
+	list(LENGTH fields fieldCount)
+	set(defines "")
+	if(fieldCount GREATER 2)
+		list(GET fields 2 defineList)
+		string(REPLACE " " ";" defineList "${defineList}")
+		foreach(define IN LISTS defineList)
+			string(APPEND defines "#define ${define}\\n")
+		endforeach()
+	endif()
+
+	file(READ ${spirvPath} spirv HEX)
+	string(LENGTH "${spirv}" hexLength)
+	math(EXPR remainder "${hexLength} % 8")
+	if(hexLength EQUAL 0 OR NOT remainder EQUAL 0)
+		message(FATAL_ERROR "${spirvPath} isn't a SPIR-V module")
+	endif()
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," spirv "${spirv}")
+	string(REGEX REPLACE "(${linePattern})" "\\1\n    " spirv "${spirv}")
+	string(STRIP "${spirv}" spirv)
+	string(APPEND arrays "alignas(4) constexpr unsigned char SHADER_${index}[] = {\n    ${spirv}\n};\n")
+	string(APPEND table "    {\"${source}\", \"${defines}\", SHADER_${index}},\n")
+	math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp "// Generated by EmbedShaders.cmake, do not edit
+#include \"EmbeddedShaders.h\"
+
+namespace sge {
+namespace {
+${arrays}
+constexpr EmbeddedShader EMBEDDED_SHADERS[] = {
+${table}};
+}  // namespace
+
+std::span<const EmbeddedShader> getEmbeddedShaders() noexcept { return EMBEDDED_SHADERS; }
+}  // namespace sge
+")
+file(RENAME ${OUTPUT}.tmp ${OUTPUT})
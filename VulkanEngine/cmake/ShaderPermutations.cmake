@@ -0,0 +1,110 @@
+# Compiles every shader permutation the engine can request at build time and embeds the SPIR-V in a generated table,
+# Shader looks permutations up there instead of running shaderc. Keep the define names and their order in sync with
+# App::loadModels / App::getMeshPipeline: the table is keyed by the exact define string the app builds.
+
+find_program(SGE_GLSLC glslc HINTS ${CONAN_BIN_DIRS_SHADERC})
+if(NOT SGE_GLSLC)
+	message(FATAL_ERROR "glslc is required to embed the shaders")
+endif()
+find_program(SGE_SPIRV_OPT spirv-opt HINTS ${CONAN_BIN_DIRS_SPIRV-TOOLS})
+if(NOT SGE_SPIRV_OPT)
+	message(WARNING "spirv-opt not found, embedded shaders are only optimized by glslc")
+endif()
+
+set(SGE_SHADER_SOURCE_DIR ${PROJECT_SOURCE_DIR})
+set(SGE_SHADER_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/shaders)
+set(SGE_SHADER_MANIFEST ${SGE_SHADER_OUTPUT_DIR}/manifest.txt)
+set(SGE_EMBEDDED_SHADER_TABLE ${SGE_SHADER_OUTPUT_DIR}/EmbeddedShaderTable.cpp)
+# Includes aren't tracked per permutation, any shader file change rebuilds the ones that read it through this
+file(GLOB_RECURSE SGE_SHADER_DEPENDENCIES CONFIGURE_DEPENDS
+	${SGE_SHADER_SOURCE_DIR}/data/Shaders/GLSL/*.vert
+	${SGE_SHADER_SOURCE_DIR}/data/Shaders/GLSL/*.frag
+	${SGE_SHADER_SOURCE_DIR}/data/Shaders/GLSL/*.geom
+	${SGE_SHADER_SOURCE_DIR}/data/Shaders/GLSL/*.glsl
+)
+set(SGE_SHADER_OUTPUTS)
+file(WRITE ${SGE_SHADER_MANIFEST}.in "")
+
+# sge_add_shader_permutation(<source relative to the data root> [defines...])
+function(sge_add_shader_permutation source)
+	set(defineFlags)
+	foreach(define IN LISTS ARGN)
+		list(APPEND defineFlags -D${define})
+	endforeach()
+	string(MAKE_C_IDENTIFIER "${source}" name)
+	string(MD5 definesHash "${ARGN}")
+	string(SUBSTRING ${definesHash} 0 12 definesHash)
+	set(output ${SGE_SHADER_OUTPUT_DIR}/${name}_${definesHash}.spv)
+
+	if(SGE_SPIRV_OPT)
+		set(optimizeCommand COMMAND ${SGE_SPIRV_OPT} -O ${output}.unoptimized -o ${output})
+	else()
+		set(optimizeCommand COMMAND ${CMAKE_COMMAND} -E copy ${output}.unoptimized ${output})
+	endif()
+	# Same target and warnings as the runtime compiler in Shader.cpp, without debug info
+	add_custom_command(OUTPUT ${output}
+		COMMAND ${SGE_GLSLC} --target-env=vulkan1.2 --target-spv=spv1.5 -Werror -O ${defineFlags}
+			${SGE_SHADER_SOURCE_DIR}/${source} -o ${output}.unoptimized
+		${optimizeCommand}
+		DEPENDS ${SGE_SHADER_DEPENDENCIES}
+		COMMENT "Compiling shader permutation ${source} ${ARGN}"
+		VERBATIM
+	)
+	string(REPLACE ";" " " defineList "${ARGN}")
+	file(APPEND ${SGE_SHADER_MANIFEST}.in "${output}|${source}|${defineList}\n")
+	set(SGE_SHADER_OUTPUTS ${SGE_SHADER_OUTPUTS} ${output} PARENT_SCOPE)
+endfunction()
+
+# Fixed pipelines
+foreach(source
+		Phong/phong.vert Phong/phong.frag
+		Negative/Negative.vert Negative/Negative.frag
+		Fullscreen/Fullscreen.vert Fullscreen/Fullscreen.frag
+		Normal/normal.vert Normal/normal.frag Normal/normal.geom
+		Skybox/skybox.vert Skybox/skybox.frag)
+	sge_add_shader_permutation(data/Shaders/GLSL/${source})
+endforeach()
+
+# Mesh pipelines, one vertex shader per vertex format (the default Phong one is above)
+sge_add_shader_permutation(data/Shaders/GLSL/Phong/phong.vert QUANTIZED_VERTEX)
+sge_add_shader_permutation(data/Shaders/GLSL/PBR/PBR.vert)
+sge_add_shader_permutation(data/Shaders/GLSL/PBR/PBR.vert QUANTIZED_VERTEX)
+
+# and one fragment shader per combination of material maps
+set(SGE_MATERIAL_MAP_DEFINES HAS_COLOR_MAP HAS_METALLIC_ROUGHNESS_MAP HAS_NORMAL_MAP HAS_EMISSIVE_MAP HAS_OCCLUSION_MAP)
+list(LENGTH SGE_MATERIAL_MAP_DEFINES mapCount)
+math(EXPR lastMask "(1 << ${mapCount}) - 1")
+foreach(mask RANGE ${lastMask})
+	set(defines)
+	set(bit 0)
+	foreach(define IN LISTS SGE_MATERIAL_MAP_DEFINES)
+		math(EXPR isSet "(${mask} >> ${bit}) & 1")
+		if(isSet)
+			list(APPEND defines ${define})
+		endif()
+		math(EXPR bit "${bit} + 1")
+	endforeach()
+	sge_add_shader_permutation(data/Shaders/GLSL/Phong/phong.frag ${defines} Phong)
+	# PBR reads occlusion from the metallic-roughness map, it doesn't compile without one
+	if(NOT "HAS_OCCLUSION_MAP" IN_LIST defines OR "HAS_METALLIC_ROUGHNESS_MAP" IN_LIST defines)
+		sge_add_shader_permutation(data/Shaders/GLSL/PBR/PBR.frag ${defines} PBR)
+	endif()
+endforeach()
+
+# The other material modes select the maps' code later, one fragment shader per material type
+foreach(mode BINDLESS MATERIAL_SPECIALIZATION MATERIAL_DYNAMIC)
+	sge_add_shader_permutation(data/Shaders/GLSL/Phong/phong.frag ${mode} Phong)
+	sge_add_shader_permutation(data/Shaders/GLSL/PBR/PBR.frag ${mode} PBR)
+endforeach()
+
+# Only touched when the permutation list changes, so reconfiguring doesn't regenerate the table
+configure_file(${SGE_SHADER_MANIFEST}.in ${SGE_SHADER_MANIFEST} COPYONLY)
+
+add_custom_command(OUTPUT ${SGE_EMBEDDED_SHADER_TABLE}
+	COMMAND ${CMAKE_COMMAND} -DMANIFEST=${SGE_SHADER_MANIFEST} -DOUTPUT=${SGE_EMBEDDED_SHADER_TABLE}
+		-P ${CMAKE_CURRENT_LIST_DIR}/EmbedShaders.cmake
+	DEPENDS ${SGE_SHADER_OUTPUTS} ${SGE_SHADER_MANIFEST} ${CMAKE_CURRENT_LIST_DIR}/EmbedShaders.cmake
+	COMMENT "Generating embedded shader table"
+	VERBATIM
+)
+add_custom_target(sge_shaders DEPENDS ${SGE_EMBEDDED_SHADER_TABLE})
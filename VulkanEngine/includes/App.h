@@ -3,12 +3,26 @@
 #include "Descriptors.h"
 #include "Device.h"
 #include "Event.h"
+#include "MeshMGR.h"
 #include "Model.h"
+#include "ObjectBuffer.h"
 #include "Pipeline.h"
 #include "Renderer.h"
+#include "Texture.h"
+#include "UploadContext.h"
 #include "Window.h"
 
+#include <array>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace sge {
 struct GlobalUbo {
@@ -26,33 +40,106 @@ struct NormalTestInfo {
     float magnitude = 1.f;
 };
 
-struct PBRUbo {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat3 normalMatrix{1.f};
-    glm::vec4 baseColor{1.f};
-    glm::vec4 lightDirection{0.f};  // alignas(16)
-    float metallic = 0.f;
-    float roughness = 0.f;
+struct MeshPushConstants {
+    glm::vec4 positionScale{1.f};
+    glm::vec4 positionOffset{0.f};
+    //! Blended over the shaded color when alpha > 0
+    glm::vec4 lodDebugColor{0.f};
+    uint32_t objectIndex = 0;
 };
 
 class App {
  public:
+    //! How mesh shaders pick the code for the maps a material has:
+    //! Defines - a compiled permutation and a pipeline per combination of maps
+    //! Specialization - one compile per material type, a pipeline per combination specialized from it
+    //! Dynamic - one pipeline per material type, branching on ObjectData::materialFlags
+    //! Bindless - one pipeline per material type, the maps come from BindlessTextures
+    enum class MaterialMode { Defines, Specialization, Dynamic, Bindless };
+
     App(glm::ivec2 windowSize, std::string windowName);
     ~App();
     App(const App&) = delete;
     App& operator=(const App&) = delete;
 
+    //! Imports a model file into meshes, called on worker threads
+    using ModelLoader = std::function<std::vector<Mesh>(const std::string& path)>;
+
     void run();
     void loadModels(std::vector<Mesh>&& meshes);
+    void setModelLoader(ModelLoader loader) noexcept;
+    //! Applies to the models loaded afterwards. Bindless falls back to Defines without descriptor indexing,
+    //! it is the default otherwise
+    void setMaterialMode(MaterialMode mode) noexcept;
+    //! Imports and uploads the file in the background, the meshes appear at a later frame boundary. Models are
+    //! published in the order they were queued and their meshes are numbered in that order
+    void loadModelAsync(std::string path);
+
  private:
+    //! Mesh pipelines of a batch built ahead of loadModels, with what compiling their shaders cost
+    struct MeshPipelines {
+        MaterialMode mode = MaterialMode::Defines;
+        std::vector<PipelineInfo> pipelines;
+        size_t shaderCompileCount = 0;
+        std::chrono::duration<double, std::milli> compileTime{};
+    };
+    struct StreamedModel {
+        std::string path;
+        std::vector<Mesh> meshes;
+        std::unordered_map<std::string, Texture> textures;
+        //! Paths another load took first, the model isn't published before they are resident
+        std::vector<std::string> sharedTextures;
+        MeshPipelines pipelines;
+        std::chrono::duration<double, std::milli> loadTime{};
+    };
+    //! What loading models in one MaterialMode cost so far
+    struct MaterialModeStatistics {
+        size_t meshCount = 0;
+        size_t shaderCompileCount = 0;
+        size_t pipelineCount = 0;
+        std::chrono::duration<double, std::milli> compileTime{};
+    };
+    //! State changes of the mesh draws in the last frame, where the modes differ at render time
+    struct FrameStatistics {
+        size_t drawCount = 0;
+        size_t pipelineBindCount = 0;
+        size_t descriptorSetBindCount = 0;
+    };
+
+    StreamedModel streamModel(std::string path, MaterialMode mode,
+                              const std::vector<VkDescriptorSetLayout>& bindlessSetLayouts) noexcept;
+    //! Prepared pipelines are adopted unless a pipeline with their defines exists by now
+    void loadModels(std::vector<Mesh>&& meshes, MeshPipelines&& prepared);
+    void publishStreamedModels() noexcept;
     void createPipeline(const VkPipelineLayout pipelineLayout, std::unique_ptr<Pipeline>& pipeline, Shader&& shader,
-                        FixedPipelineStates states = FixedPipelineStates());
+                        FixedPipelineStates states = FixedPipelineStates(),
+                        Mesh::VertexFormat vertexFormat = Mesh::VertexFormat::Float);
 
     void createPipeline(const VkDescriptorSetLayout descriptorSetLayout, std::unique_ptr<Pipeline>& pipeline,
                         Shader&& shader, FixedPipelineStates states = FixedPipelineStates());
+    //! Index into MeshMGR::m_pipelines of the mesh's shader permutation, created on first use from the shaders
+    //! compiled up front by loadModels. -1 if the shader doesn't compile
+    uint32_t getMeshPipeline(const Mesh& mesh, MaterialMode mode, const std::vector<VkDescriptorSetLayout>& setLayouts,
+                             std::vector<Shader>& shaders);
+    //! Thread-safe, the pipeline isn't in MeshMGR yet
+    PipelineInfo createMeshPipeline(const Mesh& mesh, const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                    Shader&& shader);
+    //! Compiles and creates every pipeline the batch needs on the calling thread, for streaming workers
+    MeshPipelines createMeshPipelines(const std::vector<Mesh>& meshes, MaterialMode mode,
+                                      const std::vector<VkDescriptorSetLayout>& bindlessSetLayouts);
+    //! Set layouts of the bindless pipelines, empty without descriptor indexing
+    std::vector<VkDescriptorSetLayout> getBindlessSetLayouts() const;
+    //! 1x1 textures that stand in for missing material maps
+    void initDefaultTextures(UploadContext& uploadContext);
+    //! Descriptor set every bindless material shares
+    void initBindlessTextures(UploadContext& uploadContext);
+    //! Empty when the array is full, loadModels makes sure the textures of a bindless batch fit
+    std::optional<uint32_t> addBindlessTexture(const std::string& path, Texture::Role role,
+                                               UploadContext& uploadContext);
+    bool setBindlessTextures(const Mesh::Material& material, ObjectData& object, UploadContext& uploadContext);
     void renderObjects(VkCommandBuffer commandBuffer, uint32_t pipelineID, bool hasVertexInput) noexcept;
     void initEvents() noexcept;
-    void addSkybox() noexcept;
+    void addSkybox(UploadContext& uploadContext) noexcept;
     void addNormalTestPipeline() noexcept;
     void init_imgui();
     void initPipelines();
@@ -65,7 +152,31 @@ class App {
     bool m_useNormalPipeline = false;
     size_t m_normalPipelineID = -1;
     size_t m_normalPipelineDescriptorSetID = 0;
+    //! Framebuffer of the workflow pass that draws meshes, MeshMGR pipelines are created for its render pass
+    uint32_t m_meshFramebufferID = 0;
+    //! Frame data and environment maps of the bindless materials, their textures are in set 1
+    uint32_t m_bindlessDescriptorSetId = 0;
+    MaterialMode m_materialMode = MaterialMode::Defines;
+    std::array<MaterialModeStatistics, 4> m_materialModeStatistics{};
+    FrameStatistics m_frameStatistics;
     float m_normalMagnitude = 0.2f;
+    bool m_showLods = false;
+    //! Largest simplification error allowed on screen, in pixels
+    float m_lodPixelError = 1.f;
+    //! Dynamic offsets of this frame's GlobalUbo, ObjectData region and DebugUBO, in binding order (0, 1, 100).
+    //! Every set binds a prefix of them
+    std::array<uint32_t, 3> m_frameUniformOffsets{};
+    ModelLoader m_modelLoader;
+    std::vector<std::future<StreamedModel>> m_streamedModels;
+    //! Finished loads in queue order, waiting for earlier loads or for textures another load is still streaming
+    std::vector<StreamedModel> m_heldStreamedModels;
+    //! Since the queue was last empty, for the total load time
+    std::chrono::steady_clock::time_point m_streamingStart;
+    size_t m_streamingModelCount = 0;
+    size_t m_streamedMeshCount = 0;
+    //! Texture paths some streaming task has taken or that are resident, so no image is uploaded twice
+    std::unordered_set<std::string> m_streamedTexturePaths;
+    std::mutex m_streamedTexturePathsMutex;
 };
 
 }  // namespace sge
@@ -0,0 +1,45 @@
+#pragma once
+#include "Descriptors.h"
+#include "Device.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace sge {
+//! Every material texture in one update-after-bind array of combined image samplers, set 1 of the bindless mesh
+//! pipelines. Materials store array indices in ObjectData, so meshes of one material type only differ by push
+//! constants, App::renderObjects binds the array once per pass and draws every bindless mesh with it.
+//! Slots are written once and never reused, new textures can be added while frames in flight still sample the array.
+class BindlessTextures {
+ public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 4096;
+    //! Fixed slots the indices of missing maps point at, so the shader needs no per-map variants
+    static constexpr uint32_t WHITE_TEXTURE = 0;
+    static constexpr uint32_t BLACK_TEXTURE = 1;
+    static constexpr uint32_t FLAT_NORMAL_TEXTURE = 2;
+
+    //! The capacity is clamped to the update-after-bind limits of the device
+    BindlessTextures(Device& device, uint32_t capacity = DEFAULT_CAPACITY);
+    BindlessTextures(const BindlessTextures&) = delete;
+    BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+    //! Returns the slot of name, the descriptor is written the first time the name is seen. Empty when a new name
+    //! doesn't fit anymore
+    [[nodiscard]] std::optional<uint32_t> add(const std::string& name, VkDescriptorImageInfo imageInfo);
+    bool contains(const std::string& name) const noexcept { return m_indices.contains(name); }
+    uint32_t size() const noexcept { return static_cast<uint32_t>(m_indices.size()); }
+    uint32_t capacity() const noexcept { return m_capacity; }
+    VkDescriptorSetLayout getDescriptorSetLayout() const noexcept { return m_layout->getDescriptorSetLayout(); }
+    VkDescriptorSet getDescriptorSet() const noexcept { return m_set; }
+
+ private:
+    uint32_t m_capacity;
+    std::unique_ptr<DescriptorSetLayout> m_layout;
+    std::unique_ptr<DescriptorPool> m_pool;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    std::unordered_map<std::string, uint32_t> m_indices;
+};
+}  // namespace sge
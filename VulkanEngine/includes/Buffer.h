@@ -42,7 +42,7 @@ class Buffer {
     Device& m_device;
     void* m_mapped = nullptr;
     VkBuffer m_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    MemoryAllocation m_memory;
 
     VkDeviceSize m_bufferSize;
     uint32_t m_instanceCount;
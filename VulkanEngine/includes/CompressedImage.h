@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace sge {
+class MappedFile;
+
+//! Block-compressed (BC1/BC3/BC5/BC7) texture read from a KTX2 or DDS file. The mip chain is used as stored,
+//! the block data stays in the mapped file until the image is uploaded.
+class CompressedImage {
+ public:
+    struct SubImage {
+        uint32_t level = 0;
+        uint32_t layer = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::span<const std::byte> data;
+    };
+
+    //! Empty when the file is missing, malformed, supercompressed or not in a supported BC format
+    static std::optional<CompressedImage> load(const std::filesystem::path& path);
+    //! Bytes per 4x4 block, 0 for formats this loader doesn't handle
+    static uint32_t getBlockSize(VkFormat format) noexcept;
+
+    //! Always a UNORM format: shaders convert sRGB themselves, as they do for the uncompressed textures. Files
+    //! tagged *_SRGB_BLOCK, like the color bakes of TextureCache, are loaded as the UNORM twin of their format
+    VkFormat getFormat() const noexcept { return m_format; }
+    uint32_t getWidth() const noexcept { return m_width; }
+    uint32_t getHeight() const noexcept { return m_height; }
+    uint32_t getMipLevels() const noexcept { return m_mipLevels; }
+    uint32_t getLayerCount() const noexcept { return m_layerCount; }
+    //! One entry per mip level and layer, in file order
+    const std::vector<SubImage>& getSubImages() const noexcept { return m_subImages; }
+    size_t getDataSize() const noexcept;
+
+ private:
+    bool parseKtx2();
+    bool parseDds();
+    bool addSubImage(uint32_t level, uint32_t layer, size_t offset);
+
+    std::shared_ptr<const MappedFile> m_file;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_mipLevels = 1;
+    uint32_t m_layerCount = 1;
+    std::vector<SubImage> m_subImages;
+};
+}  // namespace sge
@@ -14,21 +14,26 @@ class DescriptorSetLayout {
      public:
         Builder(Device& device) : m_device{device} {}
 
+        //! An UPDATE_AFTER_BIND binding flag makes the layout require an UPDATE_AFTER_BIND pool
         Builder& addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags,
-                            uint32_t count = 1);
+                            uint32_t count = 1, VkDescriptorBindingFlags bindingFlags = 0);
         std::unique_ptr<DescriptorSetLayout> build() const;
 
      private:
         Device& m_device;
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings{};
+        std::unordered_map<uint32_t, VkDescriptorBindingFlags> m_bindingFlags{};
     };
 
-    DescriptorSetLayout(Device& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+    DescriptorSetLayout(Device& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
     ~DescriptorSetLayout();
     DescriptorSetLayout(const DescriptorSetLayout& other);
     DescriptorSetLayout& operator=(const DescriptorSetLayout&) = delete;
 
     VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+    //! Number of dynamic offsets vkCmdBindDescriptorSets expects for a set of this layout
+    uint32_t getDynamicOffsetCount() const noexcept;
 
  private:
     Device& m_device;
@@ -81,7 +86,8 @@ class DescriptorWriter {
     DescriptorWriter(DescriptorSetLayout& setLayout, DescriptorPool& pool);
 
     DescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
-    DescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
+    //! arrayElement selects the descriptor of an array binding
+    DescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo, uint32_t arrayElement = 0);
 
     bool build(VkDescriptorSet& set);
     void overwrite(VkDescriptorSet& set);
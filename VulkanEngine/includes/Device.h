@@ -1,16 +1,25 @@
 #pragma once
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
 #include "Window.h"
 
 #include <vulkan/vulkan.h>
 
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace sge {
 struct QueueFamilyIndices {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    //! Transfer-only family, most discrete GPUs have one backed by copy engines
+    uint32_t transferFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -37,27 +46,45 @@ class Device {
     VkSurfaceKHR surface() const noexcept;
     VkQueue graphicsQueue() const noexcept;
     VkQueue presentQueue() const noexcept;
+    //! The graphics queue when the device has no transfer-only family
+    VkQueue transferQueue() const noexcept;
+    bool hasDedicatedTransferQueue() const noexcept;
     VkCommandPool getCommandPool() const noexcept;
     VkInstance getInstance() const noexcept;
     bool isEnableValidationLayers() const noexcept;
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling,
                                  VkFormatFeatureFlags features) const;
-    [[nodiscard]] VkImageView createImageView(const VkImage image, const VkFormat format,
-                                              bool isCubeMap = false) noexcept;
+    //! Whether optimal-tiling images of the format can be downsampled with a linear vkCmdBlitImage
+    bool supportsLinearBlit(VkFormat format) const noexcept;
+    //! textureCompressionBC was available and is enabled
+    bool supportsBlockCompression() const noexcept;
+    //! VK_EXT_descriptor_indexing is enabled with update-after-bind, partially bound, runtime-sized and
+    //! non-uniformly indexed sampled image arrays
+    bool supportsDescriptorIndexing() const noexcept;
+    //! Size limit of an update-after-bind combined image sampler array, 0 without descriptor indexing
+    uint32_t getMaxUpdateAfterBindTextures() const noexcept;
+    [[nodiscard]] VkImageView createImageView(const VkImage image, const VkFormat format, bool isCubeMap = false,
+                                              uint32_t mipLevels = 1) noexcept;
     [[nodiscard]] VkSampler createTextureSampler(const VkSamplerCreateInfo& sampleInfo) const noexcept;
+    //! Memory comes from the device allocator and has to be released with freeMemory
     void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image,
-                             VkDeviceMemory& imageMemory);
+                             MemoryAllocation& imageMemory);
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                      VkDeviceMemory& bufferMemory);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const;
-    void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
-                           uint32_t layerCount = 1) const;
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
-                               uint32_t layerCount = 1) const;
+                      MemoryAllocation& bufferMemory);
+    void freeMemory(MemoryAllocation& allocation) const;
+    MemoryAllocator& getAllocator() const noexcept;
+    //! Every pipeline is created through it, it is saved to disk when the device is destroyed
+    PipelineCache& getPipelineCache() const noexcept;
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
+    //! Single time commands may be recorded on any thread, every thread gets its own command pool
     void endSingleTimeCommands(const VkCommandBuffer commandBuffer) const;
     VkCommandBuffer beginSingleTimeCommands() const;
+    //! Must be held around every vkQueueSubmit / vkQueuePresentKHR, uploads can run on worker threads
+    std::mutex& queueMutex() const noexcept;
+    //! Guards transferQueue(), which is queueMutex() without a dedicated transfer family
+    std::mutex& transferQueueMutex() const noexcept;
+    void waitIdle() const;
 
  private:
     void createInstance();
@@ -68,10 +95,15 @@ class Device {
     void checkForSupportedExtentions();
     bool checkValidationLayerSupport();
     void createCommandPool();
+    VkCommandPool getThreadCommandPool() const;
 
     std::vector<const char*> getRequiredExtentions() const;
     QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice device) const;
     SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice device) const;
+    //! Fills the features to enable when the physical device has everything the bindless textures need
+    bool querySupportedDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeatures& features);
+    //! Core in Vulkan 1.3, adds the extension to enable otherwise
+    bool querySupportedPipelineCreationFeedback(std::vector<const char*>& extensions) const;
     VkPhysicalDeviceProperties m_physicalProperties;
     Window& m_window;
     VkInstance m_instance;
@@ -80,7 +112,19 @@ class Device {
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
+    VkQueue m_transferQueue;
+    bool m_hasDedicatedTransferQueue = false;
+    bool m_supportsBlockCompression = false;
+    bool m_supportsDescriptorIndexing = false;
+    bool m_supportsPipelineCreationFeedback = false;
+    uint32_t m_maxUpdateAfterBindTextures = 0;
     VkCommandPool m_commandPool;
+    mutable std::unordered_map<std::thread::id, VkCommandPool> m_threadCommandPools;
+    mutable std::mutex m_threadCommandPoolsMutex;
+    mutable std::mutex m_queueMutex;
+    mutable std::mutex m_transferQueueMutex;
+    std::unique_ptr<MemoryAllocator> m_allocator;
+    std::unique_ptr<PipelineCache> m_pipelineCache;
     VkDebugUtilsMessengerEXT m_debugMessenger;
     bool m_enableValidationLayers = true;
     const std::vector<const char*> m_validationLayers = {"VK_LAYER_KHRONOS_validation"};
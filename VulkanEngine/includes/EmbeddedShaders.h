@@ -0,0 +1,15 @@
+#pragma once
+#include <span>
+#include <string_view>
+
+namespace sge {
+//! SPIR-V of one shader permutation compiled at build time (see cmake/ShaderPermutations.cmake)
+struct EmbeddedShader {
+    std::string_view path;     ///< Source path as the app passes it to Shader
+    std::string_view defines;  ///< Defines as the app passes them to Shader
+    std::span<const unsigned char> spirv;
+};
+
+//! Every permutation compiled into the binary, only defined when built with SGE_EMBEDDED_SHADERS
+std::span<const EmbeddedShader> getEmbeddedShaders() noexcept;
+}  // namespace sge
@@ -1,9 +1,12 @@
 #pragma once
 #include <array>
 #include <functional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace sge {
-enum class EventType { WindowResize = 0, KeyPressed, Scroll, EventsCount };
+enum class EventType { WindowResize = 0, KeyPressed, Scroll, FileDrop, EventsCount };
 
 class BaseEvent {
  public:
@@ -53,4 +56,12 @@ class EventScroll final : public BaseEvent {
     double x, y;
 };
 
+class EventFileDrop final : public BaseEvent {
+ public:
+    explicit EventFileDrop(std::vector<std::string> new_paths) : paths(std::move(new_paths)) {}
+    EventType get_type() const override { return EventType::FileDrop; }
+    static const EventType type = EventType::FileDrop;
+    std::vector<std::string> paths;
+};
+
 }  // namespace sge
@@ -0,0 +1,58 @@
+#pragma once
+#include "Buffer.h"
+#include "Device.h"
+#include "UploadContext.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sge {
+//! Sub-allocates mesh streams from a few large device-local buffers. Every block holds elements of a single
+//! size and usage, so an allocation offset can be passed straight to vkCmdDrawIndexed as
+//! firstIndex / vertexOffset / firstInstance while the block itself stays bound for the whole pass.
+class GeometryPool {
+ public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+    struct Allocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        //! In elements from the start of the block
+        uint32_t offset = 0;
+        uint32_t count = 0;
+        bool isValid() const noexcept { return buffer != VK_NULL_HANDLE; }
+    };
+
+    struct Statistics {
+        size_t blockCount = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+    };
+
+    explicit GeometryPool(Device& device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    ~GeometryPool() = default;
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    //! Thread-safe. Requests bigger than a block get a block of their own
+    Allocation allocate(VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count);
+    //! Records a copy of data through a staging buffer to the start of the allocation
+    void upload(const Allocation& allocation, uint32_t elementSize, const void* data, UploadContext& uploadContext);
+    Statistics getStatistics() const;
+
+ private:
+    struct Block {
+        std::unique_ptr<Buffer> buffer;
+        VkBufferUsageFlags usage = 0;
+        uint32_t elementSize = 0;
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+    };
+
+    Device& m_device;
+    VkDeviceSize m_blockSize;
+    std::vector<Block> m_blocks;
+    mutable std::mutex m_mutex;
+};
+}  // namespace sge
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace sge {
+constexpr uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV1A_PRIME = 1099511628211ull;
+
+//! 64-bit FNV-1a, pass the previous result as seed to hash several values together
+inline uint64_t hashBytes(const void* data, const size_t size, uint64_t seed = FNV1A_OFFSET_BASIS) noexcept {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        seed ^= bytes[i];
+        seed *= FNV1A_PRIME;
+    }
+    return seed;
+}
+
+inline uint64_t hashString(const std::string_view str, const uint64_t seed = FNV1A_OFFSET_BASIS) noexcept {
+    return hashBytes(str.data(), str.size(), seed);
+}
+
+template <typename T>
+inline uint64_t hashValue(const T& value, const uint64_t seed = FNV1A_OFFSET_BASIS) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be hashed by bytes");
+    return hashBytes(&value, sizeof(T), seed);
+}
+}  // namespace sge
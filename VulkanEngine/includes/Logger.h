@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include <sstream>
 
 namespace sge {
@@ -13,23 +14,30 @@ class Logger {
     void flush_error() noexcept;
     void flush_info() noexcept;
     void flush() const noexcept;
+    std::recursive_mutex& mutex() noexcept;
     static Logger& Instance() noexcept;
 
  private:
     Logger();
     ~Logger();
     std::stringstream m_ss;
+    std::recursive_mutex m_mutex;
 };
 #define LOG_ERROR(...) \
     { \
+        std::scoped_lock sgeLoggerLock(sge::Logger::Instance().mutex()); \
         sge::Logger::Instance().log() << "In file: " << __FILE__ << ", in line " << __LINE__ << ": " << __VA_ARGS__; \
         sge::Logger::Instance().flush_error(); \
     }
 #define LOG_MSG(...) \
     { \
+        std::scoped_lock sgeLoggerLock(sge::Logger::Instance().mutex()); \
         sge::Logger::Instance().log() << __VA_ARGS__; \
         sge::Logger::Instance().flush_info(); \
     }
 #define LOG_MSG_FLUSH \
-    { sge::Logger::Instance().flush(); }
+    { \
+        std::scoped_lock sgeLoggerLock(sge::Logger::Instance().mutex()); \
+        sge::Logger::Instance().flush(); \
+    }
 }  // namespace sge
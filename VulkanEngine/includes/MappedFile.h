@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+
+namespace sge {
+//! Read-only memory mapping of a whole file
+class MappedFile {
+ public:
+    explicit MappedFile(const std::filesystem::path& path) noexcept;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    bool isValid() const noexcept;
+    const std::byte* data() const noexcept;
+    size_t size() const noexcept;
+
+ private:
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+}  // namespace sge
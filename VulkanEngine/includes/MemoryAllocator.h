@@ -0,0 +1,91 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace sge {
+struct MemoryBlock;
+
+//! A range of device memory handed out by MemoryAllocator
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    //! Size the resource asked for, the reserved range can be larger
+    VkDeviceSize size = 0;
+    //! Host-visible memory stays mapped for its whole lifetime, points at offset
+    void* mapped = nullptr;
+    //! Null for dedicated allocations
+    MemoryBlock* block = nullptr;
+    uint32_t order = 0;
+    bool isValid() const noexcept { return memory != VK_NULL_HANDLE; }
+};
+
+//! Sub-allocates device memory from large blocks with a buddy free-list, one pool per memory type and resource
+//! kind. Keeping linear (buffers) and optimal (images) resources in separate blocks means neighbours never need
+//! bufferImageGranularity padding.
+class MemoryAllocator {
+ public:
+    enum class ResourceKind { Linear = 0, Optimal, Count };
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+
+    struct Statistics {
+        size_t blockCount = 0;
+        size_t dedicatedCount = 0;
+        size_t allocationCount = 0;
+        //! Everything taken from the driver
+        VkDeviceSize reservedBytes = 0;
+        //! Bytes resources asked for, the rest of reservedBytes is padding or free
+        VkDeviceSize usedBytes = 0;
+        //! Share of free block memory outside the largest free range of its block
+        float fragmentation = 0.f;
+    };
+
+    MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+    ~MemoryAllocator();
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    //! Thread-safe. dedicatedImage / dedicatedBuffer are only used when the allocation ends up dedicated
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, ResourceKind kind,
+                              bool preferDedicated, VkImage dedicatedImage = VK_NULL_HANDLE,
+                              VkBuffer dedicatedBuffer = VK_NULL_HANDLE);
+    void free(MemoryAllocation& allocation);
+    //! Range is relative to the allocation, VK_WHOLE_SIZE covers all of it
+    VkResult flush(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+    VkResult invalidate(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+    Statistics getStatistics() const;
+
+ private:
+    VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const noexcept;
+    MemoryAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, VkImage image, VkBuffer buffer);
+    VkMappedMemoryRange getMappedRange(const MemoryAllocation& allocation, VkDeviceSize size,
+                                       VkDeviceSize offset) const noexcept;
+    bool isHostVisible(uint32_t memoryTypeIndex) const noexcept;
+
+    VkDevice m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+    //! m_pools[memoryTypeIndex * ResourceKind::Count + kind]
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> m_pools;
+    size_t m_dedicatedCount = 0;
+    VkDeviceSize m_dedicatedBytes = 0;
+    mutable std::mutex m_mutex;
+};
+
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr;
+    VkDeviceSize size = 0;
+    size_t poolIndex = 0;
+    //! Free ranges by order, order n covers MIN_ALLOCATION_SIZE << n bytes
+    std::vector<std::set<VkDeviceSize>> freeLists;
+    VkDeviceSize usedBytes = 0;
+    size_t allocationCount = 0;
+};
+}  // namespace sge
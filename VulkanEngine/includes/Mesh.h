@@ -3,15 +3,17 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_LEFT_HANDED
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
-#include "Buffer.h"
 #include "Device.h"
+#include "GeometryPool.h"
 
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace sge {
+class MappedFile;
 
 struct Vertex {
     glm::vec<3, float, glm::packed_highp> m_position;
@@ -21,6 +23,27 @@ struct Vertex {
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescription() noexcept;
 };
 
+//! 16-byte vertex: positions normalized to the mesh bounds, octahedral normals, half-float UVs
+struct QuantizedVertex {
+    uint16_t m_position[4];
+    int16_t m_normal[2];
+    uint16_t m_UV[2];
+    static std::vector<VkVertexInputBindingDescription> getBindingDescription() noexcept;
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescription() noexcept;
+};
+
+//! Per-instance vertex stream (binding 1): one node transform per instance
+struct InstanceData {
+    InstanceData() = default;
+    //! Computes the normal matrix, so the vertex shaders don't invert the transform per vertex
+    explicit InstanceData(const glm::mat4& modelMatrix) noexcept;
+    glm::mat4 m_modelMatrix{1.f};
+    //! transpose(inverse(mat3(m_modelMatrix))), columns padded to vec4
+    glm::mat3x4 m_normalMatrix{1.f};
+    static std::vector<VkVertexInputBindingDescription> getBindingDescription() noexcept;
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescription() noexcept;
+};
+
 class Mesh {
  public:
     struct Material {
@@ -43,11 +66,21 @@ class Mesh {
 
     enum class MaterialType { PBR, Phong };
 
+    enum class VertexFormat { Float, Quantized };
+
     struct BoundingBox {
         glm::vec3 min{};
         glm::vec3 max{};
     };
 
+    //! Index range of one detail level inside the shared index buffer
+    struct Lod {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        //! Simplification error relative to the mesh extent
+        float error = 0.f;
+    };
+
     Mesh() = default;
     ~Mesh() = default;
     Mesh& operator=(const Mesh&) = delete;
@@ -61,21 +94,57 @@ class Mesh {
     const glm::mat4& getModelMatrix() const;
     uint32_t getVertexCount() const;
     uint32_t getIndexCount() const;
+    //! A mesh without instances is drawn once with an identity instance transform
+    uint32_t getInstanceCount() const noexcept;
     uint32_t getPipelineId() const;
     uint32_t getDescriptorSetId() const;
     const std::string& getName() const noexcept;
+    //! Vertex data from m_pos or, for baked meshes, straight from the mapped cache file
+    std::span<const Vertex> getVertices() const noexcept;
+    std::span<const uint32_t> getIndices() const noexcept;
+    void setMappedData(std::shared_ptr<const MappedFile> file, std::span<const Vertex> vertices,
+                       std::span<const uint32_t> indices) noexcept;
+    //! Drops the float vertices, e.g. once the mesh has been quantized
+    void clearVertices() noexcept;
+    //! Vertex buffer contents in m_vertexFormat
+    std::span<const std::byte> getVertexData() const noexcept;
+    uint32_t getVertexStride() const noexcept;
+    //! Recomputes m_instanceBounds and m_maxInstanceScale after the instances changed
+    void updateInstanceBounds() noexcept;
     std::vector<Vertex> m_pos;
     std::vector<uint32_t> m_ind;
-    std::unique_ptr<Buffer> m_vertexBuffer;
-    std::unique_ptr<Buffer> m_indexBuffer;
+    std::vector<InstanceData> m_instances;
+    //! Ranges inside the geometry pool: offset is the vertexOffset / firstIndex / firstInstance of the draw
+    GeometryPool::Allocation m_vertexAllocation;
+    GeometryPool::Allocation m_indexAllocation;
+    GeometryPool::Allocation m_instanceAllocation;
+    //! Chosen when the index buffer is created, UINT16 for meshes that fit
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
     BoundingBox m_boundingBox;
     uint32_t m_pipelineId = 0;
     uint32_t m_descriptorSetId = 0;
+    //! Index of the mesh's ObjectData, pushed with every draw
+    uint32_t m_objectIndex = 0;
     Material m_material;
     MaterialType m_materialType{MaterialType::Phong};
     std::string m_name = "Default mesh";
+    VertexFormat m_vertexFormat{VertexFormat::Float};
+    std::vector<QuantizedVertex> m_quantizedPos;
+    //! Dequantization: position = m_positionScale * quantized + m_positionOffset
+    glm::vec3 m_positionScale{1.f};
+    glm::vec3 m_positionOffset{0.f};
+    //! LOD0 first, empty when the mesh has no LOD chain
+    std::vector<Lod> m_lods;
+    uint32_t m_currentLod = 0;
+    //! Union of m_boundingBox under every instance transform and the largest scale among them, so the LOD of all
+    //! instances is chosen without walking them every frame
+    BoundingBox m_instanceBounds;
+    float m_maxInstanceScale = 1.f;
 
  private:
     glm::mat4 m_modelMatrix{1.f};
+    std::shared_ptr<const MappedFile> m_mappedFile;
+    std::span<const Vertex> m_mappedVertices;
+    std::span<const uint32_t> m_mappedIndices;
 };
 }  // namespace sge
@@ -0,0 +1,49 @@
+#pragma once
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sge {
+//! Baked import results, keyed by the source path and the import settings. An entry records the size, modification
+//! time and content hash of the source and of the other files the import read (external glTF buffers, .mtl files).
+//! Files whose size and time still match aren't read on load, editing any of them makes the entry stale.
+//! Vertex and index arrays of a loaded cache are not copied, meshes reference the mapped file. The optimizer
+//! statistics of the import are kept with each mesh, so they can be reported on load too.
+class MeshCache {
+ public:
+    static constexpr uint32_t VERSION = 8;
+    //! Size and modification time, a file whose stamp still matches isn't read again
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    MeshCache(const std::filesystem::path& sourcePath, uint32_t importFlags, uint64_t importSettingsHash = 0,
+              std::filesystem::path cacheDirectory = "cache/meshes") noexcept;
+
+    bool isValid() const noexcept;
+    const std::filesystem::path& getCachePath() const noexcept;
+    //! Empty when there is no entry or one of the recorded dependencies changed since it was stored.
+    //! statistics receives one entry per mesh
+    std::optional<std::vector<Mesh>> load(std::vector<MeshOptimizer::Statistics>* statistics = nullptr) const
+        noexcept;
+    //! statistics is empty or holds one entry per mesh, dependencies are the files besides the source the import read
+    bool store(const std::vector<Mesh>& meshes, const std::vector<MeshOptimizer::Statistics>& statistics,
+               const std::vector<std::string>& dependencies = {}) const noexcept;
+
+ private:
+    std::filesystem::path m_sourcePath;
+    //! Taken when the cache is opened, before the import reads the source
+    FileStamp m_sourceStamp;
+    uint64_t m_key = 0;
+    uint32_t m_importFlags = 0;
+    std::filesystem::path m_cachePath;
+    bool m_isValid = false;
+};
+}  // namespace sge
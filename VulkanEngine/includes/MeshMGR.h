@@ -1,21 +1,29 @@
 #pragma once
+#include "BindlessTextures.h"
 #include "Descriptors.h"
 #include "Mesh.h"
+#include "ObjectBuffer.h"
 #include "Pipeline.h"
+#include "UniformRing.h"
 
 #include <Texture.h>
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace sge {
 struct DescriptorSetInfo {
     std::unique_ptr<DescriptorSetLayout> layout;
-    std::unique_ptr<Buffer> uboBuffer;
     VkDescriptorSet set;
 };
 
+struct MaterialBinding {
+    uint32_t descriptorSetId;
+    uint32_t pipelineId;
+};
+
 struct PipelineInfo {
     std::string name;
     VkPipelineLayout pipelineLayout;
@@ -36,12 +44,18 @@ class MeshMGR {
 
     std::vector<PipelineInfo> m_pipelines;
     std::vector<DescriptorSetInfo> m_sets;
+    //! Meshes with the same textures and shader defines share one descriptor set
+    std::unordered_map<std::string, MaterialBinding> m_materials;
     std::vector<Mesh> m_meshes;
     std::vector<Mesh> m_systemMeshes;
-    std::unique_ptr<Buffer> m_generalMatrixUBO;
-    std::unique_ptr<Buffer> m_debugUBO;
+    //! GlobalUbo and DebugUBO of every frame, bound at binding 0 and 100 with dynamic offsets
+    std::unique_ptr<UniformRing> m_frameUniforms;
+    //! ObjectData of every mesh, bound at binding 1 with a dynamic offset
+    std::unique_ptr<ObjectBuffer> m_objects;
     std::unique_ptr<Buffer> m_normalTestUBO;
     std::unordered_map<std::string, Texture> m_textures;
+    //! Null when the device lacks descriptor indexing, materials then get one descriptor set per texture set
+    std::unique_ptr<BindlessTextures> m_bindlessTextures;
     std::unique_ptr<DescriptorPool> m_UIPool{};
 
  private:
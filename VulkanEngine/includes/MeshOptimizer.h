@@ -0,0 +1,71 @@
+#pragma once
+#include "Mesh.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sge {
+//! Import-time mesh processing: vertex welding, vertex cache / overdraw triangle order and vertex fetch order
+class MeshOptimizer {
+ public:
+    static constexpr uint32_t VERTEX_CACHE_SIZE = 32;
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+    static constexpr uint32_t MAX_LOD_COUNT = 5;
+    //! Largest simplification error of a LOD, relative to the mesh extent
+    static constexpr float MAX_LOD_ERROR = 0.05f;
+    static constexpr uint32_t OVERDRAW_GRID_SIZE = 256;
+
+    struct Statistics {
+        uint32_t verticesBefore = 0;
+        uint32_t verticesAfter = 0;
+        float acmrBefore = 0.f;
+        float acmrAfter = 0.f;
+        float atvrBefore = 0.f;
+        float atvrAfter = 0.f;
+        float overdrawBefore = 0.f;
+        float overdrawAfter = 0.f;
+    };
+
+    struct QuantizationError {
+        float maxPositionError = 0.f;
+        //! maxPositionError relative to the diagonal of the mesh bounds
+        float maxPositionErrorRelative = 0.f;
+        float maxNormalErrorDegrees = 0.f;
+        float maxUVError = 0.f;
+    };
+
+    //! Works on m_pos / m_ind, meshes loaded from the mesh cache are already optimized
+    static Statistics optimize(Mesh& mesh) noexcept;
+
+    static void weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) noexcept;
+    //! Tipsify, returns the first triangle of every cluster ending at a cache flush
+    static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                                                     uint32_t cacheSize = VERTEX_CACHE_SIZE) noexcept;
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices,
+                                 std::span<const uint32_t> hardClusters, uint32_t cacheSize = VERTEX_CACHE_SIZE,
+                                 float threshold = OVERDRAW_THRESHOLD) noexcept;
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) noexcept;
+    //! Quadric edge collapse onto existing vertices, border and attribute seam vertices stay locked.
+    //! resultError receives the largest collapse error relative to the mesh extent
+    static std::vector<uint32_t> simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                                          size_t targetIndexCount, float targetError,
+                                          float* resultError = nullptr) noexcept;
+    //! Appends the simplified levels to m_ind and describes all of them in m_lods
+    static void generateLods(Mesh& mesh) noexcept;
+    //! Converts the mesh to Mesh::VertexFormat::Quantized and reports the precision loss
+    static QuantizationError quantizeVertices(Mesh& mesh) noexcept;
+
+    //! Transformed vertices of a FIFO post-transform cache
+    static uint32_t countCacheMisses(std::span<const uint32_t> indices, size_t vertexCount,
+                                     uint32_t cacheSize = VERTEX_CACHE_SIZE) noexcept;
+    static float computeACMR(std::span<const uint32_t> indices, size_t vertexCount,
+                             uint32_t cacheSize = VERTEX_CACHE_SIZE) noexcept;
+    static float computeATVR(std::span<const uint32_t> indices, size_t vertexCount,
+                             uint32_t cacheSize = VERTEX_CACHE_SIZE) noexcept;
+    //! Shaded pixels per covered pixel when the front faces are drawn in index order with a depth test, summed
+    //! over the six axis-aligned views of the mesh. 1 means no pixel is shaded twice
+    static float computeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                                 uint32_t gridSize = OVERDRAW_GRID_SIZE) noexcept;
+};
+}  // namespace sge
@@ -1,7 +1,9 @@
 #pragma once
 #include "Device.h"
+#include "GeometryPool.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "UploadContext.h"
 
 #include <unordered_map>
 #include <vector>
@@ -15,14 +17,32 @@ class Model {
     Model& operator=(const Model&) = delete;
     Model(Model&&) = default;
     Model& operator=(Model&&) = default;
+    //! Pool buffers currently bound on a command buffer
+    struct GeometryBinding {
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkBuffer instanceBuffer = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+    };
+
     void bind(const VkCommandBuffer commandBuffer, const Mesh& mesh) const noexcept;
+    //! Only rebinds what differs from bound, so meshes living in the same pool blocks share one bind per pass
+    void bind(const VkCommandBuffer commandBuffer, const Mesh& mesh, GeometryBinding& bound) const noexcept;
     void draw(const VkCommandBuffer commandBuffer, const Mesh& mesh) const noexcept;
-    void createBuffers() noexcept;
-    void createTexture(Texture& texture) noexcept;
+    //! Uploads meshes of MeshMGR that have no GPU buffers yet
+    void createBuffers(UploadContext& uploadContext) noexcept;
+    //! Safe to call from worker threads, as long as the mesh isn't shared with the render thread yet.
+    //! The data is usable once uploadContext has been flushed
+    void createMeshBuffers(Mesh& mesh, UploadContext& uploadContext) noexcept;
+    void createTexture(Texture& texture, UploadContext& uploadContext) noexcept;
+    GeometryPool::Statistics getGeometryStatistics() const;
 
  private:
-    void createVertexBuffers(const std::vector<Vertex>& vertices, Mesh& mesh) noexcept;
-    void createIndexBuffers(const std::vector<uint32_t>& indices, Mesh& mesh) noexcept;
+    void createVertexBuffers(std::span<const std::byte> vertexData, uint32_t vertexStride, Mesh& mesh,
+                             UploadContext& uploadContext) noexcept;
+    void createIndexBuffers(std::span<const uint32_t> indices, Mesh& mesh, UploadContext& uploadContext) noexcept;
+    void createInstanceBuffers(Mesh& mesh, UploadContext& uploadContext) noexcept;
     Device& m_device;
+    GeometryPool m_geometryPool;
 };
 }  // namespace sge
@@ -0,0 +1,84 @@
+#pragma once
+#include "Buffer.h"
+#include "Device.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sge {
+//! Bits of ObjectData::materialFlags, one per material map
+enum MaterialFlags : uint32_t {
+    MATERIAL_COLOR_MAP = 1u << 0,
+    MATERIAL_METALLIC_ROUGHNESS_MAP = 1u << 1,
+    MATERIAL_NORMAL_MAP = 1u << 2,
+    MATERIAL_EMISSIVE_MAP = 1u << 3,
+    MATERIAL_OCCLUSION_MAP = 1u << 4
+};
+
+//! std430 element of the object storage buffer, see ObjectData in the mesh shaders
+struct ObjectData {
+    glm::mat4 modelMatrix{1.f};
+    //! mat3 in std430 pads every column to a vec4
+    glm::mat3x4 normalMatrix{1.f};
+    glm::vec4 baseColor{1.f};
+    glm::vec4 lightDirection{0.f};
+    float metallic = 0.f;
+    float roughness = 0.f;
+    //! BindlessTextures slots of the material maps, unused by the per-material descriptor sets
+    uint32_t baseColorTexture = 0;
+    uint32_t metallicRoughnessTexture = 0;
+    uint32_t normalTexture = 0;
+    uint32_t emissiveTexture = 0;
+    uint32_t occlusionTexture = 0;
+    //! MaterialFlags of the maps the material has, branched on by the dynamic material mode
+    uint32_t materialFlags = 0;
+};
+static_assert(sizeof(ObjectData) % 16 == 0, "ObjectData must match the std430 array stride");
+
+//! Model matrices and material parameters of every object in one storage buffer, indexed by the objectIndex
+//! push constant. Like UniformRing the buffer holds one persistently mapped region per frame in flight,
+//! selected with a STORAGE_BUFFER_DYNAMIC offset, and a region only receives the ranges dirtied since the
+//! frame last used it.
+class ObjectBuffer {
+ public:
+    //! 131072 objects, 22 MB per frame in flight
+    static constexpr uint32_t DEFAULT_CAPACITY = 1u << 17;
+
+    ObjectBuffer(Device& device, uint32_t frameCount, uint32_t capacity = DEFAULT_CAPACITY);
+    ObjectBuffer(const ObjectBuffer&) = delete;
+    ObjectBuffer& operator=(const ObjectBuffer&) = delete;
+
+    //! Returns the objectIndex, visible from the next beginFrame on. Empty when the buffer is full
+    [[nodiscard]] std::optional<uint32_t> add(const ObjectData& object);
+    void update(uint32_t index, const ObjectData& object);
+    const ObjectData& get(uint32_t index) const noexcept;
+    uint32_t size() const noexcept { return static_cast<uint32_t>(m_objects.size()); }
+    uint32_t capacity() const noexcept { return m_capacity; }
+
+    //! Copies the dirty ranges into the region of frameIndex, whose previous frame must have completed
+    void beginFrame(uint32_t frameIndex) noexcept;
+    //! Dynamic offset of the region selected by beginFrame
+    uint32_t getFrameOffset() const noexcept { return static_cast<uint32_t>(m_regionSize * m_frameIndex); }
+    VkDescriptorBufferInfo descriptorInfo() const;
+
+ private:
+    struct DirtyRange {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    void markDirty(uint32_t begin, uint32_t end) noexcept;
+
+    uint32_t m_capacity;
+    VkDeviceSize m_regionSize;
+    uint32_t m_frameIndex = 0;
+    std::unique_ptr<Buffer> m_buffer;
+    //! CPU copy the regions are refreshed from
+    std::vector<ObjectData> m_objects;
+    std::vector<DirtyRange> m_dirtyRanges;
+};
+}  // namespace sge
@@ -36,7 +36,13 @@ class Pipeline {
     void bind(VkCommandBuffer commandBuffer) const noexcept;
     //static PipelineConfigInfo createDefaultPipeline(uint32_t width, uint32_t height, FixedPipelineStates states);
     static std::vector<VkPipelineColorBlendAttachmentState> createDefaultColorAttachments();
-    static const VkPipelineLayout createPipeLineLayout(const VkDevice device, VkDescriptorSetLayout setLayout);
+    static const VkPipelineLayout createPipeLineLayout(
+        const VkDevice device, VkDescriptorSetLayout setLayout,
+        const std::vector<VkPushConstantRange>& pushConstantRanges = std::vector<VkPushConstantRange>());
+    //! Set layouts in set number order
+    static const VkPipelineLayout createPipeLineLayout(
+        const VkDevice device, const std::vector<VkDescriptorSetLayout>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstantRanges = std::vector<VkPushConstantRange>());
     bool recreatePipelineShaders(const VkRenderPass renderPass);
 
  private:
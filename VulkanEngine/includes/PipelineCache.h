@@ -0,0 +1,53 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace sge {
+//! Device-wide VkPipelineCache kept on disk between runs. The file is the driver's cache data as is, its header is
+//! checked against the device before the driver sees it, not every driver rejects data of another GPU or driver.
+class PipelineCache {
+ public:
+    struct Statistics {
+        //! Pipelines found in the cache, hits and misses are only known with pipeline creation feedback
+        size_t hitCount = 0;
+        size_t missCount = 0;
+        //! Created without feedback
+        size_t unknownCount = 0;
+        std::chrono::duration<double, std::milli> creationTime{};
+        //! Size of the data loaded at startup, 0 when there was no file or it didn't match the device
+        size_t loadedBytes = 0;
+    };
+
+    PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, bool hasCreationFeedback,
+                  std::filesystem::path cachePath = "cache/pipelines.bin") noexcept;
+    ~PipelineCache();
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    VkPipelineCache getPipelineCache() const noexcept;
+    //! VkPipelineCreationFeedbackCreateInfo can be chained to pipeline creation
+    bool hasCreationFeedback() const noexcept;
+    //! Thread-safe. feedback is null when the pipeline was created without it
+    void recordCreation(const VkPipelineCreationFeedback* feedback,
+                        std::chrono::duration<double, std::milli> creationTime);
+    Statistics getStatistics() const;
+    //! Writes the driver's data back, skipped when every pipeline of the run came from the loaded file
+    bool save() const noexcept;
+
+ private:
+    //! Empty when there is no file or its header doesn't match the device
+    std::vector<std::byte> load() const noexcept;
+
+    VkDevice m_device;
+    VkPhysicalDeviceProperties m_properties;
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+    bool m_hasCreationFeedback;
+    std::filesystem::path m_cachePath;
+    Statistics m_statistics;
+    mutable std::mutex m_mutex;
+};
+}  // namespace sge
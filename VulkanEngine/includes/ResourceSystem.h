@@ -2,6 +2,7 @@
 #include "Device.h"
 #include "Buffer.h"
 
+#include <optional>
 #include <vector>
 namespace sge {
 struct FrameBufferAttachment {
@@ -24,6 +25,8 @@ struct PipelineDescription {
     Pipeline pipeline;
     uint32_t descriptorID;
     uint32_t framebufferID;
+    //! Same stage for meshes in Mesh::VertexFormat::Quantized
+    std::optional<uint32_t> quantizedVariantID;
 };
 
 class WorkFlow 
@@ -74,6 +77,8 @@ class ResourceSystem {
  public:
     static ResourceSystem& Instance() noexcept;
     void init(const Device* device) noexcept;
+    //! Releases the GPU objects while the device is still alive, the singleton itself outlives it
+    void clear() noexcept;
     ResourceSystem(const ResourceSystem&) = delete;
     ResourceSystem(ResourceSystem&&) = delete;
     ResourceSystem& operator=(const ResourceSystem&) = delete;
@@ -1,4 +1,5 @@
 #pragma once
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -8,6 +9,11 @@ struct ShaderDefines {
     std::string vertShaderDefines;
     std::string fragmentShaderDefines;
     std::string geometryShaderDefines;
+    //! Values of the fragment shader's specialization constants, constant_id is the index. They are applied when
+    //! the pipeline is created, every value shares the same SPIR-V
+    std::vector<uint32_t> fragmentSpecialization;
+
+    bool operator==(const ShaderDefines&) const = default;
 };
 
 class Shader {
@@ -15,6 +21,11 @@ class Shader {
     explicit Shader(const std::string_view vertexShaderPath, const std::string_view fragmentShaderPath,
                     const std::string_view geometryShaderPath = "",
                     const ShaderDefines& defines = ShaderDefines{}) noexcept;
+    //! Tag for the constructor that leaves compiling to compileAll
+    struct Deferred {};
+    //! Not valid until it is compiled by compileAll or recompile
+    Shader(Deferred, const std::string_view vertexShaderPath, const std::string_view fragmentShaderPath,
+           const std::string_view geometryShaderPath = "", const ShaderDefines& defines = ShaderDefines{}) noexcept;
 
     Shader(const Shader& other);
     Shader(Shader&& other) noexcept;
@@ -34,6 +45,11 @@ class Shader {
     [[nodiscard]] const bool isGeometryShaderPresent() const noexcept;
     [[nodiscard]] const bool isValid() const noexcept;
     bool recompile() noexcept;
+    //! Copy that shares the compiled stages, with other specialization constant values
+    [[nodiscard]] Shader specialize(std::vector<uint32_t> fragmentSpecialization) const;
+    //! Compiles every stage of every shader concurrently on the thread pool and the calling thread, each with its
+    //! own compiler. Stages no worker has started are compiled by the caller, it doesn't wait behind queued tasks
+    static void compileAll(std::span<Shader> shaders) noexcept;
 
  private:
     /// Set of possible shader types
@@ -41,6 +57,8 @@ class Shader {
 
     std::string readFile(const std::string_view filePath) noexcept;
     bool processShader(const ShaderType type, bool isHLSL = false) noexcept;
+    //! Touches only the members of its stage, so the stages of a shader can compile concurrently
+    bool compileStage(const ShaderType type) noexcept;
     bool compileShaders() noexcept;
     std::string m_vertShaderPath;
     std::string m_fragShaderPath;
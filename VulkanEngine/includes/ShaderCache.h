@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sge {
+//! Compiled SPIR-V of one shader stage, keyed by the source with its defines, the source path, the stage and the
+//! compiler options. An entry records every file the source included together with its content hash, editing
+//! any of them makes the entry stale.
+class ShaderCache {
+ public:
+    static constexpr uint32_t VERSION = 1;
+
+    //! source is the text handed to the compiler, after the defines were inserted
+    ShaderCache(std::string_view source, std::string_view sourcePath, uint32_t stage, uint64_t optionsHash,
+                std::filesystem::path cacheDirectory = "cache/shaders") noexcept;
+
+    const std::filesystem::path& getCachePath() const noexcept;
+    //! Empty when there is no entry or one of the included files changed since it was stored
+    std::optional<std::vector<uint32_t>> load() const noexcept;
+    bool store(const std::vector<uint32_t>& spirv, const std::vector<std::string>& includedFiles) const noexcept;
+
+ private:
+    uint64_t m_key = 0;
+    std::filesystem::path m_cachePath;
+};
+}  // namespace sge
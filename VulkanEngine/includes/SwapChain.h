@@ -47,7 +47,7 @@ class SwapChain {
     std::vector<VkFramebuffer> m_swapChainFramebuffers;
 
     std::vector<VkImage> m_depthImages;
-    std::vector<VkDeviceMemory> m_depthImageMemorys;
+    std::vector<MemoryAllocation> m_depthImageMemorys;
     std::vector<VkImageView> m_depthImageViews;
 
     std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> m_imageAvailableSemaphores;
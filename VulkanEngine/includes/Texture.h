@@ -1,8 +1,13 @@
 #pragma once
+#include "CompressedImage.h"
+#include "MemoryAllocator.h"
+
 #include <vulkan/vulkan_core.h>
 
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string_view>
 #include <vector>
 namespace sge {
@@ -17,41 +22,72 @@ class Texture {
         const std::string rightTexturePath;
     };
     enum class TextureType { Texture2D = 0, Cubemap };
-    Texture(const std::string_view texturePath);
+    //! Picks the block-compressed format a KTX2 / DDS file next to the source image may use:
+    //! BC5 for normal maps, BC7 / BC1 / BC3 for colors, BC7 / BC1 for packed data like metallic-roughness.
+    //! TextureCache bakes have no BC7 encoder, BC7 files only come from external tools
+    enum class Role { Color = 0, Normal, Data };
+    //! When the device supports BC formats, prefers the TextureCache bake of the image, then "name.ktx2" or
+    //! "name.dds" next to "name.png", as long as their format matches the role
+    Texture(const std::string_view texturePath, Role role = Role::Color);
     Texture(CubemapData&& texturePath);
+    //! 1x1 texture of one RGBA8 color
+    explicit Texture(const std::array<uint8_t, 4>& color);
+    //! Lets textures be decoded on worker threads and handed over to the owning map
+    Texture(Texture&& other) noexcept;
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+    Texture& operator=(Texture&&) = delete;
     ~Texture();
 
+    //! Set once from the device before any texture is loaded
+    static void setBlockCompressionSupported(bool supported) noexcept;
+
+    //! Null for cubemaps, their faces are only decoded by copyPixelsTo
     const void* getData() const noexcept;
+    //! Writes level 0 of every layer to destination. Cubemap faces are decoded in parallel and each one is copied
+    //! to its layer offset right away, so the whole image never exists outside destination
+    void copyPixelsTo(void* destination) const;
     size_t getImageSize() const noexcept;
     int getWidth() const noexcept;
     int getHeight() const noexcept;
+    //! Full chain down to 1x1, or 1 for textures like lookup tables that must not be prefiltered
+    uint32_t getMipLevels() const noexcept;
+    void setGenerateMips(bool generateMips) noexcept;
+    bool isCompressed() const noexcept;
+    //! Cubemaps and 1x1 textures are colors
+    Role getRole() const noexcept;
+    VkFormat getFormat() const noexcept;
+    //! Only valid for compressed textures until clearDataOnCPU
+    const CompressedImage& getCompressedImage() const noexcept;
     void clearDataOnCPU() noexcept;
     void setTextureImage(VkImage image) noexcept;
-    void setTextureImageMemory(VkDeviceMemory imageMemory) noexcept;
+    void setTextureImageMemory(const MemoryAllocation& imageMemory) noexcept;
     void setImageView(VkImageView imageView) noexcept;
     void setSampler(VkSampler sampler) noexcept;
     bool isProcessed() const noexcept;
-    std::array<void*, 6> getCubemapData() const noexcept;
     const TextureType getTextureType() const noexcept;
     VkDescriptorImageInfo getDescriptorInfo() const noexcept;
     VkSampler getSampler() noexcept;
     VkImage getTextureImage() noexcept;
-    VkDeviceMemory getTextureImageMemory() noexcept;
+    MemoryAllocation& getTextureImageMemory() noexcept;
     VkImageView getImageView() noexcept;
 
  private:
-    void* m_data;
-    std::vector<uint8_t> m_dataCubemap;
-    std::array<void*, 6> m_cubemapData;
+    bool loadCompressed(Role role);
+
+    void* m_data = nullptr;
     int m_texWidth;
     int m_texHeight;
     size_t m_imageSize;
     std::string m_texturePath;
+    std::optional<CompressedImage> m_compressedImage;
     CubemapData m_cubemapPath;
     TextureType m_textureType = TextureType::Texture2D;
+    Role m_role = Role::Color;
     bool m_isCPUdataPresent = true;
+    bool m_generateMips = true;
     VkImage m_textureImage = nullptr;
-    VkDeviceMemory m_textureImageMemory = nullptr;
+    MemoryAllocation m_textureImageMemory;
     VkImageView m_imageView = nullptr;
     VkSampler m_sampler = nullptr;
 };
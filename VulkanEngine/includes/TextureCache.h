@@ -0,0 +1,36 @@
+#pragma once
+#include "Texture.h"
+
+#include <cstdint>
+#include <filesystem>
+
+namespace sge {
+//! Baked KTX2 copies of source images, keyed by the source path, size and modification time and the texture role.
+//! Baking decodes the image, builds the mip chain in the space the role is sampled in (linear light for colors,
+//! renormalized vectors for normal maps) and block-compresses every level: BC5 for normal maps, BC1 / BC3
+//! (with alpha) for colors and BC1 for packed data. Colors are tagged sRGB so other KTX2 tools read them right,
+//! CompressedImage::getFormat says how the engine samples them.
+class TextureCache {
+ public:
+    static constexpr uint32_t VERSION = 2;
+
+    TextureCache(const std::filesystem::path& sourcePath, Texture::Role role,
+                 std::filesystem::path cacheDirectory = "cache/textures") noexcept;
+
+    bool isValid() const noexcept;
+    //! The baked file exists, it is still validated when loaded
+    bool isBaked() const noexcept;
+    const std::filesystem::path& getCachePath() const noexcept;
+    bool bake() const noexcept;
+    //! 2x2 box filter of an RGBA8 image in the space the role is sampled in, odd edges repeat their last texel.
+    //! dst holds max(srcWidth / 2, 1) x max(srcHeight / 2, 1) texels
+    static void downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst,
+                           Texture::Role role) noexcept;
+
+ private:
+    std::filesystem::path m_sourcePath;
+    Texture::Role m_role = Texture::Role::Color;
+    std::filesystem::path m_cachePath;
+    bool m_isValid = false;
+};
+}  // namespace sge
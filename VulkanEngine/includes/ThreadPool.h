@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sge {
+class ThreadPool {
+ public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    static ThreadPool& Instance() noexcept;
+    //! True when called from one of the pool workers
+    static bool isWorkerThread() noexcept;
+    size_t size() const noexcept;
+
+    //! Tasks submitted from a worker run inline, so nested waits can't starve the pool
+    template <typename Func>
+    [[nodiscard]] auto submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>> {
+        using ResultType = std::invoke_result_t<std::decay_t<Func>>;
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+        auto future = task->get_future();
+        if (isWorkerThread() || m_workers.empty()) {
+            (*task)();
+            return future;
+        }
+        {
+            std::scoped_lock lock(m_mutex);
+            m_tasks.emplace([task]() { (*task)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+ private:
+    void workerLoop() noexcept;
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+};
+}  // namespace sge
@@ -0,0 +1,39 @@
+#pragma once
+#include "Buffer.h"
+#include "Device.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace sge {
+//! Persistently mapped uniform buffer split into one region per frame in flight. Per-frame data is
+//! bump-allocated from the current region and bound through UNIFORM_BUFFER_DYNAMIC descriptors by offset,
+//! so the CPU never overwrites constants a previous frame is still reading.
+class UniformRing {
+ public:
+    static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 64ull << 10;
+
+    UniformRing(Device& device, uint32_t frameCount, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE);
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    //! Rewinds to the region of frameIndex. The fence of the frame that used it last must already be waited on
+    void beginFrame(uint32_t frameIndex) noexcept;
+    //! Copies the data into the current region and returns the dynamic offset to bind it at
+    uint32_t push(const void* data, VkDeviceSize size);
+    template <typename T>
+    uint32_t push(const T& data) {
+        return push(&data, sizeof(T));
+    }
+    //! For descriptor writes, the dynamic offset passed at bind time selects the actual range
+    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+
+ private:
+    VkDeviceSize m_alignment;
+    VkDeviceSize m_frameSize;
+    uint32_t m_frameCount;
+    std::unique_ptr<Buffer> m_buffer;
+    VkDeviceSize m_frameBegin = 0;
+    VkDeviceSize m_head = 0;
+};
+}  // namespace sge
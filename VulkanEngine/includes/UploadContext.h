@@ -0,0 +1,84 @@
+#pragma once
+#include "Buffer.h"
+#include "Device.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sge {
+//! Records staging copies and layout transitions into one command buffer and submits them as a batch.
+//! Staging buffers stay alive until the batch's fence signals. A context belongs to the thread using it.
+//! With a dedicated transfer queue the copies run there, and a small graphics submit waiting on a semaphore
+//! acquires ownership of the written buffer ranges and images.
+class UploadContext {
+ public:
+    //! Staging memory a batch may hold before it is submitted on its own
+    static constexpr VkDeviceSize MAX_BATCH_STAGING_SIZE = 256ull << 20;
+
+    explicit UploadContext(Device& device);
+    //! Submits what is left and waits for every batch
+    ~UploadContext();
+    UploadContext(const UploadContext&) = delete;
+    UploadContext& operator=(const UploadContext&) = delete;
+
+    //! Mapped host-visible buffer owned by the current batch
+    Buffer& createStagingBuffer(VkDeviceSize size);
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
+                           uint32_t layerCount = 1);
+    //! E.g. one region per prefiltered mip level
+    void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions);
+    void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                               uint32_t layerCount = 1, uint32_t mipLevels = 1);
+    //! Blits level 0 down the whole chain and leaves every level in SHADER_READ_ONLY_OPTIMAL. All levels have to
+    //! be in TRANSFER_DST_OPTIMAL, and the format must support linear blits. Blits need a graphics queue, so with a
+    //! dedicated transfer queue the chain is built right after the image is acquired.
+    void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount = 1);
+    //! Command buffer of the current batch, for transfer commands the helpers above don't cover
+    VkCommandBuffer getCommandBuffer();
+
+    void submit();
+    //! Submits and blocks until all batches have executed
+    void flush();
+
+ private:
+    struct MipChain {
+        VkImage image = VK_NULL_HANDLE;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        uint32_t layerCount = 1;
+    };
+
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        //! Graphics queue side of the ownership transfer, unused without a dedicated transfer queue
+        VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore transferDone = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+        VkDeviceSize stagingSize = 0;
+        std::vector<VkBufferMemoryBarrier> bufferTransfers;
+        std::vector<VkImageMemoryBarrier> imageTransfers;
+        //! Recorded into acquireCommandBuffer
+        std::vector<MipChain> mipChains;
+    };
+
+    Batch& getRecordingBatch();
+    void submitOwnershipTransfer(Batch& batch);
+    static void recordMipChain(VkCommandBuffer commandBuffer, const MipChain& chain);
+    void releaseFinishedBatches(bool wait);
+
+    Device& m_device;
+    bool m_dedicatedTransfer = false;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_graphicsFamily = 0;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    VkCommandPool m_acquireCommandPool = VK_NULL_HANDLE;
+    std::optional<Batch> m_recordingBatch;
+    std::vector<Batch> m_submittedBatches;
+    //! Finished batches, their command buffer and fence get reused
+    std::vector<Batch> m_freeBatches;
+};
+}  // namespace sge
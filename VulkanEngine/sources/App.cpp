@@ -2,6 +2,7 @@
 
 #include "../../../bindings/imgui_impl_glfw.h"
 #include "../../../bindings/imgui_impl_vulkan.h"
+#include "BindlessTextures.h"
 #include "Buffer.h"
 #include "GLFW/glfw3.h"
 #include "Logger.h"
@@ -11,16 +12,265 @@
 #include "VulkanHelpUtils.h"
 #include "RenderSystem.h"
 #include "ResourceSystem.h"
+#include "ThreadPool.h"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <future>
 #include <iterator>
+#include <limits>
 #include <numeric>
+#include <span>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace sge {
+namespace {
+constexpr VkPushConstantRange MESH_PUSH_CONSTANT_RANGE{.stageFlags = VK_SHADER_STAGE_VERTEX_BIT |
+                                                                     VK_SHADER_STAGE_FRAGMENT_BIT,
+                                                       .offset = 0,
+                                                       .size = sizeof(MeshPushConstants)};
+
+// A LOD is kept until its error leaves the threshold by this fraction, so meshes don't flicker between levels
+constexpr float LOD_HYSTERESIS = 0.25f;
+constexpr std::array LOD_DEBUG_COLORS{glm::vec4(0.f, 1.f, 0.f, 0.5f), glm::vec4(1.f, 1.f, 0.f, 0.5f),
+                                      glm::vec4(1.f, 0.5f, 0.f, 0.5f), glm::vec4(1.f, 0.f, 0.f, 0.5f),
+                                      glm::vec4(1.f, 0.f, 1.f, 0.5f)};
+
+//! Texture maps of a material with the role each one is loaded with
+std::array<std::tuple<bool, const std::string*, Texture::Role>, 4> materialTextures(const Mesh::Material& material) {
+    return {std::tuple{material.m_hasColorMap, &material.m_baseColorPath, Texture::Role::Color},
+            std::tuple{material.m_hasMetallicRoughnessMap, &material.m_MetallicRoughnessPath, Texture::Role::Data},
+            std::tuple{material.m_hasNormalMap, &material.m_NormalPath, Texture::Role::Normal},
+            std::tuple{material.m_hasEmissiveMap, &material.m_EmissivePath, Texture::Role::Color}};
+}
+
+constexpr std::array MATERIAL_MODE_NAMES{"Defines", "Specialization", "Dynamic", "Bindless"};
+
+// Stand-ins for missing maps, in BindlessTextures slot order (see BindlessTextures::WHITE_TEXTURE)
+constexpr std::array<std::pair<const char*, std::array<uint8_t, 4>>, 3> DEFAULT_TEXTURES{
+    {{"default_white", {255, 255, 255, 255}}, {"default_black", {0, 0, 0, 255}},
+     {"default_flat_normal", {128, 128, 255, 255}}}};
+constexpr const char* DEFAULT_WHITE_TEXTURE = DEFAULT_TEXTURES[0].first;
+constexpr const char* DEFAULT_BLACK_TEXTURE = DEFAULT_TEXTURES[1].first;
+constexpr const char* DEFAULT_FLAT_NORMAL_TEXTURE = DEFAULT_TEXTURES[2].first;
+
+uint32_t materialFlags(const Mesh::Material& material) noexcept {
+    uint32_t flags = 0;
+    if (material.m_hasColorMap) flags |= MATERIAL_COLOR_MAP;
+    if (material.m_hasMetallicRoughnessMap) flags |= MATERIAL_METALLIC_ROUGHNESS_MAP;
+    if (material.m_hasNormalMap) flags |= MATERIAL_NORMAL_MAP;
+    if (material.m_hasEmissiveMap) flags |= MATERIAL_EMISSIVE_MAP;
+    if (material.m_hasOcclusionMap) flags |= MATERIAL_OCCLUSION_MAP;
+    return flags;
+}
+
+//! Meshes with equal keys get the same descriptor set and pipeline. Bindless materials reach their textures
+//! through ObjectData, so only the shader tells them apart
+std::string materialKey(const Mesh& mesh, const App::MaterialMode mode) {
+    std::string key = std::to_string(static_cast<int>(mode)) + '|' +
+                      std::to_string(static_cast<int>(mesh.m_materialType)) + '|' +
+                      std::to_string(static_cast<int>(mesh.m_vertexFormat));
+    if (mode == App::MaterialMode::Bindless) return key;
+    for (const auto& [hasMap, texturePath, role] : materialTextures(mesh.m_material)) {
+        key += '|';
+        if (hasMap) key += *texturePath;
+    }
+    if (mesh.m_material.m_hasOcclusionMap) key += "|occlusion";
+    return key;
+}
+
+//! Decoding dominates texture loading and scales with cores, so every texture the batch is missing is decoded on
+//! the pool up front. Uploads stay on the calling thread and go through its upload context afterwards. Streamed
+//! models are published with their textures resident, so it finds nothing to decode for them
+void decodeTextures(const std::vector<Mesh>& meshes, std::unordered_map<std::string, Texture>& textures) {
+    std::unordered_set<std::string> queued;
+    std::vector<std::pair<std::string, std::future<Texture>>> decodes;
+    for (const auto& mesh : meshes) {
+        for (const auto& [hasMap, texturePath, role] : materialTextures(mesh.m_material)) {
+            if (!hasMap || textures.contains(*texturePath) || !queued.insert(*texturePath).second) continue;
+            decodes.emplace_back(*texturePath, ThreadPool::Instance().submit([path = *texturePath, role = role]() {
+                                     return Texture(path, role);
+                                 }));
+        }
+    }
+    for (auto& [path, decode] : decodes) textures.try_emplace(path, decode.get());
+}
+
+//! pixelsPerUnit is the screen height in pixels covered by one world unit at distance one. The distance is taken to
+//! the cached bounds of all instances, which is never farther than the closest instance
+float lodErrorToPixels(const Mesh& mesh, const glm::vec3& cameraPosition, const float pixelsPerUnit) noexcept {
+    const auto& bounds = mesh.m_instanceBounds;
+    const float distance = glm::length(cameraPosition - glm::clamp(cameraPosition, bounds.min, bounds.max));
+    if (distance <= 0.f) return std::numeric_limits<float>::max();
+    // Simplification errors are relative to the largest mesh dimension
+    const glm::vec3 extent = mesh.m_boundingBox.max - mesh.m_boundingBox.min;
+    return std::max({extent.x, extent.y, extent.z}) * mesh.m_maxInstanceScale * pixelsPerUnit / distance;
+}
+
+//! All instances share one LOD, chosen for the instance closest to the camera
+uint32_t selectLod(const Mesh& mesh, const glm::vec3& cameraPosition, const float pixelsPerUnit,
+                   const float maxPixelError) noexcept {
+    if (mesh.m_lods.size() < 2) return 0;
+    const float errorToPixels = lodErrorToPixels(mesh, cameraPosition, pixelsPerUnit);
+
+    auto coarsestWithin = [&](const float pixelError) {
+        uint32_t lod = 0;
+        while (lod + 1 < mesh.m_lods.size() && mesh.m_lods[lod + 1].error * errorToPixels <= pixelError) ++lod;
+        return lod;
+    };
+
+    const uint32_t currentLod = std::min<uint32_t>(mesh.m_currentLod, static_cast<uint32_t>(mesh.m_lods.size() - 1));
+    if (mesh.m_lods[currentLod].error * errorToPixels > maxPixelError * (1.f + LOD_HYSTERESIS))
+        return coarsestWithin(maxPixelError);
+    return std::max(currentLod, coarsestWithin(maxPixelError * (1.f - LOD_HYSTERESIS)));
+}
+
+void destroyTexture(const Device& device, Texture& texture) noexcept {
+    vkDestroyImage(device.device(), texture.getTextureImage(), nullptr);
+    device.freeMemory(texture.getTextureImageMemory());
+    vkDestroyImageView(device.device(), texture.getImageView(), nullptr);
+    vkDestroySampler(device.device(), texture.getSampler(), nullptr);
+}
+
+void destroyPipeline(const Device& device, PipelineInfo& pipeline) noexcept {
+    pipeline.pipeline.reset();
+    vkDestroyPipelineLayout(device.device(), pipeline.pipelineLayout, nullptr);
+}
+
+//! Mesh vertex stream in the given format plus the per-instance transform stream
+PipelineInputData::VertexData getVertexData(const Mesh::VertexFormat vertexFormat) {
+    auto bindings = vertexFormat == Mesh::VertexFormat::Quantized ? QuantizedVertex::getBindingDescription()
+                                                                  : Vertex::getBindingDescription();
+    auto attributes = vertexFormat == Mesh::VertexFormat::Quantized ? QuantizedVertex::getAttributeDescription()
+                                                                    : Vertex::getAttributeDescription();
+    const auto instanceBindings = InstanceData::getBindingDescription();
+    const auto instanceAttributes = InstanceData::getAttributeDescription();
+    bindings.insert(bindings.end(), instanceBindings.begin(), instanceBindings.end());
+    attributes.insert(attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+    return {std::move(bindings), std::move(attributes)};
+}
 
+std::string getVertexDefines(const Mesh::VertexFormat vertexFormat) {
+    return vertexFormat == Mesh::VertexFormat::Quantized ? "#define QUANTIZED_VERTEX\n" : "";
+}
+
+//! Only the Defines mode gets a permutation per set of maps, the others select the maps' code at a later point
+std::string getFragmentDefines(const Mesh& mesh, const App::MaterialMode mode) {
+    std::string defines;
+    switch (mode) {
+        case App::MaterialMode::Defines:
+            if (mesh.m_material.m_hasColorMap) defines += "#define HAS_COLOR_MAP\n";
+            if (mesh.m_material.m_hasMetallicRoughnessMap) defines += "#define HAS_METALLIC_ROUGHNESS_MAP\n";
+            if (mesh.m_material.m_hasNormalMap) defines += "#define HAS_NORMAL_MAP\n";
+            if (mesh.m_material.m_hasEmissiveMap) defines += "#define HAS_EMISSIVE_MAP\n";
+            if (mesh.m_material.m_hasOcclusionMap) defines += "#define HAS_OCCLUSION_MAP\n";
+            break;
+        case App::MaterialMode::Specialization: defines += "#define MATERIAL_SPECIALIZATION\n"; break;
+        case App::MaterialMode::Dynamic: defines += "#define MATERIAL_DYNAMIC\n"; break;
+        case App::MaterialMode::Bindless: defines += "#define BINDLESS\n"; break;
+    }
+    switch (mesh.m_materialType) {
+        case Mesh::MaterialType::Phong: defines += "#define Phong\n"; break;
+        case Mesh::MaterialType::PBR: defines += "#define PBR\n"; break;
+    }
+    return defines;
+}
+
+ShaderDefines getMeshShaderDefines(const Mesh& mesh, const App::MaterialMode mode) {
+    ShaderDefines defines{getVertexDefines(mesh.m_vertexFormat), getFragmentDefines(mesh, mode)};
+    // constant_id order of the MATERIAL_SPECIALIZATION block in the mesh shaders
+    if (mode == App::MaterialMode::Specialization) {
+        const auto& material = mesh.m_material;
+        defines.fragmentSpecialization = {material.m_hasColorMap, material.m_hasMetallicRoughnessMap,
+                                          material.m_hasNormalMap, material.m_hasEmissiveMap,
+                                          material.m_hasOcclusionMap};
+    }
+    return defines;
+}
+
+//! Equal SPIR-V, specialization constants aside
+bool sameSource(const ShaderDefines& lhs, const ShaderDefines& rhs) noexcept {
+    return lhs.vertShaderDefines == rhs.vertShaderDefines && lhs.fragmentShaderDefines == rhs.fragmentShaderDefines &&
+           lhs.geometryShaderDefines == rhs.geometryShaderDefines;
+}
+
+//! Set 0 of a non-bindless mesh pipeline. Identically defined layouts are compatible, so pipelines are shared
+//! between materials whose layouts were built separately
+std::unique_ptr<DescriptorSetLayout> createMaterialSetLayout(Device& device, const Mesh& mesh,
+                                                             const bool bindAllMaps) {
+    auto descriptorLayoutBuilder =
+        DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(100, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);  // debug
+
+    if (mesh.m_material.m_hasColorMap || bindAllMaps)
+        descriptorLayoutBuilder.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (mesh.m_material.m_hasMetallicRoughnessMap || bindAllMaps)
+        descriptorLayoutBuilder.addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (mesh.m_material.m_hasNormalMap || bindAllMaps)
+        descriptorLayoutBuilder.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (mesh.m_material.m_hasEmissiveMap || bindAllMaps)
+        descriptorLayoutBuilder.addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    descriptorLayoutBuilder.addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       VK_SHADER_STAGE_FRAGMENT_BIT);  // skybox map
+    descriptorLayoutBuilder.addBinding(9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       VK_SHADER_STAGE_FRAGMENT_BIT);  // skybox irradiance map
+    descriptorLayoutBuilder.addBinding(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       VK_SHADER_STAGE_FRAGMENT_BIT);  // brdfLUT
+
+    return descriptorLayoutBuilder.build();
+}
+
+//! MeshMGR::m_pipelines entries are named after their index
+void nameMeshPipeline(PipelineInfo& pipeline, const size_t pipelineId) {
+    pipeline.name = std::to_string(pipelineId) + " " + pipeline.name;
+    LOG_MSG("Pipeline name: " << pipeline.name << ": " << pipeline.pipeline->getShader().getFragmentShaderPath())
+}
+
+//! Not compiled yet, see compileMeshShaders
+Shader createMeshShader(const Mesh::MaterialType materialType, const ShaderDefines& defines) {
+    if (materialType == Mesh::MaterialType::PBR)
+        return Shader(Shader::Deferred{}, "data/Shaders/GLSL/PBR/PBR.vert", "data/Shaders/GLSL/PBR/PBR.frag", "",
+                      defines);
+    return Shader(Shader::Deferred{}, "data/Shaders/GLSL/Phong/phong.vert", "data/Shaders/GLSL/Phong/phong.frag", "",
+                  defines);
+}
+
+//! Every shader permutation the batch needs that no pipeline has yet, compiled up front with all stages of all of
+//! them running on the pool at once. The mesh loop only creates pipelines from them afterwards. Specializations
+//! of one source compile once
+std::vector<Shader> compileMeshShaders(const std::vector<Mesh>& meshes, const App::MaterialMode mode,
+                                       const std::vector<PipelineInfo>& pipelines) {
+    std::vector<Shader> shaders;
+    for (const auto& mesh : meshes) {
+        const ShaderDefines defines = getMeshShaderDefines(mesh, mode);
+        const auto hasSource = [&defines](const Shader& shader) { return sameSource(shader.getDefines(), defines); };
+        const auto pipelineHasSource = [&](const PipelineInfo& pipeline) {
+            return hasSource(pipeline.pipeline->getShader());
+        };
+        if (std::ranges::any_of(shaders, hasSource) || std::ranges::any_of(pipelines, pipelineHasSource)) continue;
+        shaders.push_back(createMeshShader(mesh.m_materialType, defines));
+    }
+    Shader::compileAll(shaders);
+    return shaders;
+}
+}  // namespace
     
 void App::initPipelines() {
     RenderSystem::Instance();
@@ -53,37 +303,21 @@ void App::initPipelines() {
     WorkFlow simple_workflow("Simple_workflow");
     { //For Pipeline 0 - Process meshes (Phong shaders)
         auto descriptorLayoutBuilder = DescriptorSetLayout::Builder(m_device)
-                                           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-                                           .addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+                                           .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
                                                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
         auto descriptorLayout = descriptorLayoutBuilder.build();
 
-        auto uboBuffer = std::make_unique<Buffer>(m_device, sizeof(PBRUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        uboBuffer->map();
-
-        auto globalBufferInfo = mgr.m_generalMatrixUBO->descriptorInfo();
-        auto bufferInfo = uboBuffer->descriptorInfo();
+        auto globalBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(GlobalUbo));
+        auto objectBufferInfo = mgr.m_objects->descriptorInfo();
 
         auto DW = DescriptorWriter(*descriptorLayout, mgr.getDescriptorPool())
                       .writeBuffer(0, &globalBufferInfo)
-                      .writeBuffer(1, &bufferInfo);
+                      .writeBuffer(1, &objectBufferInfo);
 
         VkDescriptorSet descriptorSet;
         DW.build(descriptorSet);
 
-        PBRUbo ubo = {.modelMatrix = glm::mat4{38.f},
-                      .normalMatrix = glm::mat4{38.f},
-                      .baseColor = glm::vec4(1.f, 0.f, 1.f, 1.f),
-                      .lightDirection = glm::vec4(1.f, 0.f, 0.f, 0.f),
-                      .metallic = 0.5f,
-                      .roughness = 0.5f};
-
-        uboBuffer->writeToBuffer(&ubo);
-        uboBuffer->flush();
-        
-        resourceSystem.addConstantBuffer(std::move(uboBuffer));
-
         FrameBuffer firstFB(m_device, m_window.getExtent().width, m_window.getExtent().height);
         firstFB.createAttachment(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
         firstFB.createAttachment(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true);
@@ -91,16 +325,27 @@ void App::initPipelines() {
 
         auto framebufferID = resourceSystem.addFramebuffer(std::move(firstFB));
         auto renderPass = resourceSystem.getFrameBufferByID(framebufferID).getRenderPass();
+        m_meshFramebufferID = framebufferID;
 
-        PipelineInputData::VertexData vertexData(Vertex::getBindingDescription(), Vertex::getAttributeDescription());
+        PipelineInputData::VertexData vertexData = getVertexData(Mesh::VertexFormat::Float);
         PipelineInputData::ColorBlendData colorBlendData(Pipeline::createDefaultColorAttachments());
-        auto pipelineLayout = Pipeline::createPipeLineLayout(m_device.device(), descriptorLayout->getDescriptorSetLayout());
+        auto pipelineLayout = Pipeline::createPipeLineLayout(
+            m_device.device(), descriptorLayout->getDescriptorSetLayout(), {MESH_PUSH_CONSTANT_RANGE});
         PipelineInputData::FixedFunctionsStages fixedFunctionStages(m_window.getExtent().width,
                                                                     m_window.getExtent().height);
 
         fixedFunctionStages.setCullingData(CullingMode::FRONT, FrontFace::CLOCKWISE);
         fixedFunctionStages.setDepthData(true, CompareOp::LESS, true, false);
         Shader glslPhongShader("data/Shaders/GLSL/Phong/phong.vert", "data/Shaders/GLSL/Phong/phong.frag");
+        Shader glslQuantizedPhongShader("data/Shaders/GLSL/Phong/phong.vert", "data/Shaders/GLSL/Phong/phong.frag",
+                                        "", {getVertexDefines(Mesh::VertexFormat::Quantized), ""});
+
+        PipelineInputData quantizedPipelineData{getVertexData(Mesh::VertexFormat::Quantized),
+                                                std::move(glslQuantizedPhongShader),
+                                                PipelineInputData::ColorBlendData(colorBlendData),
+                                                pipelineLayout,
+                                                PipelineInputData::FixedFunctionsStages(fixedFunctionStages),
+                                                renderPass};
 
         PipelineInputData pipeline_data{
             vertexData,    
@@ -113,12 +358,20 @@ void App::initPipelines() {
 
         auto descriptorID = resourceSystem.addDescriptor({.layout = std::move(descriptorLayout), .set = descriptorSet});
 
+        auto quantizedPipelineID = resourceSystem.addPipeline({
+            .name = "Phong first stage pipeline (quantized vertices)",
+            .pipelineLayout = pipelineLayout,
+            .pipeline = Pipeline(m_device, std::move(quantizedPipelineData)),
+            .descriptorID = descriptorID,
+            .framebufferID = framebufferID
+        });
         auto pipelineID = resourceSystem.addPipeline({
             .name = "Phong first stage pipeline",
             .pipelineLayout = pipelineLayout,
             .pipeline = Pipeline(m_device, std::move(pipeline_data)),
             .descriptorID = descriptorID,
-            .framebufferID = framebufferID
+            .framebufferID = framebufferID,
+            .quantizedVariantID = quantizedPipelineID
         });
         simple_workflow.addNextFrame(pipelineID, 0, 0, true, true); //check VB/IB
     }
@@ -213,6 +466,7 @@ void App::initPipelines() {
 
 App::App(glm::ivec2 windowSize, std::string windowName) : m_window(windowSize.x, windowSize.y, std::move(windowName)) {
     initEvents();
+    Texture::setBlockCompressionSupported(m_device.supportsBlockCompression());
 
 
     m_camera.setViewCircleCamera(-15.f, 5.f);
@@ -223,15 +477,13 @@ App::App(glm::ivec2 windowSize, std::string windowName) : m_window(windowSize.x,
     mgr.setDescriptorPool(DescriptorPool::Builder(m_device)
                               .setMaxSets(1024)
                               .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024)
+                              .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1024)
+                              .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1024)
                               .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024)
                               .build());
 
-    mgr.m_generalMatrixUBO = std::make_unique<Buffer>(
-        m_device, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    mgr.m_generalMatrixUBO->map();
-    mgr.m_debugUBO = std::make_unique<Buffer>(m_device, sizeof(DebugUBO), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    mgr.m_debugUBO->map();
+    mgr.m_frameUniforms = std::make_unique<UniformRing>(m_device, SwapChain::MAX_FRAMES_IN_FLIGHT);
+    mgr.m_objects = std::make_unique<ObjectBuffer>(m_device, SwapChain::MAX_FRAMES_IN_FLIGHT);
     mgr.m_normalTestUBO = std::make_unique<Buffer>(
         m_device, sizeof(NormalTestInfo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
     mgr.m_normalTestUBO->map();
@@ -239,24 +491,119 @@ App::App(glm::ivec2 windowSize, std::string windowName) : m_window(windowSize.x,
 
     initPipelines();
 
-    addSkybox();
+    UploadContext uploadContext(m_device);
+    addSkybox(uploadContext);
     addNormalTestPipeline();
     auto brdfLUT = mgr.m_textures.try_emplace("brdfLUT", "data/brdfLUT.png");
-    if (!brdfLUT.first->second.isProcessed()) m_model->createTexture(brdfLUT.first->second);
+    // A lookup table is sampled exactly, prefiltering it would blend unrelated entries
+    brdfLUT.first->second.setGenerateMips(false);
+    if (!brdfLUT.first->second.isProcessed()) m_model->createTexture(brdfLUT.first->second, uploadContext);
+    initDefaultTextures(uploadContext);
+    if (m_device.supportsDescriptorIndexing()) {
+        initBindlessTextures(uploadContext);
+        m_materialMode = MaterialMode::Bindless;
+    }
+}
+
+void App::initDefaultTextures(UploadContext& uploadContext) {
+    auto& textures = MeshMGR::Instance().m_textures;
+    for (const auto& [name, color] : DEFAULT_TEXTURES) {
+        auto texturePair = textures.try_emplace(name, color);
+        if (!texturePair.first->second.isProcessed()) m_model->createTexture(texturePair.first->second, uploadContext);
+    }
+}
+
+void App::initBindlessTextures(UploadContext& uploadContext) {
+    auto& mgr = MeshMGR::Instance();
+    mgr.m_bindlessTextures = std::make_unique<BindlessTextures>(m_device);
+    for (const auto& [name, color] : DEFAULT_TEXTURES) {
+        [[maybe_unused]] const auto slot =
+            mgr.m_bindlessTextures->add(name, mgr.m_textures.at(name).getDescriptorInfo());
+        assert(slot && "The default textures fit any device");
+    }
+    assert(mgr.m_bindlessTextures->size() == BindlessTextures::FLAT_NORMAL_TEXTURE + 1);
+
+    // Frame data and environment maps, shared by every bindless material
+    auto descriptorLayout = DescriptorSetLayout::Builder(m_device)
+                                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+                                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                                            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                                .addBinding(100, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)  // debug
+                                .addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            VK_SHADER_STAGE_FRAGMENT_BIT)  // skybox map
+                                .addBinding(9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            VK_SHADER_STAGE_FRAGMENT_BIT)  // skybox irradiance map
+                                .addBinding(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            VK_SHADER_STAGE_FRAGMENT_BIT)  // brdfLUT
+                                .build();
+    auto globalBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(GlobalUbo));
+    auto objectBufferInfo = mgr.m_objects->descriptorInfo();
+    auto debuggerBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(DebugUBO));
+    auto skyboxDescriptorInfo = mgr.m_textures.at("skybox").getDescriptorInfo();
+    auto skyboxIrradianceDescriptorInfo = mgr.m_textures.at("skybox_irradiance").getDescriptorInfo();
+    auto brdfLUTDescriptorInfo = mgr.m_textures.at("brdfLUT").getDescriptorInfo();
+    VkDescriptorSet descriptorSet;
+    DescriptorWriter(*descriptorLayout, mgr.getDescriptorPool())
+        .writeBuffer(0, &globalBufferInfo)
+        .writeBuffer(1, &objectBufferInfo)
+        .writeBuffer(100, &debuggerBufferInfo)
+        .writeImage(8, &skyboxDescriptorInfo)
+        .writeImage(9, &skyboxIrradianceDescriptorInfo)
+        .writeImage(10, &brdfLUTDescriptorInfo)
+        .build(descriptorSet);
+    mgr.m_sets.emplace_back(std::move(descriptorLayout), descriptorSet);
+    m_bindlessDescriptorSetId = static_cast<uint32_t>(mgr.m_sets.size() - 1);
+}
+
+std::optional<uint32_t> App::addBindlessTexture(const std::string& path, Texture::Role role,
+                                                UploadContext& uploadContext) {
+    auto& mgr = MeshMGR::Instance();
+    auto texturePair = mgr.m_textures.try_emplace(path, path, role);
+    if (!texturePair.first->second.isProcessed()) m_model->createTexture(texturePair.first->second, uploadContext);
+    return mgr.m_bindlessTextures->add(path, texturePair.first->second.getDescriptorInfo());
+}
+
+bool App::setBindlessTextures(const Mesh::Material& material, ObjectData& object, UploadContext& uploadContext) {
+    const auto slot = [&](const bool hasMap, const std::string& path, const Texture::Role role,
+                          const uint32_t missingSlot) -> std::optional<uint32_t> {
+        return hasMap ? addBindlessTexture(path, role, uploadContext) : missingSlot;
+    };
+    const auto baseColor = slot(material.m_hasColorMap, material.m_baseColorPath, Texture::Role::Color,
+                                BindlessTextures::WHITE_TEXTURE);
+    const auto metallicRoughness = slot(material.m_hasMetallicRoughnessMap, material.m_MetallicRoughnessPath,
+                                        Texture::Role::Data, BindlessTextures::WHITE_TEXTURE);
+    const auto normal = slot(material.m_hasNormalMap, material.m_NormalPath, Texture::Role::Normal,
+                             BindlessTextures::FLAT_NORMAL_TEXTURE);
+    const auto emissive = slot(material.m_hasEmissiveMap, material.m_EmissivePath, Texture::Role::Color,
+                               BindlessTextures::BLACK_TEXTURE);
+    if (!baseColor || !metallicRoughness || !normal || !emissive) return false;
+    object.baseColorTexture = *baseColor;
+    object.metallicRoughnessTexture = *metallicRoughness;
+    object.normalTexture = *normal;
+    object.emissiveTexture = *emissive;
+    // Occlusion is packed into the red channel of the metallic-roughness map
+    object.occlusionTexture =
+        material.m_hasOcclusionMap ? object.metallicRoughnessTexture : BindlessTextures::WHITE_TEXTURE;
+    return true;
 }
 
 App::~App() {
+    // Unfinished background loads still own device resources
+    for (auto& streamedModel : m_streamedModels) {
+        auto model = streamedModel.get();
+        for (auto& texture : model.textures) destroyTexture(m_device, texture.second);
+        for (auto& pipeline : model.pipelines.pipelines) destroyPipeline(m_device, pipeline);
+    }
+    for (auto& model : m_heldStreamedModels)
+        for (auto& pipeline : model.pipelines.pipelines) destroyPipeline(m_device, pipeline);
     auto& mgr = MeshMGR::Instance();
     for (auto& pipeline : mgr.m_pipelines) 
         vkDestroyPipelineLayout(m_device.device(), pipeline.pipelineLayout, nullptr);
     
-    for (auto& textures : mgr.m_textures) {
-        vkDestroyImage(m_device.device(), textures.second.getTextureImage(), nullptr);
-        vkFreeMemory(m_device.device(), textures.second.getTextureImageMemory(), nullptr);
-        vkDestroyImageView(m_device.device(), textures.second.getImageView(), nullptr);
-        vkDestroySampler(m_device.device(), textures.second.getSampler(), nullptr);
-    }
+    for (auto& textures : mgr.m_textures) destroyTexture(m_device, textures.second);
     mgr.clearTable();
+    ResourceSystem::Instance().clear();
 }
 
 void App::renderObjects(VkCommandBuffer commandBuffer, uint32_t pipelineID, bool hasVertexInput) noexcept {
@@ -265,8 +612,10 @@ void App::renderObjects(VkCommandBuffer commandBuffer, uint32_t pipelineID, bool
 
     auto& pipeline1 = resourceSystem.getPipeline(pipelineID);
     pipeline1.pipeline.bind(commandBuffer);
+    auto& descriptor = resourceSystem.getDescriptor(pipeline1.descriptorID);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline1.pipelineLayout, 0, 1,
-                            &resourceSystem.getDescriptor(pipeline1.descriptorID).set, 0, nullptr);
+                            &descriptor.set, descriptor.layout->getDynamicOffsetCount(),
+                            m_frameUniformOffsets.data());
     VkViewport viewPort;
     viewPort.x = 0.f;
     viewPort.y = 0.f;
@@ -283,38 +632,94 @@ void App::renderObjects(VkCommandBuffer commandBuffer, uint32_t pipelineID, bool
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
     if (hasVertexInput == true) {
-        for (auto& mesh : mgr.m_meshes) {
-            m_model->bind(commandBuffer, mesh);
+        const float pixelsPerUnit = std::abs(m_camera.getProjection()[1][1]) * 0.5f * viewPort.height;
+        // Vertex and index bindings survive pipeline switches, so the pool blocks are bound once per pass
+        Model::GeometryBinding boundGeometry;
+        const auto drawMesh = [&](Mesh& mesh, const VkPipelineLayout pipelineLayout) {
+            mesh.m_currentLod = selectLod(mesh, m_camera.getCameraPos(), pixelsPerUnit, m_lodPixelError);
+            MeshPushConstants pushConstants{.positionScale = glm::vec4(mesh.m_positionScale, 0.f),
+                                            .positionOffset = glm::vec4(mesh.m_positionOffset, 0.f),
+                                            .objectIndex = mesh.m_objectIndex};
+            if (m_showLods && !mesh.m_lods.empty())
+                pushConstants.lodDebugColor =
+                    LOD_DEBUG_COLORS[std::min<size_t>(mesh.m_currentLod, LOD_DEBUG_COLORS.size() - 1)];
+            vkCmdPushConstants(commandBuffer, pipelineLayout, MESH_PUSH_CONSTANT_RANGE.stageFlags, 0,
+                               sizeof(pushConstants), &pushConstants);
+            m_model->bind(commandBuffer, mesh, boundGeometry);
             m_model->draw(commandBuffer, mesh);
+            ++m_frameStatistics.drawCount;
+        };
+        const auto hasMaterialPipeline = [&mgr](const Mesh& mesh) {
+            return mesh.getPipelineId() < mgr.m_pipelines.size();
+        };
+        const auto isBindless = [&](const Mesh& mesh) {
+            return mgr.m_bindlessTextures != nullptr && mesh.getDescriptorSetId() == m_bindlessDescriptorSetId;
+        };
+
+        // Meshes whose material shader didn't compile fall back to the workflow's pipeline and set bound above.
+        // Variants share the pipeline layout, so the bound descriptor set stays valid across the switch
+        uint32_t boundPipelineID = pipelineID;
+        for (auto& mesh : mgr.m_meshes) {
+            if (hasMaterialPipeline(mesh)) continue;
+            uint32_t meshPipelineID = pipelineID;
+            if (mesh.m_vertexFormat == Mesh::VertexFormat::Quantized && pipeline1.quantizedVariantID)
+                meshPipelineID = *pipeline1.quantizedVariantID;
+            if (meshPipelineID != boundPipelineID) {
+                resourceSystem.getPipeline(meshPipelineID).pipeline.bind(commandBuffer);
+                boundPipelineID = meshPipelineID;
+                ++m_frameStatistics.pipelineBindCount;
+            }
+            drawMesh(mesh, pipeline1.pipelineLayout);
         }
-    } else {
-        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-    }
-    /*for (auto& mesh : mgr.m_meshes) {
-        mgr.m_pipelines[mesh.getPipelineId()].pipeline->bind(commandBuffer);
 
+        // Bindless pipelines are created from the same set layouts, so both sets are bound once for all of them.
+        // They are drawn before the other materials rebind set 0
+        const Pipeline* boundPipeline = nullptr;
+        bool bindlessSetsBound = false;
+        for (auto& mesh : mgr.m_meshes) {
+            if (!hasMaterialPipeline(mesh) || !isBindless(mesh)) continue;
+            const auto& meshPipeline = mgr.m_pipelines[mesh.getPipelineId()];
+            if (!bindlessSetsBound) {
+                const auto& frameSet = mgr.m_sets[m_bindlessDescriptorSetId];
+                const std::array sets{frameSet.set, mgr.m_bindlessTextures->getDescriptorSet()};
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline.pipelineLayout,
+                                        0, static_cast<uint32_t>(sets.size()), sets.data(),
+                                        frameSet.layout->getDynamicOffsetCount(), m_frameUniformOffsets.data());
+                bindlessSetsBound = true;
+                ++m_frameStatistics.descriptorSetBindCount;
+            }
+            if (meshPipeline.pipeline.get() != boundPipeline) {
+                meshPipeline.pipeline->bind(commandBuffer);
+                boundPipeline = meshPipeline.pipeline.get();
+                ++m_frameStatistics.pipelineBindCount;
+            }
+            drawMesh(mesh, meshPipeline.pipelineLayout);
+        }
 
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                mgr.m_pipelines[mesh.getPipelineId()].pipelineLayout, 0, 1,
-                                &mgr.m_sets[mesh.getDescriptorSetId()].set, 0, nullptr);
-        VkViewport viewPort;
-        viewPort.x = 0.f;
-        viewPort.y = 0.f;
-        viewPort.width = m_window.getExtent().width;
-        viewPort.height = m_window.getExtent().height;
-        viewPort.minDepth = 0.f;
-        viewPort.maxDepth = 1.f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewPort);
-
-        VkRect2D scissor;
-        scissor.offset = {0, 0};
-        scissor.extent = {m_window.getExtent()};
-
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-        m_model->bind(commandBuffer, mesh);
-        m_model->draw(commandBuffer, mesh);
+        // Meshes are loaded a batch at a time, so neighbours mostly share their material's pipeline and set
+        uint32_t boundSetID = -1;
+        for (auto& mesh : mgr.m_meshes) {
+            if (!hasMaterialPipeline(mesh) || isBindless(mesh)) continue;
+            const auto& meshPipeline = mgr.m_pipelines[mesh.getPipelineId()];
+            if (meshPipeline.pipeline.get() != boundPipeline) {
+                meshPipeline.pipeline->bind(commandBuffer);
+                boundPipeline = meshPipeline.pipeline.get();
+                ++m_frameStatistics.pipelineBindCount;
+            }
+            if (mesh.getDescriptorSetId() != boundSetID) {
+                const auto& set = mgr.m_sets[mesh.getDescriptorSetId()];
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline.pipelineLayout,
+                                        0, 1, &set.set, set.layout->getDynamicOffsetCount(),
+                                        m_frameUniformOffsets.data());
+                boundSetID = mesh.getDescriptorSetId();
+                ++m_frameStatistics.descriptorSetBindCount;
+            }
+            drawMesh(mesh, meshPipeline.pipelineLayout);
+        }
+    } else {
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
     }
+    /*
     if (m_useNormalPipeline)
         for (auto& mesh : mgr.m_meshes) {
             // update normalTest UBO
@@ -389,17 +794,20 @@ void App::initEvents() noexcept {
                                           static_cast<float>(m_window.getExtent().width) / m_window.getExtent().height,
                                           0.1f, 100.f);
     });
+    m_eventDispatcher.add_event_listener<EventFileDrop>([&](EventFileDrop& event) {
+        for (auto& path : event.paths) loadModelAsync(std::move(path));
+    });
     m_window.set_event_callback([&](BaseEvent& event) { m_eventDispatcher.dispatch(event); });
 }
 void App::addNormalTestPipeline() noexcept {
     auto& mgr = MeshMGR::Instance();
     auto descriptorLayout = DescriptorSetLayout::Builder(m_device)
-                                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                                             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT)
                                 .addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
                                             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT)
                                 .build();
-    auto globalBufferInfo = mgr.m_generalMatrixUBO->descriptorInfo();
+    auto globalBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(GlobalUbo));
     auto normalBufferInfo = mgr.m_normalTestUBO->descriptorInfo();
     VkDescriptorSet descriptorSet;
     DescriptorWriter(*descriptorLayout, mgr.getDescriptorPool())
@@ -421,10 +829,10 @@ void App::addNormalTestPipeline() noexcept {
                                   << mgr.m_pipelines.back().pipeline->getShader().getFragmentShaderPath());
 
     }
-    mgr.m_sets.emplace_back(std::move(descriptorLayout), nullptr, descriptorSet);
+    mgr.m_sets.emplace_back(std::move(descriptorLayout), descriptorSet);
     m_normalPipelineDescriptorSetID = mgr.m_sets.size() - 1;
 }
-void App::addSkybox() noexcept {
+void App::addSkybox(UploadContext& uploadContext) noexcept {
     Texture::CubemapData skyboxInfo{.frontTexturePath = "data/Skybox/front.jpg",
                                     .backTexturePath = "data/Skybox/back.jpg",
                                     .topTexturePath = "data/Skybox/top.jpg",
@@ -457,13 +865,13 @@ void App::addSkybox() noexcept {
         skyboxMesh.m_pos[i].m_position = {skyboxVertices[3 * i], skyboxVertices[3 * i + 1], skyboxVertices[3 * i + 2]};
     for (size_t i = 0; i < sizeof(skyboxVertices) / (3 * sizeof(float)); ++i) skyboxMesh.m_ind.emplace_back(i);
     auto descriptorLayout = DescriptorSetLayout::Builder(m_device)
-                                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
                                 .addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
                                 .build();
     auto skyboxPair = mgr.m_textures.try_emplace("skybox", std::move(skyboxInfo));
-    if (!skyboxPair.first->second.isProcessed()) m_model->createTexture(skyboxPair.first->second);
+    if (!skyboxPair.first->second.isProcessed()) m_model->createTexture(skyboxPair.first->second, uploadContext);
     auto skyboxDescriptorInfo = skyboxPair.first->second.getDescriptorInfo();
-    auto globalBufferInfo = mgr.m_generalMatrixUBO->descriptorInfo();
+    auto globalBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(GlobalUbo));
     VkDescriptorSet descriptorSet;
     DescriptorWriter(*descriptorLayout, mgr.getDescriptorPool())
         .writeBuffer(0, &globalBufferInfo)
@@ -481,7 +889,7 @@ void App::addSkybox() noexcept {
         LOG_MSG("Pipeline name: " << mgr.m_pipelines.back().name << ": "
                                   << mgr.m_pipelines.back().pipeline->getShader().getFragmentShaderPath());
     }
-    mgr.m_sets.emplace_back(std::move(descriptorLayout), nullptr, descriptorSet);
+    mgr.m_sets.emplace_back(std::move(descriptorLayout), descriptorSet);
     skyboxMesh.m_descriptorSetId = static_cast<uint32_t>(mgr.m_sets.size() - 1);
     mgr.m_systemMeshes.emplace_back(std::move(skyboxMesh));
     Texture::CubemapData skyboxIrradiance{.frontTexturePath = "data/Skybox/Irradiance/0.bmp",
@@ -491,10 +899,14 @@ void App::addSkybox() noexcept {
                                           .leftTexturePath = "data/Skybox/Irradiance/4.bmp",
                                           .rightTexturePath = "data/Skybox/Irradiance/5.bmp"};
     auto envIrradiancePair = mgr.m_textures.try_emplace("skybox_irradiance", std::move(skyboxIrradiance));
-    if (!envIrradiancePair.first->second.isProcessed()) m_model->createTexture(envIrradiancePair.first->second);
+    if (!envIrradiancePair.first->second.isProcessed())
+        m_model->createTexture(envIrradiancePair.first->second, uploadContext);
 }
 void App::run() {
-    m_model->createBuffers();
+    {
+        UploadContext uploadContext(m_device);
+        m_model->createBuffers(uploadContext);
+    }
     auto& mgr = MeshMGR::Instance();
     init_imgui();
     const std::array table{
@@ -503,6 +915,7 @@ void App::run() {
     int currentItem = 0;
     while (!m_window.shouldClose()) {
         glfwPollEvents();
+        publishStreamedModels();
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -516,7 +929,9 @@ void App::run() {
                 if (ImGui::TreeNode(pipeline.name.c_str())) {
                     const auto& shader = pipeline.pipeline->getShader();
                     ImGui::Separator();
-                    if (ImGui::Button("Recreate pipeline")) pipeline.pipeline->recreatePipelineShaders(m_renderer.getSwapChainRenderPass());
+                    if (ImGui::Button("Recreate pipeline"))
+                        pipeline.pipeline->recreatePipelineShaders(
+                            ResourceSystem::Instance().getFrameBufferByID(m_meshFramebufferID).getRenderPass());
                     ImGui::Separator();
                     ImGui::Text("%s", std::string("Vertex shader path:\n" + shader.getVertexShaderPath()).c_str());
                     ImGui::Text("%s", std::string("Fragment shader path:\n" + shader.getFragmentShaderPath()).c_str());
@@ -530,6 +945,11 @@ void App::run() {
                     if (shader.isGeometryShaderPresent())
                         ImGui::Text("%s",
                                     std::string("Geom defines:\n" + shader.getDefines().geometryShaderDefines).c_str());
+                    if (const auto& values = shader.getDefines().fragmentSpecialization; !values.empty()) {
+                        std::string constants = "Frag specialization:";
+                        for (const auto value : values) constants += ' ' + std::to_string(value);
+                        ImGui::Text("%s", constants.c_str());
+                    }
                     ImGui::TreePop();
                 }
             }
@@ -542,16 +962,59 @@ void App::run() {
         } else
             m_useNormalPipeline = false;
 
+        if (ImGui::TreeNode("Mesh LODs")) {
+            ImGui::Checkbox("Color by LOD", &m_showLods);
+            ImGui::SliderFloat("Max pixel error", &m_lodPixelError, 0.1f, 20.f);
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Materials")) {
+            if (int mode = static_cast<int>(m_materialMode);
+                ImGui::Combo("Mode of new models", &mode, MATERIAL_MODE_NAMES.data(),
+                             static_cast<int>(MATERIAL_MODE_NAMES.size())))
+                setMaterialMode(static_cast<MaterialMode>(mode));
+            ImGui::Text("Load cost of each mode:");
+            for (size_t i = 0; i < m_materialModeStatistics.size(); ++i) {
+                const auto& statistics = m_materialModeStatistics[i];
+                if (statistics.meshCount == 0) continue;
+                ImGui::Text("  %s: %zu meshes, %zu new pipelines, %zu shader compiles in %.1f ms",
+                            MATERIAL_MODE_NAMES[i], statistics.meshCount, statistics.pipelineCount,
+                            statistics.shaderCompileCount, statistics.compileTime.count());
+            }
+            ImGui::Text("Last frame: %zu mesh draws, %zu pipeline binds, %zu descriptor set binds",
+                        m_frameStatistics.drawCount, m_frameStatistics.pipelineBindCount,
+                        m_frameStatistics.descriptorSetBindCount);
+            ImGui::TreePop();
+        }
+
         ImGui::Text("%s", (std::string("Camera position: \n") + std::to_string(m_camera.getCameraPos().x) + " " +
                            std::to_string(m_camera.getCameraPos().y) + " " + std::to_string(m_camera.getCameraPos().z))
                               .c_str());
-        if (ImGui::TreeNode(std::string("Meshes (" + std::to_string(mgr.m_meshes.size()) + ")").c_str())) {
+        const auto memoryStatistics = m_device.getAllocator().getStatistics();
+        ImGui::Text("Device memory: %zu blocks + %zu dedicated, %.1f of %.1f MB used, %.0f%% fragmented",
+                    memoryStatistics.blockCount, memoryStatistics.dedicatedCount,
+                    memoryStatistics.usedBytes / (1024.0 * 1024.0), memoryStatistics.reservedBytes / (1024.0 * 1024.0),
+                    memoryStatistics.fragmentation * 100.f);
+        const auto pipelineCacheStatistics = m_device.getPipelineCache().getStatistics();
+        ImGui::Text("Pipeline cache: %zu hits, %zu misses, %zu without feedback, %.1f ms creating pipelines",
+                    pipelineCacheStatistics.hitCount, pipelineCacheStatistics.missCount,
+                    pipelineCacheStatistics.unknownCount, pipelineCacheStatistics.creationTime.count());
+        const auto geometryStatistics = m_model->getGeometryStatistics();
+        ImGui::Text("Geometry pool: %zu blocks, %.1f of %.1f MB used", geometryStatistics.blockCount,
+                    geometryStatistics.usedBytes / (1024.0 * 1024.0),
+                    geometryStatistics.reservedBytes / (1024.0 * 1024.0));
+        if (ImGui::TreeNode(std::string("Meshes ("+ std::to_string(mgr.m_meshes.size()) + ")").c_str())) {
             for (const auto& mesh : mgr.m_meshes) {
                 if (ImGui::TreeNode(mesh.getName().c_str())) {
                     ImGui::Text("%s", std::string("Pipeline ID: " + std::to_string(mesh.getPipelineId())).c_str());
                     ImGui::Text("%s",
                                 std::string("DesctiptorSet ID: " + std::to_string(mesh.getDescriptorSetId())).c_str());
                     ImGui::Text("%s", std::string("Num of vertices: " + std::to_string(mesh.getVertexCount())).c_str());
+                    ImGui::Text("%s",
+                                std::string("Num of instances: " + std::to_string(mesh.getInstanceCount())).c_str());
+                    if (!mesh.m_lods.empty())
+                        ImGui::Text("%s", std::string("LOD: " + std::to_string(mesh.m_currentLod) + " of " +
+                                                      std::to_string(mesh.m_lods.size()))
+                                              .c_str());
                     ImGui::TreePop();
                 }
             }
@@ -561,20 +1024,23 @@ void App::run() {
         ImGui::Render();
         if (auto commandBuffer = m_renderer.beginFrame()) {
             // update global variables
+            // beginFrame waited for the frame that last used this ring region
+            mgr.m_frameUniforms->beginFrame(static_cast<uint32_t>(m_renderer.getFrameIndex()));
             GlobalUbo ubo{.projection = m_camera.getProjection(),
                           .view = m_camera.getView(),
                           .cameraPosition = m_camera.getCameraPos()};
-            mgr.m_generalMatrixUBO->writeToBuffer(&ubo);
-            mgr.m_generalMatrixUBO->flush();
+            m_frameUniformOffsets[0] = mgr.m_frameUniforms->push(ubo);
+            mgr.m_objects->beginFrame(static_cast<uint32_t>(m_renderer.getFrameIndex()));
+            m_frameUniformOffsets[1] = mgr.m_objects->getFrameOffset();
 
             // update debug UBO
             DebugUBO debugUBO{.outType = static_cast<unsigned int>(currentItem)};
-            mgr.m_debugUBO->writeToBuffer(&debugUBO);
-            mgr.m_debugUBO->flush();
+            m_frameUniformOffsets[2] = mgr.m_frameUniforms->push(debugUBO);
 
             
             // render
             auto& resourceSystem = ResourceSystem::Instance();
+            m_frameStatistics = {};
             ;
             //ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
             for (auto& currentWorkflowframe : resourceSystem.getWorkFlow(0).getFramesData()) {
@@ -602,7 +1068,7 @@ void App::run() {
                 }
         }
     }
-    vkDeviceWaitIdle(m_device.device());
+    m_device.waitIdle();
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -638,6 +1104,7 @@ void App::init_imgui() {
     init_info.PhysicalDevice = m_device.getPhysicalDevice();
     init_info.Device = m_device.device();
     init_info.Queue = m_device.graphicsQueue();
+    init_info.PipelineCache = m_device.getPipelineCache().getPipelineCache();
     init_info.DescriptorPool = MeshMGR::Instance().m_UIPool->getDescriptorPool();
     init_info.MinImageCount = 3;
     init_info.ImageCount = 3;
@@ -655,52 +1122,111 @@ void App::init_imgui() {
 }
 
 
-void App::loadModels(std::vector<Mesh>&& meshess) {
+void App::loadModels(std::vector<Mesh>&& meshes) {
+    loadModels(std::move(meshes), MeshPipelines{.mode = m_materialMode});
+}
+
+void App::loadModels(std::vector<Mesh>&& meshess, MeshPipelines&& prepared) {
     auto& mgr = MeshMGR::Instance();
     auto& mgr_meshes = mgr.m_meshes;
+    // Meshes without a slot in the object buffer would have nothing to draw with, they aren't loaded at all
+    if (const size_t freeObjects = mgr.m_objects->capacity() - mgr.m_objects->size(); meshess.size() > freeObjects) {
+        LOG_ERROR("ObjectBuffer is full, " << meshess.size() - freeObjects << " of " << meshess.size()
+                                           << " meshes aren't loaded")
+        meshess.erase(meshess.begin() + freeObjects, meshess.end());
+    }
+    decodeTextures(meshess, mgr.m_textures);
+    {
+        // Resident from now on, streaming loads skip them
+        std::scoped_lock lock(m_streamedTexturePathsMutex);
+        for (const auto& mesh : meshess) {
+            for (const auto& [hasMap, texturePath, role] : materialTextures(mesh.m_material))
+                if (hasMap) m_streamedTexturePaths.insert(*texturePath);
+        }
+    }
+    // All texture uploads of the batch share one submit, it is flushed when the function returns
+    UploadContext uploadContext(m_device);
+    MaterialMode mode = prepared.mode;
+    if (mode == MaterialMode::Bindless) {
+        // Checked up front, a texture that doesn't fit would leave its meshes without a slot to sample
+        std::unordered_set<std::string> newTextures;
+        for (const auto& mesh : meshess) {
+            for (const auto& [hasMap, texturePath, role] : materialTextures(mesh.m_material))
+                if (hasMap && !mgr.m_bindlessTextures->contains(*texturePath)) newTextures.insert(*texturePath);
+        }
+        if (const uint32_t freeSlots = mgr.m_bindlessTextures->capacity() - mgr.m_bindlessTextures->size();
+            newTextures.size() > freeSlots) {
+            LOG_ERROR("Bindless texture array has " << freeSlots << " free slots, the batch needs "
+                                                    << newTextures.size() << ", loading it with Defines materials")
+            mode = MaterialMode::Defines;
+        }
+    }
+    const bool bindless = mode == MaterialMode::Bindless;
+    // One shader per material type binds every map, missing ones get the default textures
+    const bool bindAllMaps = mode == MaterialMode::Specialization || mode == MaterialMode::Dynamic;
+    const size_t pipelineCount = mgr.m_pipelines.size();
+    // Pipelines a streaming worker built for the batch, the ones whose defines a pipeline has by now are dropped
+    for (auto& pipeline : prepared.pipelines) {
+        const auto& defines = pipeline.pipeline->getShader().getDefines();
+        if (mode != prepared.mode || std::ranges::any_of(mgr.m_pipelines, [&defines](const PipelineInfo& existing) {
+                return existing.pipeline->getShader().getDefines() == defines;
+            })) {
+            destroyPipeline(m_device, pipeline);
+            continue;
+        }
+        mgr.m_pipelines.push_back(std::move(pipeline));
+        nameMeshPipeline(mgr.m_pipelines.back(), mgr.m_pipelines.size() - 1);
+    }
+
+    // Nothing is left to compile for a prepared batch, unless it fell back to another mode
+    const auto compileStart = std::chrono::steady_clock::now();
+    auto shaders = compileMeshShaders(meshess, mode, mgr.m_pipelines);
+    std::chrono::duration<double, std::milli> compileTime = std::chrono::steady_clock::now() - compileStart;
+    size_t shaderCompileCount = shaders.size();
+    if (mode == prepared.mode) {
+        compileTime += prepared.compileTime;
+        shaderCompileCount += prepared.shaderCompileCount;
+    }
 
     for (auto& mesh : meshess) {
-        auto uboBuffer = std::make_unique<Buffer>(m_device, sizeof(PBRUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        uboBuffer->map();
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(mesh.getModelMatrix())));
+        ObjectData object{.modelMatrix = mesh.getModelMatrix(),
+                          .normalMatrix = glm::mat3x4(normalMatrix),
+                          .baseColor = mesh.m_material.m_baseColor,
+                          .lightDirection = glm::vec4(1.f, 0.f, 0.f, 0.f),
+                          .metallic = mesh.m_material.m_metallicFactor,
+                          .roughness = mesh.m_material.m_roughnessFactor,
+                          .materialFlags = materialFlags(mesh.m_material)};
+        if (bindless) {
+            [[maybe_unused]] const bool added = setBindlessTextures(mesh.m_material, object, uploadContext);
+            assert(added && "The batch's textures were checked against the free slots");
+        }
+        const auto objectIndex = mgr.m_objects->add(object);
+        assert(objectIndex && "The batch was trimmed to the free objects");
+        mesh.m_objectIndex = *objectIndex;
+
+        const std::string key = materialKey(mesh, mode);
+        if (auto material = mgr.m_materials.find(key); material != mgr.m_materials.end()) {
+            mesh.m_descriptorSetId = material->second.descriptorSetId;
+            mesh.m_pipelineId = material->second.pipelineId;
+            continue;
+        }
+        if (bindless) {
+            mesh.m_descriptorSetId = m_bindlessDescriptorSetId;
+            mesh.m_pipelineId = getMeshPipeline(mesh, mode, getBindlessSetLayouts(), shaders);
+            mgr.m_materials.emplace(key, MaterialBinding{.descriptorSetId = mesh.m_descriptorSetId,
+                                                         .pipelineId = mesh.m_pipelineId});
+            continue;
+        }
 
-        auto descriptorLayoutBuilder = DescriptorSetLayout::Builder(m_device)
-                                           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-                                           .addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-                                           .addBinding(
-                                               100, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);  // debug
-
-        if (mesh.m_material.m_hasColorMap)
-            descriptorLayoutBuilder.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                               VK_SHADER_STAGE_FRAGMENT_BIT);
-        if (mesh.m_material.m_hasMetallicRoughnessMap)
-            descriptorLayoutBuilder.addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                               VK_SHADER_STAGE_FRAGMENT_BIT);
-        if (mesh.m_material.m_hasNormalMap)
-            descriptorLayoutBuilder.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                               VK_SHADER_STAGE_FRAGMENT_BIT);
-        if (mesh.m_material.m_hasEmissiveMap)
-            descriptorLayoutBuilder.addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                               VK_SHADER_STAGE_FRAGMENT_BIT);
-
-        descriptorLayoutBuilder.addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                           VK_SHADER_STAGE_FRAGMENT_BIT);  // skybox map
-        descriptorLayoutBuilder.addBinding(9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                           VK_SHADER_STAGE_FRAGMENT_BIT);  // skybox irradiance map
-        descriptorLayoutBuilder.addBinding(10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                           VK_SHADER_STAGE_FRAGMENT_BIT);  // brdfLUT
+        auto descriptorLayout = createMaterialSetLayout(m_device, mesh, bindAllMaps);
 
-        auto descriptorLayout = descriptorLayoutBuilder.build();
-
-        auto globalBufferInfo = mgr.m_generalMatrixUBO->descriptorInfo();
-        auto bufferInfo = uboBuffer->descriptorInfo();
-        auto debuggerBufferInfo = mgr.m_debugUBO->descriptorInfo();
-        std::string defines;
+        auto globalBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(GlobalUbo));
+        auto objectBufferInfo = mgr.m_objects->descriptorInfo();
+        auto debuggerBufferInfo = mgr.m_frameUniforms->descriptorInfo(sizeof(DebugUBO));
         auto DW = DescriptorWriter(*descriptorLayout, mgr.getDescriptorPool())
                       .writeBuffer(0, &globalBufferInfo)
-                      .writeBuffer(1, &bufferInfo)
+                      .writeBuffer(1, &objectBufferInfo)
                       .writeBuffer(100, &debuggerBufferInfo);  // debug
         {
             VkDescriptorImageInfo baseColorDescriptorImageInfo;
@@ -713,36 +1239,48 @@ void App::loadModels(std::vector<Mesh>&& meshess) {
             if (mesh.m_material.m_hasColorMap) {
                 auto baseColorPair = mgr.m_textures.try_emplace(mesh.m_material.m_baseColorPath,
                                                                 mesh.m_material.m_baseColorPath);
-                if (!baseColorPair.first->second.isProcessed()) m_model->createTexture(baseColorPair.first->second);
+                if (!baseColorPair.first->second.isProcessed())
+                    m_model->createTexture(baseColorPair.first->second, uploadContext);
                 baseColorDescriptorImageInfo = baseColorPair.first->second.getDescriptorInfo();
                 DW.writeImage(2, &baseColorDescriptorImageInfo);
-                defines += "#define HAS_COLOR_MAP\n";
+            } else if (bindAllMaps) {
+                baseColorDescriptorImageInfo = mgr.m_textures.at(DEFAULT_WHITE_TEXTURE).getDescriptorInfo();
+                DW.writeImage(2, &baseColorDescriptorImageInfo);
             }
             if (mesh.m_material.m_hasMetallicRoughnessMap) {
                 auto metallicRoughnessPair = mgr.m_textures.try_emplace(mesh.m_material.m_MetallicRoughnessPath,
-                                                                        mesh.m_material.m_MetallicRoughnessPath);
+                                                                        mesh.m_material.m_MetallicRoughnessPath,
+                                                                        Texture::Role::Data);
                 if (!metallicRoughnessPair.first->second.isProcessed())
-                    m_model->createTexture(metallicRoughnessPair.first->second);
+                    m_model->createTexture(metallicRoughnessPair.first->second, uploadContext);
                 MetallicRoughnessDescriptorImageInfo = metallicRoughnessPair.first->second.getDescriptorInfo();
                 DW.writeImage(3, &MetallicRoughnessDescriptorImageInfo);
-                defines += "#define HAS_METALLIC_ROUGHNESS_MAP\n";
+            } else if (bindAllMaps) {
+                MetallicRoughnessDescriptorImageInfo = mgr.m_textures.at(DEFAULT_WHITE_TEXTURE).getDescriptorInfo();
+                DW.writeImage(3, &MetallicRoughnessDescriptorImageInfo);
             }
             if (mesh.m_material.m_hasNormalMap) {
-                auto normalPair = mgr.m_textures.try_emplace(mesh.m_material.m_NormalPath, mesh.m_material.m_NormalPath);
-                if (!normalPair.first->second.isProcessed()) m_model->createTexture(normalPair.first->second);
+                auto normalPair = mgr.m_textures.try_emplace(
+                    mesh.m_material.m_NormalPath, mesh.m_material.m_NormalPath, Texture::Role::Normal);
+                if (!normalPair.first->second.isProcessed())
+                    m_model->createTexture(normalPair.first->second, uploadContext);
                 NormalDescriptorImageInfo = normalPair.first->second.getDescriptorInfo();
                 DW.writeImage(4, &NormalDescriptorImageInfo);
-                defines += "#define HAS_NORMAL_MAP\n";
+            } else if (bindAllMaps) {
+                NormalDescriptorImageInfo = mgr.m_textures.at(DEFAULT_FLAT_NORMAL_TEXTURE).getDescriptorInfo();
+                DW.writeImage(4, &NormalDescriptorImageInfo);
             }
             if (mesh.m_material.m_hasEmissiveMap) {
                 auto emissivePair = mgr.m_textures.try_emplace(mesh.m_material.m_EmissivePath,
                                                                mesh.m_material.m_EmissivePath);
-                if (!emissivePair.first->second.isProcessed()) m_model->createTexture(emissivePair.first->second);
+                if (!emissivePair.first->second.isProcessed())
+                    m_model->createTexture(emissivePair.first->second, uploadContext);
                 EmissiveDescriptorImageInfo = emissivePair.first->second.getDescriptorInfo();
                 DW.writeImage(5, &EmissiveDescriptorImageInfo);
-                defines += "#define HAS_EMISSIVE_MAP\n";
+            } else if (bindAllMaps) {
+                EmissiveDescriptorImageInfo = mgr.m_textures.at(DEFAULT_BLACK_TEXTURE).getDescriptorInfo();
+                DW.writeImage(5, &EmissiveDescriptorImageInfo);
             }
-            if (mesh.m_material.m_hasOcclusionMap) defines += "#define HAS_OCCLUSION_MAP\n";
             {
                 auto skyboxPair = mgr.m_textures.find("skybox");
                 if (skyboxPair == mgr.m_textures.end()) {
@@ -771,83 +1309,227 @@ void App::loadModels(std::vector<Mesh>&& meshess) {
         }
         VkDescriptorSet descriptorSet;
         DW.build(descriptorSet);
-        switch (mesh.m_materialType) {
-            case Mesh::MaterialType::Phong: defines += "#define Phong\n"; break;
-            case Mesh::MaterialType::PBR: defines += "#define PBR\n"; break;
+        mesh.m_pipelineId = getMeshPipeline(mesh, mode, {descriptorLayout->getDescriptorSetLayout()}, shaders);
+
+        mgr.m_sets.emplace_back(std::move(descriptorLayout), descriptorSet);
+
+        mesh.m_descriptorSetId = mgr.m_sets.size() - 1;
+        mgr.m_materials.emplace(key, MaterialBinding{.descriptorSetId = mesh.m_descriptorSetId,
+                                                     .pipelineId = mesh.m_pipelineId});
+    }
+
+    auto& statistics = m_materialModeStatistics[static_cast<size_t>(mode)];
+    statistics.meshCount += meshess.size();
+    statistics.shaderCompileCount += shaderCompileCount;
+    statistics.pipelineCount += mgr.m_pipelines.size() - pipelineCount;
+    statistics.compileTime += compileTime;
+    LOG_MSG("Material mode " << MATERIAL_MODE_NAMES[static_cast<size_t>(mode)] << " load: " << meshess.size()
+                             << " meshes, " << shaderCompileCount << " shader compiles in " << compileTime.count()
+                             << " ms, " << mgr.m_pipelines.size() - pipelineCount << " new pipelines")
+
+    mgr_meshes.insert(mgr_meshes.end(), std::make_move_iterator(meshess.begin()),
+                      std::make_move_iterator(meshess.end()));
+}
+
+uint32_t App::getMeshPipeline(const Mesh& mesh, const MaterialMode mode,
+                              const std::vector<VkDescriptorSetLayout>& setLayouts, std::vector<Shader>& shaders) {
+    auto& mgr = MeshMGR::Instance();
+    const ShaderDefines defines = getMeshShaderDefines(mesh, mode);
+    uint32_t pipelineId = -1;
+
+    for (size_t i = 0; i < mgr.m_pipelines.size(); ++i) {
+        if (mgr.m_pipelines[i].pipeline->getShader().getDefines() == defines) pipelineId = i;
+    }
+    if (pipelineId == -1) {
+        // Specializations start from the SPIR-V of a compiled shader or of a pipeline with the same source
+        const Shader* compiled = nullptr;
+        if (auto source = std::ranges::find_if(
+                shaders, [&](const Shader& shader) { return sameSource(shader.getDefines(), defines); });
+            source != shaders.end())
+            compiled = &*source;
+        for (auto& pipeline : mgr.m_pipelines) {
+            if (compiled == nullptr && sameSource(pipeline.pipeline->getShader().getDefines(), defines))
+                compiled = &pipeline.pipeline->getShader();
+        }
+        if (compiled == nullptr) {
+            shaders.push_back(createMeshShader(mesh.m_materialType, defines));
+            Shader::compileAll(std::span(&shaders.back(), 1));
+            compiled = &shaders.back();
         }
-        mesh.m_pipelineId = -1;
+        // A failed permutation stays in the list, meshes that need it don't compile it again
+        if (!compiled->isValid()) return pipelineId;
+        mgr.m_pipelines.push_back(
+            createMeshPipeline(mesh, setLayouts, compiled->specialize(defines.fragmentSpecialization)));
+        pipelineId = mgr.m_pipelines.size() - 1;
+        nameMeshPipeline(mgr.m_pipelines.back(), pipelineId);
+    }
+    return pipelineId;
+}
 
-        for (size_t i = 0; i < mgr.m_pipelines.size(); ++i) {
-            if (auto& def = mgr.m_pipelines[i].pipeline->getShader().getDefines();
-                def.fragmentShaderDefines == defines && def.vertShaderDefines == "")
-                mesh.m_pipelineId = i;
+PipelineInfo App::createMeshPipeline(const Mesh& mesh, const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                     Shader&& shader) {
+    const VkPipelineLayout pipelineLayout =
+        Pipeline::createPipeLineLayout(m_device.device(), setLayouts, {MESH_PUSH_CONSTANT_RANGE});
+    PipelineInfo pipeline{.pipelineLayout = pipelineLayout};
+    switch (mesh.m_materialType) {
+        case Mesh::MaterialType::Phong: {
+            pipeline.name = "Phong_GLSL";
+            createPipeline(pipelineLayout, pipeline.pipeline, std::move(shader), FixedPipelineStates(),
+                           mesh.m_vertexFormat);
+            break;
         }
-        if (mesh.m_pipelineId == -1) {
-            switch (mesh.m_materialType) {
-                case Mesh::MaterialType::Phong:
-                    if (Shader glslPhongShader("data/Shaders/GLSL/Phong/phong.vert",
-                                               "data/Shaders/GLSL/Phong/phong.frag", "", {"", defines});
-                        glslPhongShader.isValid()) {
-                        auto pipelineLayoutGLSLPhong = Pipeline::createPipeLineLayout(m_device.device(), descriptorLayout->getDescriptorSetLayout());
-                        mgr.m_pipelines.emplace_back(std::to_string(mgr.m_pipelines.size()) + " Phong_GLSL",
-                                                     pipelineLayoutGLSLPhong, nullptr);
-                        mesh.m_pipelineId = mgr.m_pipelines.size() - 1;
-                        createPipeline(descriptorLayout->getDescriptorSetLayout(), mgr.m_pipelines.back().pipeline,
-                                       std::move(glslPhongShader));
-                        LOG_MSG("Pipeline name: "
-                                << mgr.m_pipelines[mesh.m_pipelineId].name << ": "
-                                << mgr.m_pipelines[mesh.m_pipelineId].pipeline->getShader().getFragmentShaderPath());
-                    }
-                    break;
-                case Mesh::MaterialType::PBR:
-                    if (Shader glslPBRShader("data/Shaders/GLSL/PBR/PBR.vert", "data/Shaders/GLSL/PBR/PBR.frag", "",
-                                             {"", defines});
-                        glslPBRShader.isValid()) {
-                        auto pipelineLayoutGLSLPBR = Pipeline::createPipeLineLayout(
-                            m_device.device(),
-                            descriptorLayout->getDescriptorSetLayout());
-                        mgr.m_pipelines.emplace_back(std::to_string(mgr.m_pipelines.size()) + " PBR_GLSL",
-                                                     pipelineLayoutGLSLPBR, nullptr);
-                        mesh.m_pipelineId = mgr.m_pipelines.size() - 1;
-                        FixedPipelineStates states{};
-                        states.cullingMode = CullingMode::BACK;
-                        createPipeline(descriptorLayout->getDescriptorSetLayout(), mgr.m_pipelines.back().pipeline,
-                                       std::move(glslPBRShader),
-                                       std::move(states));
-                        LOG_MSG("Pipeline name: "
-                                << mgr.m_pipelines[mesh.m_pipelineId].name << ": "
-                                << mgr.m_pipelines[mesh.m_pipelineId].pipeline->getShader().getFragmentShaderPath());
-                    }
+        case Mesh::MaterialType::PBR: {
+            pipeline.name = "PBR_GLSL";
+            FixedPipelineStates states{};
+            states.cullingMode = CullingMode::BACK;
+            createPipeline(pipelineLayout, pipeline.pipeline, std::move(shader), std::move(states),
+                           mesh.m_vertexFormat);
 #if 0
-                    if (Shader glslPhongShader("data/Shaders/GLSL/Phong/phong.vert", "data/Shaders/GLSL/Phong/phong.frag", { "", defines + "#define TESTPHONG" }); glslPhongShader.isValid())
-                    {
-                        auto pipelineLayoutGLSLPhong = createPipeLineLayout(descriptorLayout->getDescriptorSetLayout());
-                        mgr.m_pipelines.emplace_back(std::to_string(mgr.m_pipelines.size()) + " Phong_GLSL", pipelineLayoutGLSLPhong, nullptr);
-                        createPipeline(descriptorLayout->getDescriptorSetLayout(), mgr.m_pipelines.back().pipeline, std::move(glslPhongShader));
-                    }
-#endif
-                    break;
+            if (Shader glslPhongShader("data/Shaders/GLSL/Phong/phong.vert", "data/Shaders/GLSL/Phong/phong.frag", { "", defines + "#define TESTPHONG" }); glslPhongShader.isValid())
+            {
+                auto pipelineLayoutGLSLPhong = createPipeLineLayout(descriptorLayout->getDescriptorSetLayout());
+                mgr.m_pipelines.emplace_back(std::to_string(mgr.m_pipelines.size()) + " Phong_GLSL", pipelineLayoutGLSLPhong, nullptr);
+                createPipeline(descriptorLayout->getDescriptorSetLayout(), mgr.m_pipelines.back().pipeline, std::move(glslPhongShader));
             }
+#endif
+            break;
         }
+    }
+    return pipeline;
+}
 
-        mgr.m_sets.emplace_back(std::move(descriptorLayout), std::move(uboBuffer), descriptorSet);
+App::MeshPipelines App::createMeshPipelines(const std::vector<Mesh>& meshes, const MaterialMode mode,
+                                            const std::vector<VkDescriptorSetLayout>& bindlessSetLayouts) {
+    MeshPipelines prepared{.mode = mode};
+    const bool bindAllMaps = mode == MaterialMode::Specialization || mode == MaterialMode::Dynamic;
+    const auto compileStart = std::chrono::steady_clock::now();
+    // MeshMGR's pipelines belong to the render thread, so every source of the batch is compiled. The shader cache
+    // makes the ones a pipeline already has cheap
+    std::vector<Shader> shaders = compileMeshShaders(meshes, mode, {});
+    prepared.compileTime = std::chrono::steady_clock::now() - compileStart;
+    prepared.shaderCompileCount = shaders.size();
+    for (const auto& mesh : meshes) {
+        const ShaderDefines defines = getMeshShaderDefines(mesh, mode);
+        if (std::ranges::any_of(prepared.pipelines, [&defines](const PipelineInfo& pipeline) {
+                return pipeline.pipeline->getShader().getDefines() == defines;
+            }))
+            continue;
+        const auto source = std::ranges::find_if(
+            shaders, [&defines](const Shader& shader) { return sameSource(shader.getDefines(), defines); });
+        // loadModels reports the shaders that don't compile
+        if (source == shaders.end() || !source->isValid()) continue;
+        if (mode == MaterialMode::Bindless) {
+            prepared.pipelines.push_back(
+                createMeshPipeline(mesh, bindlessSetLayouts, source->specialize(defines.fragmentSpecialization)));
+        } else {
+            // Only the pipeline layout uses it, the sets are allocated with loadModels' own layout
+            const auto setLayout = createMaterialSetLayout(m_device, mesh, bindAllMaps);
+            prepared.pipelines.push_back(createMeshPipeline(mesh, {setLayout->getDescriptorSetLayout()},
+                                                            source->specialize(defines.fragmentSpecialization)));
+        }
+    }
+    return prepared;
+}
 
-        mesh.m_descriptorSetId = mgr.m_sets.size() - 1;
+std::vector<VkDescriptorSetLayout> App::getBindlessSetLayouts() const {
+    const auto& mgr = MeshMGR::Instance();
+    if (mgr.m_bindlessTextures == nullptr) return {};
+    return {mgr.m_sets[m_bindlessDescriptorSetId].layout->getDescriptorSetLayout(),
+            mgr.m_bindlessTextures->getDescriptorSetLayout()};
+}
 
-        // update
-        PBRUbo ubo = {.modelMatrix = mesh.getModelMatrix(),
-                      .normalMatrix = glm::transpose(glm::inverse(mesh.getModelMatrix())),
-                      .baseColor = mesh.m_material.m_baseColor,
-                      .lightDirection = glm::vec4(1.f, 0.f, 0.f, 0.f),
-                      .metallic = mesh.m_material.m_metallicFactor,
-                      .roughness = mesh.m_material.m_roughnessFactor};
+void App::setModelLoader(ModelLoader loader) noexcept { m_modelLoader = std::move(loader); }
 
-        auto& buffer = mgr.m_sets[mesh.getDescriptorSetId()].uboBuffer;
-        buffer->writeToBuffer(&ubo);
-        buffer->flush();
+void App::setMaterialMode(const MaterialMode mode) noexcept {
+    if (mode == MaterialMode::Bindless && MeshMGR::Instance().m_bindlessTextures == nullptr) {
+        LOG_ERROR("Bindless materials need descriptor indexing, using the Defines material mode")
+        m_materialMode = MaterialMode::Defines;
+        return;
+    }
+    m_materialMode = mode;
+}
+
+void App::loadModelAsync(std::string path) {
+    if (!m_modelLoader) {
+        LOG_ERROR("Streaming: no model loader set, can't load " << path)
+        return;
+    }
+    LOG_MSG("Streaming: " << path << " queued")
+    if (m_streamedModels.empty() && m_heldStreamedModels.empty()) {
+        m_streamingStart = std::chrono::steady_clock::now();
+        m_streamingModelCount = 0;
+    }
+    ++m_streamingModelCount;
+    // The mode is the one of the moment the model was queued, its pipelines are built with it on the worker
+    m_streamedModels.push_back(ThreadPool::Instance().submit(
+        [this, path = std::move(path), mode = m_materialMode, bindlessSetLayouts = getBindlessSetLayouts()]() mutable {
+            return streamModel(std::move(path), mode, bindlessSetLayouts);
+        }));
+}
+
+App::StreamedModel App::streamModel(std::string path, const MaterialMode mode,
+                                    const std::vector<VkDescriptorSetLayout>& bindlessSetLayouts) noexcept {
+    const auto start = std::chrono::steady_clock::now();
+    StreamedModel model{.path = std::move(path)};
+    model.meshes = m_modelLoader(model.path);
+    UploadContext uploadContext(m_device);
+
+    for (auto& mesh : model.meshes) {
+        for (const auto& [hasMap, texturePath, role] : materialTextures(mesh.m_material)) {
+            if (!hasMap) continue;
+            {
+                std::scoped_lock lock(m_streamedTexturePathsMutex);
+                if (!m_streamedTexturePaths.insert(*texturePath).second) {
+                    model.sharedTextures.push_back(*texturePath);
+                    continue;
+                }
+            }
+            auto texturePair = model.textures.try_emplace(*texturePath, *texturePath, role);
+            m_model->createTexture(texturePair.first->second, uploadContext);
+        }
+        m_model->createMeshBuffers(mesh, uploadContext);
+    }
+    uploadContext.flush();
+    // Compiling and creating pipelines would stall the frame that publishes the model
+    model.pipelines = createMeshPipelines(model.meshes, mode, bindlessSetLayouts);
+    model.loadTime = std::chrono::steady_clock::now() - start;
+    return model;
+}
+
+// Runs between frames on the render thread, so a model becomes visible with all of its meshes at once
+void App::publishStreamedModels() noexcept {
+    auto& mgr = MeshMGR::Instance();
+    if (m_streamedModels.empty() && m_heldStreamedModels.empty()) return;
+    // Loads are taken in queue order, so the held models stay in it
+    while (!m_streamedModels.empty() &&
+           m_streamedModels.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        auto model = m_streamedModels.front().get();
+        m_streamedModels.erase(m_streamedModels.begin());
+
+        // Textures that are already resident win, streamed duplicates were never referenced and can go. The rest
+        // is resident from now on, so held models that share them can publish
+        mgr.m_textures.merge(model.textures);
+        for (auto& texture : model.textures) destroyTexture(m_device, texture.second);
+        model.textures.clear();
+        m_heldStreamedModels.push_back(std::move(model));
+    }
+    // loadModels would decode and upload a texture another load is still streaming on this thread again
+    while (!m_heldStreamedModels.empty() &&
+           std::ranges::all_of(m_heldStreamedModels.front().sharedTextures,
+                               [&mgr](const std::string& path) { return mgr.m_textures.contains(path); })) {
+        auto model = std::move(m_heldStreamedModels.front());
+        m_heldStreamedModels.erase(m_heldStreamedModels.begin());
+
+        const size_t meshCount = model.meshes.size();
+        for (auto& mesh : model.meshes) mesh.setName(std::to_string(m_streamedMeshCount++) + " | " + mesh.getName());
+        loadModels(std::move(model.meshes), std::move(model.pipelines));
+        LOG_MSG("Streaming: " << model.path << " published, " << meshCount << " meshes loaded in "
+                              << model.loadTime.count() << " ms")
+    }
+    if (m_streamedModels.empty() && m_heldStreamedModels.empty()) {
+        const std::chrono::duration<double, std::milli> totalTime = std::chrono::steady_clock::now() - m_streamingStart;
+        LOG_MSG("Models import complete: " << m_streamingModelCount << " file(s) in " << totalTime.count() << " ms")
     }
-    mgr_meshes.insert(mgr_meshes.end(), std::make_move_iterator(meshess.begin()),
-                      std::make_move_iterator(meshess.end()));
 }
 
 void App::createPipeline(const VkDescriptorSetLayout descriptorSetLayout, std::unique_ptr<Pipeline>& pipeline,
@@ -858,7 +1540,7 @@ void App::createPipeline(const VkDescriptorSetLayout descriptorSetLayout, std::u
     PipelineInputData::FixedFunctionsStages fixedFunctionStages(m_window.getExtent().width, m_window.getExtent().height);
     fixedFunctionStages.setCullingData(states.cullingMode, states.frontFace);
     fixedFunctionStages.setDepthData(states.depthTestEnable, states.depthOp, states.depthWriteEnable, false);
-    auto renderPass = m_renderer.getSwapChainRenderPass();
+    auto renderPass = ResourceSystem::Instance().getFrameBufferByID(m_meshFramebufferID).getRenderPass();
 
     PipelineInputData pipeline_data {
         vertexData,
@@ -872,13 +1554,13 @@ void App::createPipeline(const VkDescriptorSetLayout descriptorSetLayout, std::u
 }
 
 void App::createPipeline(const VkPipelineLayout pipelineLayout, std::unique_ptr<Pipeline>& pipeline, Shader&& shader,
-    FixedPipelineStates states) {
-    PipelineInputData::VertexData vertexData(Vertex::getBindingDescription(), Vertex::getAttributeDescription());
+    FixedPipelineStates states, Mesh::VertexFormat vertexFormat) {
+    PipelineInputData::VertexData vertexData = getVertexData(vertexFormat);
     PipelineInputData::ColorBlendData colorBlendData(Pipeline::createDefaultColorAttachments());
     PipelineInputData::FixedFunctionsStages fixedFunctionStages(m_window.getExtent().width, m_window.getExtent().height);
     fixedFunctionStages.setCullingData(states.cullingMode, states.frontFace);
     fixedFunctionStages.setDepthData(states.depthTestEnable, states.depthOp, states.depthWriteEnable, false);
-    auto renderPass = m_renderer.getSwapChainRenderPass();
+    auto renderPass = ResourceSystem::Instance().getFrameBufferByID(m_meshFramebufferID).getRenderPass();
 
     PipelineInputData pipeline_data {
         vertexData,
@@ -0,0 +1,41 @@
+#include "BindlessTextures.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sge {
+BindlessTextures::BindlessTextures(Device& device, uint32_t capacity)
+    : m_capacity(std::min(capacity, device.getMaxUpdateAfterBindTextures())) {
+    assert(device.supportsDescriptorIndexing() && "Bindless textures need descriptor indexing");
+    // Unwritten slots stay invalid, PARTIALLY_BOUND allows that as long as the shader never indexes them
+    m_layout = DescriptorSetLayout::Builder(device)
+                   .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, m_capacity,
+                               VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                   VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+                   .build();
+    m_pool = DescriptorPool::Builder(device)
+                 .setMaxSets(1)
+                 .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                 .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_capacity)
+                 .build();
+    if (!m_pool->allocateDescriptor(m_layout->getDescriptorSetLayout(), m_set)) {
+        LOG_ERROR("Failed to allocate the bindless texture descriptor set!")
+        assert(false);
+    }
+    LOG_MSG("Bindless textures: " << m_capacity << " slots")
+}
+
+std::optional<uint32_t> BindlessTextures::add(const std::string& name, VkDescriptorImageInfo imageInfo) {
+    if (auto index = m_indices.find(name); index != m_indices.end()) return index->second;
+    if (m_indices.size() >= m_capacity) {
+        LOG_ERROR("Bindless texture array is full, can't add " << name)
+        return std::nullopt;
+    }
+    const auto index = static_cast<uint32_t>(m_indices.size());
+    DescriptorWriter(*m_layout, *m_pool).writeImage(0, &imageInfo, index).overwrite(m_set);
+    m_indices.emplace(name, index);
+    return index;
+}
+}  // namespace sge
@@ -48,12 +48,14 @@ namespace sge {
     Buffer::~Buffer() {
         unmap();
         vkDestroyBuffer(m_device.device(), m_buffer, nullptr);
-        vkFreeMemory(m_device.device(), m_memory, nullptr);
+        m_device.freeMemory(m_memory);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host-visible memory is persistently mapped by the allocator, this only hands out the pointer
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -61,21 +63,18 @@ namespace sge {
      * @return VkResult of the buffer mapping call
      */
     VkResult Buffer::map(const VkDeviceSize size, const VkDeviceSize offset) {
-        assert(m_buffer && m_memory && "Called map on buffer before create");
-        return vkMapMemory(m_device.device(), m_memory, offset, size, 0, &m_mapped);
+        assert(m_buffer && m_memory.isValid() && "Called map on buffer before create");
+        if (m_memory.mapped == nullptr) return VK_ERROR_MEMORY_MAP_FAILED;
+        m_mapped = static_cast<uint8_t*>(m_memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The memory itself stays mapped until it is freed
      */
-    void Buffer::unmap() {
-        if (m_mapped) {
-            vkUnmapMemory(m_device.device(), m_memory);
-            m_mapped = nullptr;
-        }
-    }
+    void Buffer::unmap() { m_mapped = nullptr; }
 
     /**
      * Copies the specified data to the mapped buffer. Default value writes whole buffer range
@@ -111,12 +110,7 @@ namespace sge {
      * @return VkResult of the flush call
      */
     VkResult Buffer::flush(const VkDeviceSize size, const VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+        return m_device.getAllocator().flush(m_memory, size, offset);
     }
 
     /**
@@ -131,12 +125,7 @@ namespace sge {
      * @return VkResult of the invalidate call
      */
     VkResult Buffer::invalidate(const VkDeviceSize size, const VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+        return m_device.getAllocator().invalidate(m_memory, size, offset);
     }
 
     /**
@@ -0,0 +1,260 @@
+#include "CompressedImage.h"
+
+#include "Logger.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+namespace sge {
+namespace {
+constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+
+struct DdsHeaderDx10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) noexcept {
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 |
+           static_cast<uint32_t>(d) << 24;
+}
+
+constexpr uint32_t DDS_MAGIC = fourCC('D', 'D', 'S', ' ');
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+VkFormat toUnorm(VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case VK_FORMAT_BC3_SRGB_BLOCK: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case VK_FORMAT_BC7_SRGB_BLOCK: return VK_FORMAT_BC7_UNORM_BLOCK;
+        default: return format;
+    }
+}
+
+VkFormat fromDxgiFormat(uint32_t dxgiFormat) noexcept {
+    switch (dxgiFormat) {
+        case 71:  // DXGI_FORMAT_BC1_UNORM
+        case 72: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case 77:  // DXGI_FORMAT_BC3_UNORM
+        case 78: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case 98:  // DXGI_FORMAT_BC7_UNORM
+        case 99: return VK_FORMAT_BC7_UNORM_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+VkFormat fromFourCC(uint32_t code) noexcept {
+    switch (code) {
+        case fourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case fourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+        case fourCC('A', 'T', 'I', '2'):
+        case fourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+size_t subImageSize(VkFormat format, uint32_t width, uint32_t height) noexcept {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * CompressedImage::getBlockSize(format);
+}
+
+//! Beyond any device's maxImageDimension2D, keeps the sub-image sizes of a malformed header from overflowing
+constexpr uint32_t MAX_EXTENT = 1u << 16;
+
+//! Length of the full mip chain, more levels would shift the extent by 32 or more bits
+uint32_t maxMipLevels(uint32_t width, uint32_t height) noexcept {
+    return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+}  // namespace
+
+/*static*/ std::optional<CompressedImage> CompressedImage::load(const std::filesystem::path& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    if (!file->isValid()) {
+        LOG_ERROR("Failed to open compressed texture: " << path.string())
+        return std::nullopt;
+    }
+    CompressedImage image;
+    image.m_file = std::move(file);
+    const auto extension = path.extension();
+    const bool parsed = extension == ".ktx2" ? image.parseKtx2() : extension == ".dds" && image.parseDds();
+    if (!parsed) {
+        LOG_ERROR("Unsupported compressed texture: " << path.string()
+                                                      << ", expected an uncompressed-stream BC1/BC3/BC5/BC7 image")
+        return std::nullopt;
+    }
+    return image;
+}
+
+/*static*/ uint32_t CompressedImage::getBlockSize(VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK: return 16;
+        default: return 0;
+    }
+}
+
+size_t CompressedImage::getDataSize() const noexcept {
+    return std::accumulate(m_subImages.begin(), m_subImages.end(), size_t{0},
+                           [](size_t sum, const SubImage& subImage) { return sum + subImage.data.size(); });
+}
+
+bool CompressedImage::addSubImage(uint32_t level, uint32_t layer, size_t offset) {
+    assert(level < maxMipLevels(m_width, m_height));
+    const uint32_t width = std::max(m_width >> level, 1u);
+    const uint32_t height = std::max(m_height >> level, 1u);
+    const size_t size = subImageSize(m_format, width, height);
+    if (offset > m_file->size() || m_file->size() - offset < size) return false;
+    m_subImages.push_back(SubImage{.level = level,
+                                   .layer = layer,
+                                   .width = width,
+                                   .height = height,
+                                   .data = std::span(m_file->data() + offset, size)});
+    return true;
+}
+
+bool CompressedImage::parseKtx2() {
+    Ktx2Header header;
+    if (m_file->size() < sizeof(header)) return false;
+    std::memcpy(&header, m_file->data(), sizeof(header));
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return false;
+    // Basis / zstd payloads would have to be transcoded first, arrays and 3D textures aren't used by the engine
+    if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1) return false;
+    if (header.faceCount != 1 && header.faceCount != 6) return false;
+
+    m_format = toUnorm(static_cast<VkFormat>(header.vkFormat));
+    m_width = header.pixelWidth;
+    m_height = header.pixelHeight;
+    m_mipLevels = std::max(header.levelCount, 1u);
+    m_layerCount = header.faceCount;
+    if (getBlockSize(m_format) == 0 || m_width == 0 || m_height == 0) return false;
+    if (m_width > MAX_EXTENT || m_height > MAX_EXTENT || m_mipLevels > maxMipLevels(m_width, m_height)) return false;
+    if (m_file->size() < sizeof(header) + sizeof(Ktx2Level) * m_mipLevels) return false;
+
+    for (uint32_t level = 0; level < m_mipLevels; ++level) {
+        Ktx2Level levelIndex;
+        std::memcpy(&levelIndex, m_file->data() + sizeof(header) + sizeof(Ktx2Level) * level, sizeof(levelIndex));
+        const size_t faceSize =
+            subImageSize(m_format, std::max(m_width >> level, 1u), std::max(m_height >> level, 1u));
+        // The level has to hold every face and lie in the file, which also keeps the face offsets from wrapping
+        if (levelIndex.byteOffset > m_file->size() || levelIndex.byteLength > m_file->size() - levelIndex.byteOffset ||
+            levelIndex.byteLength / m_layerCount < faceSize)
+            return false;
+        for (uint32_t face = 0; face < m_layerCount; ++face) {
+            if (!addSubImage(level, face, levelIndex.byteOffset + faceSize * face)) return false;
+        }
+    }
+    return true;
+}
+
+bool CompressedImage::parseDds() {
+    uint32_t magic;
+    DdsHeader header;
+    if (m_file->size() < sizeof(magic) + sizeof(header)) return false;
+    std::memcpy(&magic, m_file->data(), sizeof(magic));
+    std::memcpy(&header, m_file->data() + sizeof(magic), sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(header) || !(header.pixelFormat.flags & DDPF_FOURCC))
+        return false;
+
+    size_t offset = sizeof(magic) + sizeof(header);
+    bool cubemap = header.caps2 & DDSCAPS2_CUBEMAP;
+    if (header.pixelFormat.fourCC == fourCC('D', 'X', '1', '0')) {
+        DdsHeaderDx10 dx10Header;
+        if (m_file->size() < offset + sizeof(dx10Header)) return false;
+        std::memcpy(&dx10Header, m_file->data() + offset, sizeof(dx10Header));
+        offset += sizeof(dx10Header);
+        if (dx10Header.arraySize > 1) return false;
+        m_format = fromDxgiFormat(dx10Header.dxgiFormat);
+        cubemap = cubemap || (dx10Header.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE);
+    } else {
+        m_format = fromFourCC(header.pixelFormat.fourCC);
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_mipLevels = std::max(header.mipMapCount, 1u);
+    m_layerCount = cubemap ? 6 : 1;
+    if (getBlockSize(m_format) == 0 || m_width == 0 || m_height == 0) return false;
+    if (m_width > MAX_EXTENT || m_height > MAX_EXTENT || m_mipLevels > maxMipLevels(m_width, m_height)) return false;
+
+    // Unlike KTX2, DDS stores the whole chain of a face before the next face
+    for (uint32_t layer = 0; layer < m_layerCount; ++layer) {
+        for (uint32_t level = 0; level < m_mipLevels; ++level) {
+            if (!addSubImage(level, layer, offset)) return false;
+            offset += m_subImages.back().data.size();
+        }
+    }
+    return true;
+}
+}  // namespace sge
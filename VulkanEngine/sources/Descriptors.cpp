@@ -11,7 +11,8 @@ namespace sge {
 
 DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(uint32_t binding,
                                                                        VkDescriptorType descriptorType,
-                                                                       VkShaderStageFlags stageFlags, uint32_t count) {
+                                                                       VkShaderStageFlags stageFlags, uint32_t count,
+                                                                       VkDescriptorBindingFlags bindingFlags) {
     assert(m_bindings.count(binding) == 0 && "Binding already in use");
     VkDescriptorSetLayoutBinding layoutBinding{};
     layoutBinding.binding = binding;
@@ -19,26 +20,44 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(uint32_t
     layoutBinding.descriptorCount = count;
     layoutBinding.stageFlags = stageFlags;
     m_bindings[binding] = layoutBinding;
+    if (bindingFlags != 0) m_bindingFlags[binding] = bindingFlags;
     return *this;
 }
 
 std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-    return std::make_unique<DescriptorSetLayout>(m_device, m_bindings);
+    return std::make_unique<DescriptorSetLayout>(m_device, m_bindings, m_bindingFlags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 DescriptorSetLayout::DescriptorSetLayout(Device& device,
-                                         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+                                         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                                         const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags)
     : m_device{device}, m_bindings{bindings} {
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
-    for (auto kv : bindings) { setLayoutBindings.push_back(kv.second); }
+    // Parallel to setLayoutBindings
+    std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+    bool updateAfterBind = false;
+    for (auto kv : bindings) {
+        setLayoutBindings.push_back(kv.second);
+        const auto flags = bindingFlags.find(kv.first);
+        setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+        updateAfterBind |= (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
+    }
 
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
     descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
     descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+    if (!bindingFlags.empty()) descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+    if (updateAfterBind)
+        descriptorSetLayoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+
     if (vkCreateDescriptorSetLayout(m_device.device(), &descriptorSetLayoutInfo, nullptr, &m_descriptorSetLayout) !=
         VK_SUCCESS) {
         LOG_ERROR("failed to create descriptor set layout!");
@@ -53,6 +72,16 @@ DescriptorSetLayout::~DescriptorSetLayout() {
 DescriptorSetLayout::DescriptorSetLayout(const DescriptorSetLayout& other)
     : m_bindings(other.m_bindings), m_descriptorSetLayout(other.m_descriptorSetLayout), m_device(other.m_device) {}
 
+uint32_t DescriptorSetLayout::getDynamicOffsetCount() const noexcept {
+    uint32_t count = 0;
+    for (const auto& [binding, layoutBinding] : m_bindings) {
+        if (layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+            count += layoutBinding.descriptorCount;
+    }
+    return count;
+}
+
 // *************** Descriptor Pool Builder *********************
 
 DescriptorPool::Builder& DescriptorPool::Builder::addPoolSize(VkDescriptorType descriptorType, uint32_t count) {
@@ -136,17 +165,19 @@ DescriptorWriter& DescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorBu
     return *this;
 }
 
-DescriptorWriter& DescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo) {
+DescriptorWriter& DescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo,
+                                               uint32_t arrayElement) {
     assert(m_setLayout.m_bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
     auto& bindingDescription = m_setLayout.m_bindings[binding];
 
-    assert(bindingDescription.descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+    assert(arrayElement < bindingDescription.descriptorCount && "Array element is out of the binding range");
 
     VkWriteDescriptorSet write{};
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     write.descriptorType = bindingDescription.descriptorType;
     write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
     write.pImageInfo = imageInfo;
     write.descriptorCount = 1;
 
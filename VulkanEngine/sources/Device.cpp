@@ -5,6 +5,7 @@
 
 #include <Logger.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <set>
@@ -51,10 +52,18 @@ Device::Device(Window& window) : m_window(window) {
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    m_allocator = std::make_unique<MemoryAllocator>(m_physicalDevice, m_device);
+    m_pipelineCache =
+        std::make_unique<PipelineCache>(m_device, m_physicalProperties, m_supportsPipelineCreationFeedback);
 }
 
 Device::~Device() {
+    for (const auto& [threadId, commandPool] : m_threadCommandPools)
+        vkDestroyCommandPool(m_device, commandPool, nullptr);
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    m_allocator.reset();
+    m_pipelineCache->save();
+    m_pipelineCache.reset();
     vkDestroyDevice(m_device, nullptr);
     if (m_enableValidationLayers) {
         auto func = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
@@ -176,6 +185,7 @@ void Device::createLogicalDevice() {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily,
                                               indices.presentFamily};  // for unique queue family id
+    if (indices.transferFamilyHasValue) uniqueQueueFamilies.insert(indices.transferFamily);
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo = {};
@@ -188,16 +198,31 @@ void Device::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.geometryShader = VK_TRUE;
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+    m_supportsBlockCompression = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    std::vector<const char*> deviceExtensions = m_deviceExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    m_supportsDescriptorIndexing = querySupportedDescriptorIndexing(descriptorIndexingFeatures);
+    if (m_supportsDescriptorIndexing) {
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        LOG_MSG("Descriptor indexing is enabled, material textures are bindless")
+    }
+    m_supportsPipelineCreationFeedback = querySupportedPipelineCreationFeedback(deviceExtensions);
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    if (m_supportsDescriptorIndexing) createInfo.pNext = &descriptorIndexingFeatures;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
     if (m_enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(m_validationLayers.size());
@@ -215,12 +240,20 @@ void Device::createLogicalDevice() {
         for (auto& device_extenstion : m_availableExtensions)
             LOG_MSG(device_extenstion.extensionName << " Version: " << device_extenstion.specVersion)
         LOG_MSG("Requested extensions:\n")
-        for (auto extenstion : m_deviceExtensions) LOG_MSG(extenstion)
+        for (auto extenstion : deviceExtensions) LOG_MSG(extenstion)
         LOG_MSG_FLUSH
         assert(false);
     }
     vkGetDeviceQueue(m_device, indices.graphicsFamily, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily, 0, &m_presentQueue);
+    m_hasDedicatedTransferQueue = indices.transferFamilyHasValue;
+    if (m_hasDedicatedTransferQueue) {
+        vkGetDeviceQueue(m_device, indices.transferFamily, 0, &m_transferQueue);
+        LOG_MSG("Uploads use the dedicated transfer queue family " << indices.transferFamily)
+    } else {
+        m_transferQueue = m_graphicsQueue;
+        LOG_MSG("No transfer-only queue family, uploads use the graphics queue")
+    }
 }
 
 const VkPhysicalDeviceProperties& Device::getPhysicalDeviceProperties() const noexcept { return m_physicalProperties; }
@@ -249,6 +282,10 @@ VkQueue Device::graphicsQueue() const noexcept { return m_graphicsQueue; }
 
 VkQueue Device::presentQueue() const noexcept { return m_presentQueue; }
 
+VkQueue Device::transferQueue() const noexcept { return m_transferQueue; }
+
+bool Device::hasDedicatedTransferQueue() const noexcept { return m_hasDedicatedTransferQueue; }
+
 VkCommandPool Device::getCommandPool() const noexcept { return m_commandPool; }
 
 VkInstance Device::getInstance() const noexcept { return m_instance; }
@@ -278,6 +315,18 @@ QueueFamilyIndices Device::findQueueFamilies(const VkPhysicalDevice device) cons
         if (indices.isComplete()) break;
         ++i;
     }
+    // Prefer a pure copy family over one that also does compute
+    for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+        const auto flags = queueFamilies[family].queueFlags;
+        if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) ||
+            (flags & VK_QUEUE_GRAPHICS_BIT))
+            continue;
+        if (!indices.transferFamilyHasValue || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+            indices.transferFamily = family;
+            indices.transferFamilyHasValue = true;
+        }
+        if (!(flags & VK_QUEUE_COMPUTE_BIT)) break;
+    }
     return indices;
 }
 
@@ -398,7 +447,72 @@ VkFormat Device::findSupportedFormat(const std::vector<VkFormat>& candidates, Vk
     return VK_FORMAT_UNDEFINED;
 }
 
-[[nodiscard]] VkImageView Device::createImageView(const VkImage image, const VkFormat format, bool isCubeMap) noexcept {
+bool Device::supportsLinearBlit(VkFormat format) const noexcept {
+    constexpr VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &props);
+    return (props.optimalTilingFeatures & features) == features;
+}
+
+bool Device::supportsBlockCompression() const noexcept { return m_supportsBlockCompression; }
+
+bool Device::supportsDescriptorIndexing() const noexcept { return m_supportsDescriptorIndexing; }
+
+uint32_t Device::getMaxUpdateAfterBindTextures() const noexcept { return m_maxUpdateAfterBindTextures; }
+
+bool Device::querySupportedPipelineCreationFeedback(std::vector<const char*>& extensions) const {
+    if (m_physicalProperties.apiVersion >= VK_API_VERSION_1_3) return true;
+    const bool hasExtension = std::any_of(m_availableExtensions.cbegin(), m_availableExtensions.cend(),
+                                          [](const VkExtensionProperties& extension) {
+                                              return strcmp(extension.extensionName,
+                                                            VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME) == 0;
+                                          });
+    if (hasExtension) extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    return hasExtension;
+}
+
+bool Device::querySupportedDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeatures& features) {
+    const bool hasExtension = std::any_of(m_availableExtensions.cbegin(), m_availableExtensions.cend(),
+                                          [](const VkExtensionProperties& extension) {
+                                              return strcmp(extension.extensionName,
+                                                            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+                                          });
+    if (!hasExtension) return false;
+
+    VkPhysicalDeviceDescriptorIndexingFeatures supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supported;
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+    if (!supported.shaderSampledImageArrayNonUniformIndexing ||
+        !supported.descriptorBindingSampledImageUpdateAfterBind ||
+        !supported.descriptorBindingUpdateUnusedWhilePending || !supported.descriptorBindingPartiallyBound ||
+        !supported.runtimeDescriptorArray)
+        return false;
+
+    VkPhysicalDeviceDescriptorIndexingProperties properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &properties;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+    m_maxUpdateAfterBindTextures = std::min({properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                             properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                             properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                             properties.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.runtimeDescriptorArray = VK_TRUE;
+    return true;
+}
+
+[[nodiscard]] VkImageView Device::createImageView(const VkImage image, const VkFormat format, bool isCubeMap,
+                                                  uint32_t mipLevels) noexcept {
     uint32_t layerCount = isCubeMap ? 6 : 1;
     VkImageViewCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -411,7 +525,7 @@ VkFormat Device::findSupportedFormat(const std::vector<VkFormat>& candidates, Vk
     createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
     createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     createInfo.subresourceRange.baseMipLevel = 0;
-    createInfo.subresourceRange.levelCount = 1;
+    createInfo.subresourceRange.levelCount = mipLevels;
     createInfo.subresourceRange.baseArrayLayer = 0;
     createInfo.subresourceRange.layerCount = layerCount;
 
@@ -440,6 +554,31 @@ void Device::createCommandPool() {
     VK_CHECK_RESULT(result, "Failed to create command pool!")
 }
 
+VkCommandPool Device::getThreadCommandPool() const {
+    std::scoped_lock lock(m_threadCommandPoolsMutex);
+    auto& commandPool = m_threadCommandPools[std::this_thread::get_id()];
+    if (commandPool != VK_NULL_HANDLE) return commandPool;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = findPhysicalQueueFamilies().graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    VK_CHECK_RESULT(vkCreateCommandPool(m_device, &poolInfo, nullptr, &commandPool),
+                    "Failed to create single time command pool!")
+    return commandPool;
+}
+
+std::mutex& Device::queueMutex() const noexcept { return m_queueMutex; }
+
+std::mutex& Device::transferQueueMutex() const noexcept {
+    return m_hasDedicatedTransferQueue ? m_transferQueueMutex : m_queueMutex;
+}
+
+void Device::waitIdle() const {
+    std::scoped_lock lock(m_queueMutex, m_transferQueueMutex);
+    VK_CHECK_RESULT(vkDeviceWaitIdle(m_device), "Failed to device wait idle");
+}
+
 void Device::endSingleTimeCommands(const VkCommandBuffer commandBuffer) const {
     VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer), "Failed to end command buffer");
 
@@ -448,17 +587,26 @@ void Device::endSingleTimeCommands(const VkCommandBuffer commandBuffer) const {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    VK_CHECK_RESULT(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE), "Failed to queue submit");
-    VK_CHECK_RESULT(vkQueueWaitIdle(m_graphicsQueue), "Failed to queue wait idle");
+    // A fence instead of vkQueueWaitIdle: the wait must not include frames the render thread submitted meanwhile
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    VK_CHECK_RESULT(vkCreateFence(m_device, &fenceInfo, nullptr, &fence), "Failed to create fence");
+    {
+        std::scoped_lock lock(m_queueMutex);
+        VK_CHECK_RESULT(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, fence), "Failed to queue submit");
+    }
+    VK_CHECK_RESULT(vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX), "Failed to wait for fence");
+    vkDestroyFence(m_device, fence, nullptr);
 
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+    vkFreeCommandBuffers(m_device, getThreadCommandPool(), 1, &commandBuffer);
 }
 
 VkCommandBuffer Device::beginSingleTimeCommands() const {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = m_commandPool;
+    allocInfo.commandPool = getThreadCommandPool();
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
@@ -487,26 +635,33 @@ uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
 }
 
 void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image,
-                                 VkDeviceMemory& imageMemory) {
+                                 MemoryAllocation& imageMemory) {
     auto result = vkCreateImage(m_device, &imageInfo, nullptr, &image);
     VK_CHECK_RESULT(result, "Failed to create image!")
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_device, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    result = vkAllocateMemory(m_device, &allocInfo, nullptr, &imageMemory);
-    VK_CHECK_RESULT(result, "Failed to allocate image memory!")
-    result = vkBindImageMemory(m_device, image, imageMemory, 0);
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memRequirements{};
+    memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memRequirements.pNext = &dedicatedRequirements;
+    VkImageMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.image = image;
+    vkGetImageMemoryRequirements2(m_device, &requirementsInfo, &memRequirements);
+
+    const auto kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::ResourceKind::Linear
+                                                                 : MemoryAllocator::ResourceKind::Optimal;
+    const bool preferDedicated =
+        dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    imageMemory = m_allocator->allocate(memRequirements.memoryRequirements,
+                                        findMemoryType(memRequirements.memoryRequirements.memoryTypeBits, properties),
+                                        kind, preferDedicated, image);
+    result = vkBindImageMemory(m_device, image, imageMemory.memory, imageMemory.offset);
     VK_CHECK_RESULT(result, "Failed to bind image memory!")
 }
 
 void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                          VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+                          VkBuffer& buffer, MemoryAllocation& bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -514,93 +669,31 @@ void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     auto result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer);
     VK_CHECK_RESULT(result, "Failed to create vertex buffer!")
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-    result = vkAllocateMemory(m_device, &allocInfo, nullptr, &bufferMemory);
-    VK_CHECK_RESULT(result, "Failed to allocate vertex buffer memory!")
-    VK_CHECK_RESULT(vkBindBufferMemory(m_device, buffer, bufferMemory, 0), "Failed to bind buffer memory");
-}
 
-void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;  // Optional
-    copyRegion.dstOffset = 0;  // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    endSingleTimeCommands(commandBuffer);
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memRequirements{};
+    memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memRequirements.pNext = &dedicatedRequirements;
+    VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.buffer = buffer;
+    vkGetBufferMemoryRequirements2(m_device, &requirementsInfo, &memRequirements);
+
+    bufferMemory = m_allocator->allocate(
+        memRequirements.memoryRequirements,
+        findMemoryType(memRequirements.memoryRequirements.memoryTypeBits, properties),
+        MemoryAllocator::ResourceKind::Linear, dedicatedRequirements.requiresDedicatedAllocation, VK_NULL_HANDLE,
+        buffer);
+    result = vkBindBufferMemory(m_device, buffer, bufferMemory.memory, bufferMemory.offset);
+    VK_CHECK_RESULT(result, "Failed to bind buffer memory");
 }
 
-void Device::copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
-                               uint32_t layerCount) const {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = layerCount;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    vkCmdCopyBufferToImage(commandBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    endSingleTimeCommands(commandBuffer);
-}
+void Device::freeMemory(MemoryAllocation& allocation) const { m_allocator->free(allocation); }
 
-void Device::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
-                                   uint32_t layerCount) const {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = layerCount;
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-               newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        LOG_ERROR("unsupported layout transition!");
-        assert(false);
-    }
+MemoryAllocator& Device::getAllocator() const noexcept { return *m_allocator; }
 
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-    endSingleTimeCommands(commandBuffer);
-}
+PipelineCache& Device::getPipelineCache() const noexcept { return *m_pipelineCache; }
 
 void Device::setupDebugMessenger() {
     if (!m_enableValidationLayers) return;
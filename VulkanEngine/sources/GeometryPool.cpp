@@ -0,0 +1,55 @@
+#include "GeometryPool.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sge {
+GeometryPool::GeometryPool(Device& device, VkDeviceSize blockSize) : m_device(device), m_blockSize(blockSize) {}
+
+GeometryPool::Allocation GeometryPool::allocate(VkBufferUsageFlags usage, uint32_t elementSize, uint32_t count) {
+    assert(elementSize != 0 && count != 0 && "Empty geometry allocation");
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    std::scoped_lock lock(m_mutex);
+    for (auto& block : m_blocks) {
+        if (block.usage != usage || block.elementSize != elementSize || block.capacity - block.used < count)
+            continue;
+        Allocation allocation{.buffer = block.buffer->getBuffer(), .offset = block.used, .count = count};
+        block.used += count;
+        return allocation;
+    }
+
+    const auto blockCapacity = static_cast<uint32_t>(std::max<VkDeviceSize>(m_blockSize / elementSize, count));
+    auto& block = m_blocks.emplace_back(Block{
+        .buffer = std::make_unique<Buffer>(m_device, elementSize, blockCapacity, usage,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+        .usage = usage,
+        .elementSize = elementSize,
+        .capacity = blockCapacity,
+        .used = count});
+    LOG_MSG("Geometry pool: new block of " << blockCapacity << " x " << elementSize << " bytes")
+    return Allocation{.buffer = block.buffer->getBuffer(), .offset = 0, .count = count};
+}
+
+void GeometryPool::upload(const Allocation& allocation, uint32_t elementSize, const void* data,
+                          UploadContext& uploadContext) {
+    assert(allocation.isValid() && "Upload to an empty geometry allocation");
+    const VkDeviceSize size = static_cast<VkDeviceSize>(elementSize) * allocation.count;
+    auto& stagingBuffer = uploadContext.createStagingBuffer(size);
+    stagingBuffer.writeToBuffer(data);
+    uploadContext.copyBuffer(stagingBuffer.getBuffer(), allocation.buffer, size,
+                             static_cast<VkDeviceSize>(elementSize) * allocation.offset);
+}
+
+GeometryPool::Statistics GeometryPool::getStatistics() const {
+    std::scoped_lock lock(m_mutex);
+    Statistics statistics{.blockCount = m_blocks.size()};
+    for (const auto& block : m_blocks) {
+        statistics.reservedBytes += block.buffer->getBufferSize();
+        statistics.usedBytes += static_cast<VkDeviceSize>(block.used) * block.elementSize;
+    }
+    return statistics;
+}
+}  // namespace sge
@@ -31,6 +31,8 @@ void Logger::flush() const noexcept {
     std::cout << std::flush;
     out_stream << std::flush;
 }
+std::recursive_mutex& Logger::mutex() noexcept { return m_mutex; }
+
 Logger::~Logger() { out_stream.close(); }
 
 Logger::Logger() {
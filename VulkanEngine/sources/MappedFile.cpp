@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace sge {
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path) noexcept {
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        return;
+    }
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) return;
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) return;
+
+    m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data != nullptr) m_size = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != nullptr) CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path) noexcept {
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) return;
+
+    struct stat fileInfo {};
+    if (fstat(m_fd, &fileInfo) != 0 || fileInfo.st_size == 0) return;
+
+    void* data = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) return;
+    madvise(data, static_cast<size_t>(fileInfo.st_size), MADV_SEQUENTIAL);
+
+    m_data = static_cast<const std::byte*>(data);
+    m_size = static_cast<size_t>(fileInfo.st_size);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) munmap(const_cast<std::byte*>(m_data), m_size);
+    if (m_fd >= 0) close(m_fd);
+}
+#endif
+
+bool MappedFile::isValid() const noexcept { return m_data != nullptr; }
+
+const std::byte* MappedFile::data() const noexcept { return m_data; }
+
+size_t MappedFile::size() const noexcept { return m_size; }
+}  // namespace sge
@@ -0,0 +1,257 @@
+#include "MemoryAllocator.h"
+
+#include "Logger.h"
+#include "VulkanHelpUtils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <optional>
+
+namespace sge {
+namespace {
+constexpr size_t KIND_COUNT = static_cast<size_t>(MemoryAllocator::ResourceKind::Count);
+
+constexpr VkDeviceSize orderSize(const uint32_t order) noexcept {
+    return MemoryAllocator::MIN_ALLOCATION_SIZE << order;
+}
+
+//! Smallest order whose ranges fit size and, being naturally aligned, satisfy alignment
+uint32_t sizeToOrder(const VkDeviceSize size, const VkDeviceSize alignment) noexcept {
+    const VkDeviceSize chunkSize =
+        std::bit_ceil(std::max({size, alignment, MemoryAllocator::MIN_ALLOCATION_SIZE}));
+    return static_cast<uint32_t>(std::countr_zero(chunkSize / MemoryAllocator::MIN_ALLOCATION_SIZE));
+}
+
+std::optional<VkDeviceSize> allocateFromBlock(MemoryBlock& block, const uint32_t order) {
+    uint32_t freeOrder = order;
+    while (freeOrder < block.freeLists.size() && block.freeLists[freeOrder].empty()) ++freeOrder;
+    if (freeOrder >= block.freeLists.size()) return std::nullopt;
+
+    const VkDeviceSize offset = *block.freeLists[freeOrder].begin();
+    block.freeLists[freeOrder].erase(block.freeLists[freeOrder].begin());
+    // Split down to the requested order, the upper halves become free buddies
+    while (freeOrder > order) {
+        --freeOrder;
+        block.freeLists[freeOrder].insert(offset + orderSize(freeOrder));
+    }
+    return offset;
+}
+
+void freeToBlock(MemoryBlock& block, VkDeviceSize offset, uint32_t order) {
+    while (order + 1 < block.freeLists.size()) {
+        const VkDeviceSize buddy = offset ^ orderSize(order);
+        auto buddyIt = block.freeLists[order].find(buddy);
+        if (buddyIt == block.freeLists[order].end()) break;
+        block.freeLists[order].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    block.freeLists[order].insert(offset);
+}
+}  // namespace
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : m_device(device) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    m_pools.resize(m_memoryProperties.memoryTypeCount * KIND_COUNT);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    for (auto& pool : m_pools) {
+        for (auto& block : pool) {
+            if (block->allocationCount != 0)
+                LOG_ERROR("MemoryAllocator: " << block->allocationCount << " allocations leaked in a memory block")
+            vkFreeMemory(m_device, block->memory, nullptr);
+        }
+    }
+    if (m_dedicatedCount != 0) LOG_ERROR("MemoryAllocator: " << m_dedicatedCount << " dedicated allocations leaked")
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(const uint32_t memoryTypeIndex) const noexcept {
+    // Small heaps (e.g. the host-visible BAR window) would be eaten by a couple of default blocks
+    const VkDeviceSize heapSize =
+        m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return std::max(MIN_ALLOCATION_SIZE, std::min(DEFAULT_BLOCK_SIZE, std::bit_floor(heapSize / 8)));
+}
+
+bool MemoryAllocator::isHostVisible(const uint32_t memoryTypeIndex) const noexcept {
+    return m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, const uint32_t memoryTypeIndex,
+                                           const ResourceKind kind, const bool preferDedicated,
+                                           const VkImage dedicatedImage, const VkBuffer dedicatedBuffer) {
+    const VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+    if (preferDedicated || requirements.size > blockSize / 2)
+        return allocateDedicated(requirements.size, memoryTypeIndex, dedicatedImage, dedicatedBuffer);
+
+    // Flushes of non-coherent memory work on whole atoms, so neighbours must not share one
+    VkDeviceSize alignment = requirements.alignment;
+    const auto flags = m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        alignment = std::max(alignment, m_nonCoherentAtomSize);
+    const uint32_t order = sizeToOrder(requirements.size, alignment);
+
+    std::scoped_lock lock(m_mutex);
+    const size_t poolIndex = memoryTypeIndex * KIND_COUNT + static_cast<size_t>(kind);
+    auto& pool = m_pools[poolIndex];
+    for (auto& block : pool) {
+        if (auto offset = allocateFromBlock(*block, order)) {
+            block->usedBytes += requirements.size;
+            ++block->allocationCount;
+            return MemoryAllocation{
+                .memory = block->memory,
+                .offset = *offset,
+                .size = requirements.size,
+                .mapped = block->mapped ? static_cast<std::byte*>(block->mapped) + *offset : nullptr,
+                .block = block.get(),
+                .order = order};
+        }
+    }
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->size = blockSize;
+    block->poolIndex = poolIndex;
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = blockSize;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    auto result = vkAllocateMemory(m_device, &allocInfo, nullptr, &block->memory);
+    VK_CHECK_RESULT(result, "MemoryAllocator: failed to allocate memory block")
+    if (isHostVisible(memoryTypeIndex)) {
+        result = vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+        VK_CHECK_RESULT(result, "MemoryAllocator: failed to map memory block")
+    }
+
+    const auto maxOrder = static_cast<uint32_t>(std::countr_zero(blockSize / MIN_ALLOCATION_SIZE));
+    block->freeLists.resize(maxOrder + 1);
+    block->freeLists[maxOrder].insert(0);
+    LOG_MSG("MemoryAllocator: new " << (blockSize >> 20) << " MB block for memory type " << memoryTypeIndex
+                                    << (kind == ResourceKind::Linear ? " (linear)" : " (optimal)"))
+
+    const auto offset = allocateFromBlock(*block, order);
+    assert(offset && "Allocation must fit an empty block");
+    block->usedBytes += requirements.size;
+    ++block->allocationCount;
+    MemoryAllocation allocation{
+        .memory = block->memory,
+        .offset = *offset,
+        .size = requirements.size,
+        .mapped = block->mapped ? static_cast<std::byte*>(block->mapped) + *offset : nullptr,
+        .block = block.get(),
+        .order = order};
+    pool.push_back(std::move(block));
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateDedicated(const VkDeviceSize size, const uint32_t memoryTypeIndex,
+                                                    const VkImage image, const VkBuffer buffer) {
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.image = image;
+    dedicatedInfo.buffer = buffer;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = (image != VK_NULL_HANDLE || buffer != VK_NULL_HANDLE) ? &dedicatedInfo : nullptr;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    MemoryAllocation allocation{.size = size};
+    auto result = vkAllocateMemory(m_device, &allocInfo, nullptr, &allocation.memory);
+    VK_CHECK_RESULT(result, "MemoryAllocator: failed to allocate dedicated memory")
+    if (isHostVisible(memoryTypeIndex)) {
+        result = vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped);
+        VK_CHECK_RESULT(result, "MemoryAllocator: failed to map dedicated memory")
+    }
+
+    std::scoped_lock lock(m_mutex);
+    ++m_dedicatedCount;
+    m_dedicatedBytes += size;
+    return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation) {
+    if (!allocation.isValid()) return;
+    std::scoped_lock lock(m_mutex);
+    if (allocation.block == nullptr) {
+        vkFreeMemory(m_device, allocation.memory, nullptr);
+        --m_dedicatedCount;
+        m_dedicatedBytes -= allocation.size;
+        allocation = {};
+        return;
+    }
+
+    MemoryBlock& block = *allocation.block;
+    freeToBlock(block, allocation.offset, allocation.order);
+    block.usedBytes -= allocation.size;
+    --block.allocationCount;
+    allocation = {};
+
+    // Keep one empty block per pool around so alternating load / unload doesn't hit the driver
+    auto& pool = m_pools[block.poolIndex];
+    if (block.allocationCount == 0 && pool.size() > 1) {
+        auto blockIt =
+            std::find_if(pool.begin(), pool.end(), [&block](const auto& item) { return item.get() == &block; });
+        vkFreeMemory(m_device, block.memory, nullptr);
+        pool.erase(blockIt);
+    }
+}
+
+VkMappedMemoryRange MemoryAllocator::getMappedRange(const MemoryAllocation& allocation, const VkDeviceSize size,
+                                                    const VkDeviceSize offset) const noexcept {
+    VkMappedMemoryRange mappedRange{};
+    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRange.memory = allocation.memory;
+    mappedRange.offset = allocation.offset + offset;
+    if (size != VK_WHOLE_SIZE)
+        mappedRange.size = size;
+    else
+        // A dedicated allocation ends with its memory object, a buddy range is a multiple of the atom size
+        mappedRange.size = allocation.block ? orderSize(allocation.order) - offset : VK_WHOLE_SIZE;
+    return mappedRange;
+}
+
+VkResult MemoryAllocator::flush(const MemoryAllocation& allocation, const VkDeviceSize size,
+                                const VkDeviceSize offset) const {
+    const auto mappedRange = getMappedRange(allocation, size, offset);
+    return vkFlushMappedMemoryRanges(m_device, 1, &mappedRange);
+}
+
+VkResult MemoryAllocator::invalidate(const MemoryAllocation& allocation, const VkDeviceSize size,
+                                     const VkDeviceSize offset) const {
+    const auto mappedRange = getMappedRange(allocation, size, offset);
+    return vkInvalidateMappedMemoryRanges(m_device, 1, &mappedRange);
+}
+
+MemoryAllocator::Statistics MemoryAllocator::getStatistics() const {
+    std::scoped_lock lock(m_mutex);
+    Statistics statistics{.dedicatedCount = m_dedicatedCount,
+                          .allocationCount = m_dedicatedCount,
+                          .reservedBytes = m_dedicatedBytes,
+                          .usedBytes = m_dedicatedBytes};
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFreeBytes = 0;
+    for (const auto& pool : m_pools) {
+        for (const auto& block : pool) {
+            ++statistics.blockCount;
+            statistics.allocationCount += block->allocationCount;
+            statistics.reservedBytes += block->size;
+            statistics.usedBytes += block->usedBytes;
+            VkDeviceSize blockLargestFree = 0;
+            for (uint32_t order = 0; order < block->freeLists.size(); ++order) {
+                freeBytes += block->freeLists[order].size() * orderSize(order);
+                if (!block->freeLists[order].empty()) blockLargestFree = orderSize(order);
+            }
+            largestFreeBytes += blockLargestFree;
+        }
+    }
+    if (freeBytes != 0)
+        statistics.fragmentation = 1.f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes);
+    return statistics;
+}
+}  // namespace sge
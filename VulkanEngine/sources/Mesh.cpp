@@ -1,24 +1,55 @@
 #include "Mesh.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 namespace sge {
 Mesh& Mesh::operator=(Mesh&& other) noexcept {
     m_ind = std::move(other.m_ind);
     m_pos = std::move(other.m_pos);
-    m_indexBuffer = std::move(other.m_indexBuffer);
-    m_vertexBuffer = std::move(other.m_vertexBuffer);
+    m_indexType = other.m_indexType;
+    m_instances = std::move(other.m_instances);
+    m_vertexAllocation = std::exchange(other.m_vertexAllocation, {});
+    m_indexAllocation = std::exchange(other.m_indexAllocation, {});
+    m_instanceAllocation = std::exchange(other.m_instanceAllocation, {});
     m_modelMatrix = std::move(other.m_modelMatrix);
     m_material = std::move(other.m_material);
     m_materialType = std::move(other.m_materialType);
     m_pipelineId = std::move(other.m_pipelineId);
     m_descriptorSetId = std::move(other.m_descriptorSetId);
+    m_objectIndex = other.m_objectIndex;
     m_name = std::move(other.m_name);
+    m_boundingBox = other.m_boundingBox;
+    m_mappedFile = std::move(other.m_mappedFile);
+    m_mappedVertices = std::exchange(other.m_mappedVertices, {});
+    m_mappedIndices = std::exchange(other.m_mappedIndices, {});
+    m_vertexFormat = other.m_vertexFormat;
+    m_quantizedPos = std::move(other.m_quantizedPos);
+    m_positionScale = other.m_positionScale;
+    m_positionOffset = other.m_positionOffset;
+    m_lods = std::move(other.m_lods);
+    m_currentLod = other.m_currentLod;
+    m_instanceBounds = other.m_instanceBounds;
+    m_maxInstanceScale = other.m_maxInstanceScale;
     return *this;
 }
 Mesh::Mesh(Mesh&& other) noexcept
-    : m_ind(std::move(other.m_ind)), m_pos(std::move(other.m_pos)), m_indexBuffer(std::move(other.m_indexBuffer)),
-      m_vertexBuffer(std::move(other.m_vertexBuffer)), m_modelMatrix(std::move(other.m_modelMatrix)),
+    : m_ind(std::move(other.m_ind)), m_pos(std::move(other.m_pos)), m_instances(std::move(other.m_instances)),
+      m_vertexAllocation(std::exchange(other.m_vertexAllocation, {})),
+      m_indexAllocation(std::exchange(other.m_indexAllocation, {})),
+      m_instanceAllocation(std::exchange(other.m_instanceAllocation, {})), m_indexType(other.m_indexType),
+      m_modelMatrix(std::move(other.m_modelMatrix)),
       m_material(std::move(other.m_material)), m_materialType(std::move(other.m_materialType)),
       m_pipelineId(std::move(other.m_pipelineId)), m_descriptorSetId(std::move(other.m_descriptorSetId)),
-      m_name(std::move(other.m_name)) {}
+      m_objectIndex(other.m_objectIndex), m_name(std::move(other.m_name)), m_boundingBox(other.m_boundingBox),
+      m_mappedFile(std::move(other.m_mappedFile)), m_mappedVertices(std::exchange(other.m_mappedVertices, {})),
+      m_mappedIndices(std::exchange(other.m_mappedIndices, {})), m_vertexFormat(other.m_vertexFormat),
+      m_quantizedPos(std::move(other.m_quantizedPos)), m_positionScale(other.m_positionScale),
+      m_positionOffset(other.m_positionOffset), m_lods(std::move(other.m_lods)), m_currentLod(other.m_currentLod),
+      m_instanceBounds(other.m_instanceBounds), m_maxInstanceScale(other.m_maxInstanceScale) {}
 
 void Mesh::setModelMatrix(const glm::mat4& matrix) { m_modelMatrix = matrix; }
 
@@ -28,9 +59,16 @@ void Mesh::setName(const std::string_view newName) noexcept { m_name = newName;
 
 const glm::mat4& Mesh::getModelMatrix() const { return m_modelMatrix; }
 
-uint32_t Mesh::getVertexCount() const { return static_cast<uint32_t>(m_pos.size()); }
+uint32_t Mesh::getVertexCount() const {
+    if (m_vertexFormat == VertexFormat::Quantized) return static_cast<uint32_t>(m_quantizedPos.size());
+    return static_cast<uint32_t>(getVertices().size());
+}
+
+uint32_t Mesh::getIndexCount() const { return static_cast<uint32_t>(getIndices().size()); }
 
-uint32_t Mesh::getIndexCount() const { return static_cast<uint32_t>(m_ind.size()); }
+uint32_t Mesh::getInstanceCount() const noexcept {
+    return std::max<uint32_t>(1, static_cast<uint32_t>(m_instances.size()));
+}
 
 uint32_t Mesh::getPipelineId() const { return m_pipelineId; }
 
@@ -38,6 +76,61 @@ uint32_t Mesh::getDescriptorSetId() const { return m_descriptorSetId; }
 
 const std::string& Mesh::getName() const noexcept { return m_name; }
 
+std::span<const Vertex> Mesh::getVertices() const noexcept {
+    if (m_pos.empty()) return m_mappedVertices;
+    return m_pos;
+}
+
+std::span<const uint32_t> Mesh::getIndices() const noexcept {
+    if (m_ind.empty()) return m_mappedIndices;
+    return m_ind;
+}
+
+void Mesh::setMappedData(std::shared_ptr<const MappedFile> file, std::span<const Vertex> vertices,
+                         std::span<const uint32_t> indices) noexcept {
+    m_mappedFile = std::move(file);
+    m_mappedVertices = vertices;
+    m_mappedIndices = indices;
+}
+
+void Mesh::clearVertices() noexcept {
+    m_pos.clear();
+    m_pos.shrink_to_fit();
+    m_mappedVertices = {};
+}
+
+std::span<const std::byte> Mesh::getVertexData() const noexcept {
+    if (m_vertexFormat == VertexFormat::Quantized) return std::as_bytes(std::span(m_quantizedPos));
+    return std::as_bytes(getVertices());
+}
+
+uint32_t Mesh::getVertexStride() const noexcept {
+    if (m_vertexFormat == VertexFormat::Quantized) return sizeof(QuantizedVertex);
+    return sizeof(Vertex);
+}
+
+void Mesh::updateInstanceBounds() noexcept {
+    const InstanceData identity{};
+    const std::span<const InstanceData> instances =
+        m_instances.empty() ? std::span<const InstanceData>(&identity, 1) : std::span(m_instances);
+    const glm::vec3 center = (m_boundingBox.min + m_boundingBox.max) * 0.5f;
+    const glm::vec3 halfExtent = (m_boundingBox.max - m_boundingBox.min) * 0.5f;
+    m_instanceBounds = {glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+    m_maxInstanceScale = 0.f;
+    for (const auto& instance : instances) {
+        const glm::mat4& matrix = instance.m_modelMatrix;
+        // The transformed box's half extent is the box's half extent through the absolute rotation and scale
+        const glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])),
+                                 glm::abs(glm::vec3(matrix[2])));
+        const glm::vec3 instanceCenter = matrix * glm::vec4(center, 1.f);
+        const glm::vec3 instanceHalfExtent = absolute * halfExtent;
+        m_instanceBounds.min = glm::min(m_instanceBounds.min, instanceCenter - instanceHalfExtent);
+        m_instanceBounds.max = glm::max(m_instanceBounds.max, instanceCenter + instanceHalfExtent);
+        m_maxInstanceScale = std::max({m_maxInstanceScale, glm::length(glm::vec3(matrix[0])),
+                                       glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))});
+    }
+}
+
 /*static*/ std::vector<VkVertexInputBindingDescription> Vertex::getBindingDescription() noexcept {
     std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
         {
@@ -73,4 +166,75 @@ const std::string& Mesh::getName() const noexcept { return m_name; }
     return attributeDescriptions;
 }
 
+/*static*/ std::vector<VkVertexInputBindingDescription> QuantizedVertex::getBindingDescription() noexcept {
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
+        {
+            .binding = 0,
+            .stride = sizeof(QuantizedVertex),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        }
+    };
+    return bindingDescriptions;
+}
+/*static*/ std::vector<VkVertexInputAttributeDescription> QuantizedVertex::getAttributeDescription() noexcept {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {
+        {
+            .location = 0,
+            .binding = 0,
+            .format = VK_FORMAT_R16G16B16A16_UNORM,
+            .offset = offsetof(QuantizedVertex, m_position)
+        },
+        {
+            .location = 1,
+            .binding = 0,
+            .format = VK_FORMAT_R16G16_SNORM,
+            .offset = offsetof(QuantizedVertex, m_normal)
+        },
+        {
+            .location = 2,
+            .binding = 0,
+            .format = VK_FORMAT_R16G16_SFLOAT,
+            .offset = offsetof(QuantizedVertex, m_UV)
+        },
+    };
+
+    return attributeDescriptions;
+}
+
+InstanceData::InstanceData(const glm::mat4& modelMatrix) noexcept
+    : m_modelMatrix(modelMatrix), m_normalMatrix(glm::transpose(glm::inverse(glm::mat3(modelMatrix)))) {}
+
+/*static*/ std::vector<VkVertexInputBindingDescription> InstanceData::getBindingDescription() noexcept {
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
+        {
+            .binding = 1,
+            .stride = sizeof(InstanceData),
+            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+        }
+    };
+    return bindingDescriptions;
+}
+/*static*/ std::vector<VkVertexInputAttributeDescription> InstanceData::getAttributeDescription() noexcept {
+    // A mat4 input takes four consecutive locations, one per column
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    for (uint32_t column = 0; column < 4; ++column) {
+        attributeDescriptions.push_back({
+            .location = 3 + column,
+            .binding = 1,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset = static_cast<uint32_t>(offsetof(InstanceData, m_modelMatrix) + sizeof(glm::vec4) * column)
+        });
+    }
+    // The normal matrix follows as a mat3, reading the first three floats of each padded column
+    for (uint32_t column = 0; column < 3; ++column) {
+        attributeDescriptions.push_back({
+            .location = 7 + column,
+            .binding = 1,
+            .format = VK_FORMAT_R32G32B32_SFLOAT,
+            .offset = static_cast<uint32_t>(offsetof(InstanceData, m_normalMatrix) + sizeof(glm::vec4) * column)
+        });
+    }
+    return attributeDescriptions;
+}
+
 }  // namespace sge
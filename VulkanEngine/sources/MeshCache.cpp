@@ -0,0 +1,400 @@
+#include "MeshCache.h"
+
+#include "Hash.h"
+#include "Logger.h"
+#include "MappedFile.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+namespace sge {
+namespace {
+constexpr char CACHE_MAGIC[4] = {'S', 'G', 'E', 'M'};
+constexpr uint64_t DATA_ALIGNMENT = 16;
+
+using FileStamp = MeshCache::FileStamp;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t fileSize;
+    uint32_t importFlags;
+    uint32_t meshCount;
+    uint32_t dependencyCount;
+    uint32_t padding;
+    FileStamp sourceStamp;
+    uint64_t sourceContentHash;
+};
+
+struct StringRef {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t lodOffset;
+    uint64_t instanceOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float modelMatrix[16];
+    float boundingBoxMin[3];
+    float boundingBoxMax[3];
+    float baseColor[4];
+    float emissiveFactor[3];
+    float metallicFactor;
+    float roughnessFactor;
+    uint32_t materialMapFlags;
+    uint32_t materialType;
+    uint32_t lodCount;
+    uint32_t instanceCount;
+    StringRef name;
+    StringRef baseColorPath;
+    StringRef metallicRoughnessPath;
+    StringRef normalPath;
+    StringRef emissivePath;
+    MeshOptimizer::Statistics statistics;
+};
+
+struct DependencyRecord {
+    StringRef path;
+    FileStamp stamp;
+    uint64_t contentHash;
+};
+
+enum MaterialMapFlags : uint32_t {
+    OcclusionMap = 1 << 0,
+    ColorMap = 1 << 1,
+    MetallicRoughnessMap = 1 << 2,
+    NormalMap = 1 << 3,
+    EmissiveMap = 1 << 4
+};
+
+static_assert(std::is_trivially_copyable_v<Vertex> && sizeof(Vertex) == 32, "Vertex layout is baked into the cache");
+static_assert(std::is_trivially_copyable_v<Mesh::Lod> && sizeof(Mesh::Lod) == 12, "Lod layout is baked into the cache");
+static_assert(std::is_trivially_copyable_v<InstanceData> && sizeof(InstanceData) == 112,
+              "InstanceData layout is baked into the cache");
+static_assert(std::is_trivially_copyable_v<MeshOptimizer::Statistics> && sizeof(MeshOptimizer::Statistics) == 32,
+              "MeshOptimizer::Statistics layout is baked into the cache");
+
+constexpr uint64_t alignOffset(const uint64_t offset) noexcept {
+    return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+}
+
+class CacheWriter {
+ public:
+    explicit CacheWriter(const std::filesystem::path& path) : m_file(path, std::ios::binary | std::ios::trunc) {}
+
+    bool isOpen() const noexcept { return m_file.is_open(); }
+    bool isGood() const noexcept { return m_file.good(); }
+    uint64_t offset() const noexcept { return m_offset; }
+
+    void write(const void* data, const uint64_t size) {
+        m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        m_offset += size;
+    }
+
+    void align() {
+        constexpr char zeros[DATA_ALIGNMENT] = {};
+        write(zeros, alignOffset(m_offset) - m_offset);
+    }
+
+    StringRef writeString(const std::string_view str) {
+        const StringRef ref{.offset = m_offset, .size = str.size()};
+        write(str.data(), str.size());
+        return ref;
+    }
+
+    void writeAt(const uint64_t offset, const void* data, const uint64_t size) {
+        m_file.seekp(static_cast<std::streamoff>(offset));
+        m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        m_file.seekp(static_cast<std::streamoff>(m_offset));
+    }
+
+ private:
+    std::ofstream m_file;
+    uint64_t m_offset = 0;
+};
+
+bool isInFile(const MappedFile& file, const uint64_t offset, const uint64_t size) noexcept {
+    return offset <= file.size() && size <= file.size() - offset;
+}
+
+std::string readString(const MappedFile& file, const StringRef& ref) {
+    return std::string(reinterpret_cast<const char*>(file.data() + ref.offset), ref.size);
+}
+
+//! Empty when the file can't be read
+std::optional<uint64_t> hashFile(const std::filesystem::path& path) noexcept {
+    const MappedFile file(path);
+    if (!file.isValid()) return std::nullopt;
+    return hashBytes(file.data(), file.size());
+}
+
+//! Empty when the file doesn't exist
+std::optional<FileStamp> stampFile(const std::filesystem::path& path) noexcept {
+    std::error_code ec;
+    const uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+    const auto modifiedTime = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;
+    return FileStamp{.size = size, .modifiedTime = modifiedTime.time_since_epoch().count()};
+}
+
+//! Only a file whose size is the same but whose time changed is hashed, e.g. after a checkout that rewrote it
+bool isUnchanged(const std::filesystem::path& path, const FileStamp& stamp, const uint64_t contentHash) noexcept {
+    const auto currentStamp = stampFile(path);
+    if (!currentStamp || currentStamp->size != stamp.size) return false;
+    return *currentStamp == stamp || hashFile(path) == contentHash;
+}
+}  // namespace
+
+MeshCache::MeshCache(const std::filesystem::path& sourcePath, const uint32_t importFlags,
+                     const uint64_t importSettingsHash, std::filesystem::path cacheDirectory) noexcept
+    : m_importFlags(importFlags) {
+    std::error_code ec;
+    m_sourcePath = std::filesystem::absolute(sourcePath, ec);
+    if (ec) return;
+    const auto sourceStamp = stampFile(m_sourcePath);
+    if (!sourceStamp) return;
+    m_sourceStamp = *sourceStamp;
+
+    // Keyed by path, the contents are only read when the stamp stored in the entry doesn't match anymore
+    m_key = hashString(m_sourcePath.generic_string());
+    m_key = hashValue(importFlags, m_key);
+    m_key = hashValue(importSettingsHash, m_key);
+    m_key = hashValue(VERSION, m_key);
+
+    std::stringstream fileName;
+    fileName << std::hex << m_key << ".sgemesh";
+    m_cachePath = std::move(cacheDirectory) / fileName.str();
+    m_isValid = true;
+}
+
+bool MeshCache::isValid() const noexcept { return m_isValid; }
+
+const std::filesystem::path& MeshCache::getCachePath() const noexcept { return m_cachePath; }
+
+std::optional<std::vector<Mesh>> MeshCache::load(std::vector<MeshOptimizer::Statistics>* statistics) const
+    noexcept {
+    if (!m_isValid) return std::nullopt;
+    std::error_code ec;
+    if (!std::filesystem::exists(m_cachePath, ec)) return std::nullopt;
+
+    std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(m_cachePath);
+    if (!file->isValid() || file->size() < sizeof(FileHeader)) return std::nullopt;
+
+    FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != VERSION ||
+        header.key != m_key || header.importFlags != m_importFlags || header.fileSize != file->size() ||
+        !isInFile(*file, sizeof(FileHeader),
+                  static_cast<uint64_t>(header.meshCount) * sizeof(MeshRecord) +
+                      static_cast<uint64_t>(header.dependencyCount) * sizeof(DependencyRecord))) {
+        LOG_MSG("Mesh cache: stale or corrupted file " << m_cachePath.string() << ", rebaking")
+        return std::nullopt;
+    }
+    if (!isUnchanged(m_sourcePath, header.sourceStamp, header.sourceContentHash)) {
+        LOG_MSG("Mesh cache: " << m_sourcePath.string() << " changed, rebaking " << m_cachePath.filename().string())
+        return std::nullopt;
+    }
+    const uint64_t dependencyOffset = sizeof(FileHeader) + static_cast<uint64_t>(header.meshCount) * sizeof(MeshRecord);
+    for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+        DependencyRecord record;
+        std::memcpy(&record, file->data() + dependencyOffset + sizeof(DependencyRecord) * i, sizeof(record));
+        if (!isInFile(*file, record.path.offset, record.path.size)) return std::nullopt;
+        const std::string path = readString(*file, record.path);
+        if (!isUnchanged(path, record.stamp, record.contentHash)) {
+            LOG_MSG("Mesh cache: " << path << " changed, rebaking " << m_cachePath.filename().string())
+            return std::nullopt;
+        }
+    }
+
+    std::vector<Mesh> meshes(header.meshCount);
+    std::vector<MeshOptimizer::Statistics> meshStatistics(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        MeshRecord record;
+        std::memcpy(&record, file->data() + sizeof(FileHeader) + sizeof(MeshRecord) * i, sizeof(record));
+
+        const uint64_t vertexBytes = static_cast<uint64_t>(record.vertexCount) * sizeof(Vertex);
+        const uint64_t indexBytes = static_cast<uint64_t>(record.indexCount) * sizeof(uint32_t);
+        const uint64_t lodBytes = static_cast<uint64_t>(record.lodCount) * sizeof(Mesh::Lod);
+        const uint64_t instanceBytes = static_cast<uint64_t>(record.instanceCount) * sizeof(InstanceData);
+        if (!isInFile(*file, record.vertexOffset, vertexBytes) || !isInFile(*file, record.indexOffset, indexBytes) ||
+            !isInFile(*file, record.lodOffset, lodBytes) || !isInFile(*file, record.instanceOffset, instanceBytes) ||
+            record.vertexOffset % DATA_ALIGNMENT != 0 || record.indexOffset % DATA_ALIGNMENT != 0 ||
+            !isInFile(*file, record.name.offset, record.name.size) ||
+            !isInFile(*file, record.baseColorPath.offset, record.baseColorPath.size) ||
+            !isInFile(*file, record.metallicRoughnessPath.offset, record.metallicRoughnessPath.size) ||
+            !isInFile(*file, record.normalPath.offset, record.normalPath.size) ||
+            !isInFile(*file, record.emissivePath.offset, record.emissivePath.size) ||
+            record.materialType > static_cast<uint32_t>(Mesh::MaterialType::Phong)) {
+            LOG_ERROR("Mesh cache: corrupted mesh record " << i << " in " << m_cachePath.string())
+            return std::nullopt;
+        }
+
+        auto& mesh = meshes[i];
+        const auto* vertices = reinterpret_cast<const Vertex*>(file->data() + record.vertexOffset);
+        const auto* indices = reinterpret_cast<const uint32_t*>(file->data() + record.indexOffset);
+        mesh.setMappedData(file, {vertices, record.vertexCount}, {indices, record.indexCount});
+        mesh.m_lods.resize(record.lodCount);
+        if (lodBytes != 0) std::memcpy(mesh.m_lods.data(), file->data() + record.lodOffset, lodBytes);
+        mesh.m_instances.resize(record.instanceCount);
+        if (instanceBytes != 0)
+            std::memcpy(mesh.m_instances.data(), file->data() + record.instanceOffset, instanceBytes);
+        for (const auto& lod : mesh.m_lods) {
+            if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > record.indexCount) {
+                LOG_ERROR("Mesh cache: corrupted LOD range in mesh record " << i << " in " << m_cachePath.string())
+                return std::nullopt;
+            }
+        }
+
+        glm::mat4 modelMatrix;
+        std::memcpy(&modelMatrix[0][0], record.modelMatrix, sizeof(record.modelMatrix));
+        mesh.setModelMatrix(std::move(modelMatrix));
+        mesh.m_boundingBox.min = {record.boundingBoxMin[0], record.boundingBoxMin[1], record.boundingBoxMin[2]};
+        mesh.m_boundingBox.max = {record.boundingBoxMax[0], record.boundingBoxMax[1], record.boundingBoxMax[2]};
+        mesh.m_materialType = static_cast<Mesh::MaterialType>(record.materialType);
+        mesh.setName(readString(*file, record.name));
+        meshStatistics[i] = record.statistics;
+
+        auto& material = mesh.m_material;
+        material.m_baseColor = {record.baseColor[0], record.baseColor[1], record.baseColor[2], record.baseColor[3]};
+        material.m_emissiveFactor = {record.emissiveFactor[0], record.emissiveFactor[1], record.emissiveFactor[2]};
+        material.m_metallicFactor = record.metallicFactor;
+        material.m_roughnessFactor = record.roughnessFactor;
+        material.m_hasOcclusionMap = record.materialMapFlags & OcclusionMap;
+        material.m_hasColorMap = record.materialMapFlags & ColorMap;
+        material.m_hasMetallicRoughnessMap = record.materialMapFlags & MetallicRoughnessMap;
+        material.m_hasNormalMap = record.materialMapFlags & NormalMap;
+        material.m_hasEmissiveMap = record.materialMapFlags & EmissiveMap;
+        material.m_baseColorPath = readString(*file, record.baseColorPath);
+        material.m_MetallicRoughnessPath = readString(*file, record.metallicRoughnessPath);
+        material.m_NormalPath = readString(*file, record.normalPath);
+        material.m_EmissivePath = readString(*file, record.emissivePath);
+    }
+    if (statistics != nullptr) *statistics = std::move(meshStatistics);
+    return meshes;
+}
+
+bool MeshCache::store(const std::vector<Mesh>& meshes, const std::vector<MeshOptimizer::Statistics>& statistics,
+                      const std::vector<std::string>& dependencies) const noexcept {
+    if (!m_isValid) return false;
+    assert(statistics.empty() || statistics.size() == meshes.size());
+    // The stamp was taken before the import read the source, a source edited meanwhile would be stored with the
+    // stamp of the old contents
+    const auto sourceContentHash = hashFile(m_sourcePath);
+    if (!sourceContentHash || stampFile(m_sourcePath) != m_sourceStamp) return false;
+    std::vector<DependencyRecord> dependencyRecords(dependencies.size());
+    for (size_t i = 0; i < dependencies.size(); ++i) {
+        const auto stamp = stampFile(dependencies[i]);
+        const auto contentHash = hashFile(dependencies[i]);
+        // Can't be validated later, the next run has to import anyway
+        if (!stamp || !contentHash) return false;
+        dependencyRecords[i].stamp = *stamp;
+        dependencyRecords[i].contentHash = *contentHash;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(m_cachePath.parent_path(), ec);
+
+    // Written under a unique name and renamed, so parallel imports of one file never see a partial cache
+    std::stringstream tempName;
+    tempName << m_cachePath.filename().string() << "." << std::this_thread::get_id() << ".tmp";
+    const auto tempPath = m_cachePath.parent_path() / tempName.str();
+    {
+        CacheWriter writer(tempPath);
+        if (!writer.isOpen()) {
+            LOG_ERROR("Mesh cache: can't create file " << tempPath.string())
+            return false;
+        }
+
+        FileHeader header{.version = VERSION,
+                          .key = m_key,
+                          .fileSize = 0,
+                          .importFlags = m_importFlags,
+                          .meshCount = static_cast<uint32_t>(meshes.size()),
+                          .dependencyCount = static_cast<uint32_t>(dependencies.size()),
+                          .sourceStamp = m_sourceStamp,
+                          .sourceContentHash = *sourceContentHash};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        std::vector<MeshRecord> records(meshes.size());
+        writer.write(&header, sizeof(header));
+        writer.write(records.data(), sizeof(MeshRecord) * records.size());
+        const uint64_t dependencyOffset = writer.offset();
+        writer.write(dependencyRecords.data(), sizeof(DependencyRecord) * dependencyRecords.size());
+        for (size_t i = 0; i < dependencies.size(); ++i)
+            dependencyRecords[i].path = writer.writeString(dependencies[i]);
+
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            const auto& mesh = meshes[i];
+            const auto& material = mesh.m_material;
+            auto& record = records[i];
+
+            record.name = writer.writeString(mesh.getName());
+            record.baseColorPath = writer.writeString(material.m_baseColorPath);
+            record.metallicRoughnessPath = writer.writeString(material.m_MetallicRoughnessPath);
+            record.normalPath = writer.writeString(material.m_NormalPath);
+            record.emissivePath = writer.writeString(material.m_EmissivePath);
+
+            const auto vertices = mesh.getVertices();
+            writer.align();
+            record.vertexOffset = writer.offset();
+            record.vertexCount = static_cast<uint32_t>(vertices.size());
+            writer.write(vertices.data(), vertices.size_bytes());
+
+            const auto indices = mesh.getIndices();
+            writer.align();
+            record.indexOffset = writer.offset();
+            record.indexCount = static_cast<uint32_t>(indices.size());
+            writer.write(indices.data(), indices.size_bytes());
+
+            writer.align();
+            record.lodOffset = writer.offset();
+            record.lodCount = static_cast<uint32_t>(mesh.m_lods.size());
+            writer.write(mesh.m_lods.data(), sizeof(Mesh::Lod) * mesh.m_lods.size());
+
+            writer.align();
+            record.instanceOffset = writer.offset();
+            record.instanceCount = static_cast<uint32_t>(mesh.m_instances.size());
+            writer.write(mesh.m_instances.data(), sizeof(InstanceData) * mesh.m_instances.size());
+
+            std::memcpy(record.modelMatrix, &mesh.getModelMatrix()[0][0], sizeof(record.modelMatrix));
+            std::memcpy(record.boundingBoxMin, &mesh.m_boundingBox.min[0], sizeof(record.boundingBoxMin));
+            std::memcpy(record.boundingBoxMax, &mesh.m_boundingBox.max[0], sizeof(record.boundingBoxMax));
+            std::memcpy(record.baseColor, &material.m_baseColor[0], sizeof(record.baseColor));
+            std::memcpy(record.emissiveFactor, &material.m_emissiveFactor[0], sizeof(record.emissiveFactor));
+            record.metallicFactor = material.m_metallicFactor;
+            record.roughnessFactor = material.m_roughnessFactor;
+            record.materialMapFlags = (material.m_hasOcclusionMap ? OcclusionMap : 0u) |
+                                      (material.m_hasColorMap ? ColorMap : 0u) |
+                                      (material.m_hasMetallicRoughnessMap ? MetallicRoughnessMap : 0u) |
+                                      (material.m_hasNormalMap ? NormalMap : 0u) |
+                                      (material.m_hasEmissiveMap ? EmissiveMap : 0u);
+            record.materialType = static_cast<uint32_t>(mesh.m_materialType);
+            if (i < statistics.size()) record.statistics = statistics[i];
+        }
+
+        header.fileSize = writer.offset();
+        writer.writeAt(0, &header, sizeof(header));
+        writer.writeAt(sizeof(header), records.data(), sizeof(MeshRecord) * records.size());
+        writer.writeAt(dependencyOffset, dependencyRecords.data(), sizeof(DependencyRecord) * dependencyRecords.size());
+        if (!writer.isGood()) {
+            LOG_ERROR("Mesh cache: failed to write file " << tempPath.string())
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, m_cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+}  // namespace sge
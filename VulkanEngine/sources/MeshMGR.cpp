@@ -9,9 +9,11 @@ void MeshMGR::clearTable() noexcept {
     m_systemMeshes.clear();
     m_pipelines.clear();
     m_sets.clear();
-    m_generalMatrixUBO = nullptr;
-    m_debugUBO = nullptr;
+    m_materials.clear();
+    m_frameUniforms = nullptr;
+    m_objects = nullptr;
     m_normalTestUBO = nullptr;
+    m_bindlessTextures = nullptr;
     m_globalPool = {nullptr};
     m_UIPool = {nullptr};
 }
@@ -0,0 +1,675 @@
+#include "MeshOptimizer.h"
+
+#include "Hash.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace sge {
+namespace {
+constexpr uint32_t NO_VERTEX = ~0u;
+
+struct VertexBytesHash {
+    size_t operator()(const Vertex& vertex) const noexcept {
+        return static_cast<size_t>(hashBytes(&vertex, sizeof(Vertex)));
+    }
+};
+
+struct VertexBytesEqual {
+    bool operator()(const Vertex& lhs, const Vertex& rhs) const noexcept {
+        return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+    }
+};
+
+static_assert(sizeof(Vertex) == sizeof(float) * 8, "Vertex welding compares raw bytes, Vertex must have no padding");
+
+// FIFO cache simulation, bumping the time by cacheSize + 1 invalidates the whole cache
+uint32_t simulateCache(std::span<const uint32_t> indices, std::vector<uint32_t>& timestamps, uint32_t& time,
+                       const uint32_t cacheSize) noexcept {
+    uint32_t misses = 0;
+    for (const auto index : indices) {
+        if (time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+// Area-weighted sum of squared distances to triangle planes
+struct Quadric {
+    double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::dvec3& normal, const double distance, const double planeWeight) noexcept {
+        a00 += planeWeight * normal.x * normal.x;
+        a11 += planeWeight * normal.y * normal.y;
+        a22 += planeWeight * normal.z * normal.z;
+        a01 += planeWeight * normal.x * normal.y;
+        a02 += planeWeight * normal.x * normal.z;
+        a12 += planeWeight * normal.y * normal.z;
+        b0 += planeWeight * normal.x * distance;
+        b1 += planeWeight * normal.y * distance;
+        b2 += planeWeight * normal.z * distance;
+        c += planeWeight * distance * distance;
+        weight += planeWeight;
+    }
+
+    Quadric& operator+=(const Quadric& other) noexcept {
+        a00 += other.a00, a11 += other.a11, a22 += other.a22;
+        a01 += other.a01, a02 += other.a02, a12 += other.a12;
+        b0 += other.b0, b1 += other.b1, b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    //! Mean squared distance of p to the accumulated planes
+    double evaluate(const glm::dvec3& p) const noexcept {
+        const double result = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                              2 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                              2 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return weight > 0 ? std::abs(result) / weight : 0;
+    }
+};
+
+struct PositionKey {
+    size_t operator()(const glm::vec3& position) const noexcept {
+        const glm::vec3 normalized = position + 0.f;  // -0 and +0 compare equal, so they must hash equal
+        return static_cast<size_t>(hashBytes(&normalized, sizeof(float) * 3));
+    }
+};
+
+glm::vec3 decodeOctahedral(const glm::vec2 encoded) noexcept {
+    glm::vec3 normal(encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (normal.z < 0.f) {
+        const glm::vec2 folded = (1.f - glm::abs(glm::vec2(normal.y, normal.x))) *
+                                 glm::vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+        normal.x = folded.x;
+        normal.y = folded.y;
+    }
+    return glm::normalize(normal);
+}
+
+// Picks the best of the four neighbouring 16-bit encodings instead of plain rounding
+void encodeOctahedral(const glm::vec3& normal, int16_t (&encoded)[2]) noexcept {
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+    if (normal.z < 0.f)
+        p = (1.f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.f ? 1.f : -1.f, p.y >= 0.f ? 1.f : -1.f);
+
+    const glm::vec2 scaled = glm::clamp(p, -1.f, 1.f) * 32767.f;
+    float bestDot = -2.f;
+    for (const float x : {std::floor(scaled.x), std::ceil(scaled.x)}) {
+        for (const float y : {std::floor(scaled.y), std::ceil(scaled.y)}) {
+            const float dot = glm::dot(normal, decodeOctahedral(glm::vec2(x, y) / 32767.f));
+            if (dot > bestDot) {
+                bestDot = dot;
+                encoded[0] = static_cast<int16_t>(x);
+                encoded[1] = static_cast<int16_t>(y);
+            }
+        }
+    }
+}
+}  // namespace
+
+/*static*/ MeshOptimizer::Statistics MeshOptimizer::optimize(Mesh& mesh) noexcept {
+    Statistics stats;
+    auto& vertices = mesh.m_pos;
+    auto& indices = mesh.m_ind;
+    if (vertices.empty() || indices.size() < 3) return stats;
+
+    stats.verticesBefore = static_cast<uint32_t>(vertices.size());
+    stats.acmrBefore = computeACMR(indices, vertices.size());
+    stats.atvrBefore = computeATVR(indices, vertices.size());
+    stats.overdrawBefore = computeOverdraw(indices, vertices);
+
+    weldVertices(vertices, indices);
+    const auto clusters = optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices, clusters);
+    optimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = static_cast<uint32_t>(vertices.size());
+    stats.acmrAfter = computeACMR(indices, vertices.size());
+    stats.atvrAfter = computeATVR(indices, vertices.size());
+    stats.overdrawAfter = computeOverdraw(indices, vertices);
+    return stats;
+}
+
+/*static*/ void MeshOptimizer::weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) noexcept {
+    std::unordered_map<Vertex, uint32_t, VertexBytesHash, VertexBytesEqual> uniqueIndices;
+    uniqueIndices.reserve(vertices.size());
+    std::vector<Vertex> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const auto [it, isInserted] =
+            uniqueIndices.try_emplace(vertices[i], static_cast<uint32_t>(uniqueVertices.size()));
+        if (isInserted) uniqueVertices.push_back(vertices[i]);
+        remap[i] = it->second;
+    }
+    for (auto& index : indices) index = remap[index];
+    vertices = std::move(uniqueVertices);
+}
+
+/*static*/ std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices,
+                                                                    const size_t vertexCount,
+                                                                    const uint32_t cacheSize) noexcept {
+    std::vector<uint32_t> clusters;
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return clusters;
+
+    // Vertex -> triangles adjacency, packed in one array
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) ++liveTriangles[indices[i]];
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+            for (size_t k = 0; k < 3; ++k) adjacency[fillOffsets[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> isEmitted(triangleCount, false);
+    std::vector<uint32_t> deadEndStack;
+    deadEndStack.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    auto nextLiveVertex = [&]() {
+        while (!deadEndStack.empty()) {
+            const uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[vertex] > 0) return vertex;
+        }
+        for (; cursor < vertexCount; ++cursor)
+            if (liveTriangles[cursor] > 0) return static_cast<uint32_t>(cursor);
+        return NO_VERTEX;
+    };
+
+    clusters.push_back(0);
+    uint32_t fanningVertex = nextLiveVertex();
+    while (fanningVertex != NO_VERTEX) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a) {
+            const uint32_t triangle = adjacency[a];
+            if (isEmitted[triangle]) continue;
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = indices[triangle * 3 + k];
+                result.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (time - timestamps[vertex] > cacheSize) timestamps[vertex] = time++;
+            }
+            isEmitted[triangle] = true;
+        }
+
+        // Prefer the oldest candidate that is still in the cache after its remaining triangles are emitted
+        uint32_t bestVertex = NO_VERTEX;
+        int64_t bestPriority = -1;
+        for (const auto vertex : candidates) {
+            if (liveTriangles[vertex] == 0) continue;
+            int64_t priority = 0;
+            const int64_t age = static_cast<int64_t>(time) - timestamps[vertex];
+            if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= cacheSize) priority = age;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                bestVertex = vertex;
+            }
+        }
+        if (bestVertex == NO_VERTEX) {
+            bestVertex = nextLiveVertex();
+            if (bestVertex != NO_VERTEX) clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+        fanningVertex = bestVertex;
+    }
+
+    indices = std::move(result);
+    return clusters;
+}
+
+/*static*/ void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices,
+                                               std::span<const uint32_t> hardClusters, const uint32_t cacheSize,
+                                               const float threshold) noexcept {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || hardClusters.empty()) return;
+
+    // Split the cache clusters further while their ACMR stays within threshold of the whole cluster
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+    for (size_t c = 0; c < hardClusters.size(); ++c) {
+        const size_t start = hardClusters[c];
+        const size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+        if (start >= end) continue;
+
+        const std::span<const uint32_t> clusterIndices(indices.data() + start * 3, (end - start) * 3);
+        time += cacheSize + 1;
+        const float clusterACMR =
+            static_cast<float>(simulateCache(clusterIndices, timestamps, time, cacheSize)) / (end - start);
+        const float targetACMR = clusterACMR * threshold;
+
+        clusters.push_back(static_cast<uint32_t>(start));
+        time += cacheSize + 1;
+        uint32_t runningMisses = 0;
+        uint32_t runningTriangles = 0;
+        for (size_t t = start; t < end; ++t) {
+            runningMisses += simulateCache({indices.data() + t * 3, 3}, timestamps, time, cacheSize);
+            ++runningTriangles;
+            if (t + 1 < end && static_cast<float>(runningMisses) / runningTriangles <= targetACMR) {
+                clusters.push_back(static_cast<uint32_t>(t + 1));
+                time += cacheSize + 1;
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+
+    glm::vec3 meshCentroid{0.f};
+    for (const auto index : indices) meshCentroid += glm::vec3(vertices[index].m_position);
+    meshCentroid /= static_cast<float>(indices.size());
+
+    // Clusters facing away from the mesh center are more likely to occlude the rest, so they go first
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid{0.f};
+        glm::vec3 normal{0.f};
+        float area = 0.f;
+        for (size_t t = start; t < end; ++t) {
+            const glm::vec3 p0(vertices[indices[t * 3 + 0]].m_position);
+            const glm::vec3 p1(vertices[indices[t * 3 + 1]].m_position);
+            const glm::vec3 p2(vertices[indices[t * 3 + 2]].m_position);
+            const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(triangleNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        const float normalLength = glm::length(normal);
+        if (area <= 0.f || normalLength <= 0.f) continue;
+        sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) {
+        return sortKeys[lhs] > sortKeys[rhs];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const auto c : order) {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    indices = std::move(result);
+}
+
+/*static*/ void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices,
+                                                  std::vector<uint32_t>& indices) noexcept {
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> orderedVertices;
+    orderedVertices.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<uint32_t>(orderedVertices.size());
+            orderedVertices.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(orderedVertices);
+}
+
+/*static*/ std::vector<uint32_t> MeshOptimizer::simplify(std::span<const Vertex> vertices,
+                                                         std::span<const uint32_t> indices,
+                                                         const size_t targetIndexCount, const float targetError,
+                                                         float* resultError) noexcept {
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    if (resultError) *resultError = 0.f;
+    if (vertices.empty() || result.size() <= targetIndexCount) return result;
+    const size_t vertexCount = vertices.size();
+
+    // Errors are measured in a unit cube around the mesh
+    glm::vec3 boundsMin(vertices[0].m_position);
+    glm::vec3 boundsMax(vertices[0].m_position);
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, glm::vec3(vertex.m_position));
+        boundsMax = glm::max(boundsMax, glm::vec3(vertex.m_position));
+    }
+    const glm::vec3 extent = boundsMax - boundsMin;
+    const float scale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+    std::vector<glm::dvec3> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        positions[v] = glm::dvec3((glm::vec3(vertices[v].m_position) - boundsMin) / scale);
+
+    // Vertices sharing a position with another vertex sit on an attribute seam
+    std::unordered_map<glm::vec3, uint32_t, PositionKey> positionIds;
+    positionIds.reserve(vertexCount);
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<uint32_t> verticesPerPosition;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const auto [it, isInserted] = positionIds.try_emplace(glm::vec3(vertices[v].m_position),
+                                                              static_cast<uint32_t>(verticesPerPosition.size()));
+        if (isInserted) verticesPerPosition.push_back(0);
+        positionId[v] = it->second;
+        ++verticesPerPosition[it->second];
+    }
+    std::vector<bool> isPositionLocked(verticesPerPosition.size(), false);
+    for (size_t p = 0; p < verticesPerPosition.size(); ++p) isPositionLocked[p] = verticesPerPosition[p] > 1;
+
+    // Edges used by a single triangle are open borders
+    std::unordered_map<uint64_t, uint32_t> edgeUsage;
+    edgeUsage.reserve(result.size());
+    auto edgeKey = [](uint32_t a, uint32_t b) {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    };
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            const uint32_t a = positionId[result[i + k]];
+            const uint32_t b = positionId[result[i + (k + 1) % 3]];
+            if (a != b) ++edgeUsage[edgeKey(a, b)];
+        }
+    }
+    for (const auto& [key, usage] : edgeUsage) {
+        if (usage != 1) continue;
+        isPositionLocked[static_cast<uint32_t>(key >> 32)] = true;
+        isPositionLocked[static_cast<uint32_t>(key & 0xffffffffu)] = true;
+    }
+    std::vector<bool> isLocked(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) isLocked[v] = isPositionLocked[positionId[v]];
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        const auto& p0 = positions[result[i]];
+        const auto& p1 = positions[result[i + 1]];
+        const auto& p2 = positions[result[i + 2]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double doubleArea = glm::length(normal);
+        if (doubleArea <= 0) continue;
+        normal /= doubleArea;
+        const double distance = -glm::dot(normal, p0);
+        for (size_t k = 0; k < 3; ++k) quadrics[result[i + k]].addPlane(normal, distance, doubleArea * 0.5);
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+    const double maxCost = static_cast<double>(targetError) * targetError;
+    double appliedCost = 0;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> isTouched(vertexCount);
+
+    // Collapsing "from" onto "to" must not flip or fold any remaining triangle around "from"
+    auto flipsTriangles = [&](const uint32_t from, const uint32_t to) {
+        for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a) {
+            const uint32_t* triangle = &result[adjacency[a] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+            glm::dvec3 before[3];
+            glm::dvec3 after[3];
+            for (size_t k = 0; k < 3; ++k) {
+                before[k] = positions[triangle[k]];
+                after[k] = triangle[k] == from ? positions[to] : before[k];
+            }
+            const glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            const glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normalBefore, normalAfter) < 0.25 * glm::length(normalBefore) * glm::length(normalAfter))
+                return true;
+        }
+        return false;
+    };
+
+    while (result.size() > targetIndexCount) {
+        const size_t triangleCount = result.size() / 3;
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (const auto index : result) ++adjacencyOffsets[index + 1];
+        for (size_t v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t)
+                for (size_t k = 0; k < 3; ++k) adjacency[fillOffsets[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                const uint32_t a = result[t * 3 + k];
+                const uint32_t b = result[t * 3 + (k + 1) % 3];
+                if (a > b && !isLocked[a] && !isLocked[b]) continue;  // interior edges are seen from both sides
+                Quadric combined = quadrics[a];
+                combined += quadrics[b];
+                const double costAB = isLocked[a] ? std::numeric_limits<double>::max() : combined.evaluate(positions[b]);
+                const double costBA = isLocked[b] ? std::numeric_limits<double>::max() : combined.evaluate(positions[a]);
+                if (isLocked[a] && isLocked[b]) continue;
+                if (costAB <= costBA)
+                    collapses.push_back({a, b, costAB});
+                else
+                    collapses.push_back({b, a, costBA});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(isTouched.begin(), isTouched.end(), false);
+        const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t appliedCollapses = 0;
+        for (const auto& collapse : collapses) {
+            if (collapse.cost > maxCost || removedTriangles >= trianglesToRemove) break;
+            if (isTouched[collapse.from] || isTouched[collapse.to]) continue;
+            if (flipsTriangles(collapse.from, collapse.to)) continue;
+
+            // Every vertex around "from" is frozen for the rest of the pass, so flip tests stay valid
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a)
+                for (size_t k = 0; k < 3; ++k) isTouched[result[adjacency[a] * 3 + k]] = true;
+            isTouched[collapse.to] = true;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            appliedCost = std::max(appliedCost, collapse.cost);
+            removedTriangles += 2;
+            ++appliedCollapses;
+        }
+        if (appliedCollapses == 0) break;
+
+        size_t writeIndex = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            const uint32_t a = remap[result[t * 3]];
+            const uint32_t b = remap[result[t * 3 + 1]];
+            const uint32_t c = remap[result[t * 3 + 2]];
+            if (a == b || b == c || a == c) continue;
+            result[writeIndex++] = a;
+            result[writeIndex++] = b;
+            result[writeIndex++] = c;
+        }
+        result.resize(writeIndex);
+    }
+
+    if (resultError) *resultError = static_cast<float>(std::sqrt(appliedCost));
+    return result;
+}
+
+/*static*/ void MeshOptimizer::generateLods(Mesh& mesh) noexcept {
+    auto& vertices = mesh.m_pos;
+    auto& indices = mesh.m_ind;
+    mesh.m_lods.clear();
+    if (vertices.empty() || indices.size() < 3) return;
+
+    const uint32_t baseIndexCount = static_cast<uint32_t>(indices.size());
+    mesh.m_lods.push_back({.firstIndex = 0, .indexCount = baseIndexCount, .error = 0.f});
+
+    std::vector<uint32_t> previousLod(indices.begin(), indices.end());
+    size_t targetIndexCount = baseIndexCount;
+    while (mesh.m_lods.size() < MAX_LOD_COUNT) {
+        targetIndexCount = targetIndexCount / 6 * 3;  // half of the triangles
+        if (targetIndexCount < 3) break;
+        float error = 0.f;
+        auto lod = simplify(vertices, previousLod, targetIndexCount, MAX_LOD_ERROR, &error);
+        // Stop once the simplifier is blocked by locked vertices or the error limit
+        if (lod.empty() || lod.size() * 10 > previousLod.size() * 9) break;
+
+        optimizeVertexCache(lod, vertices.size());
+        mesh.m_lods.push_back({.firstIndex = static_cast<uint32_t>(indices.size()),
+                               .indexCount = static_cast<uint32_t>(lod.size()),
+                               .error = std::max(error, mesh.m_lods.back().error)});
+        indices.insert(indices.end(), lod.begin(), lod.end());
+        previousLod = std::move(lod);
+    }
+}
+
+/*static*/ MeshOptimizer::QuantizationError MeshOptimizer::quantizeVertices(Mesh& mesh) noexcept {
+    QuantizationError error;
+    const auto vertices = mesh.getVertices();
+    if (vertices.empty()) return error;
+
+    glm::vec3 boundsMin(vertices[0].m_position);
+    glm::vec3 boundsMax(vertices[0].m_position);
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, glm::vec3(vertex.m_position));
+        boundsMax = glm::max(boundsMax, glm::vec3(vertex.m_position));
+    }
+    // Flat meshes still need a non-zero scale on the degenerate axis
+    const glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+    std::vector<QuantizedVertex> quantized(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const auto& vertex = vertices[i];
+        auto& result = quantized[i];
+
+        const glm::vec3 position(vertex.m_position);
+        const glm::vec3 normalized = glm::clamp((position - boundsMin) / extent, 0.f, 1.f);
+        for (int c = 0; c < 3; ++c) result.m_position[c] = glm::packUnorm1x16(normalized[c]);
+        result.m_position[3] = 0;
+        glm::vec3 decoded;
+        for (int c = 0; c < 3; ++c) decoded[c] = glm::unpackUnorm1x16(result.m_position[c]) * extent[c] + boundsMin[c];
+        error.maxPositionError = std::max(error.maxPositionError, glm::length(decoded - position));
+
+        glm::vec3 normal(vertex.m_normal);
+        normal = glm::length(normal) > 0.f ? glm::normalize(normal) : glm::vec3(0.f, 0.f, 1.f);
+        encodeOctahedral(normal, result.m_normal);
+        const glm::vec3 decodedNormal = decodeOctahedral(
+            glm::vec2(glm::unpackSnorm1x16(result.m_normal[0]), glm::unpackSnorm1x16(result.m_normal[1])));
+        const float normalError = std::acos(glm::clamp(glm::dot(normal, decodedNormal), -1.f, 1.f));
+        error.maxNormalErrorDegrees = std::max(error.maxNormalErrorDegrees, glm::degrees(normalError));
+
+        for (int c = 0; c < 2; ++c) {
+            result.m_UV[c] = glm::packHalf1x16(vertex.m_UV[c]);
+            const float uvError = std::abs(glm::unpackHalf1x16(result.m_UV[c]) - vertex.m_UV[c]);
+            error.maxUVError = std::max(error.maxUVError, uvError);
+        }
+    }
+    error.maxPositionErrorRelative = error.maxPositionError / glm::length(boundsMax - boundsMin + glm::vec3(1e-6f));
+
+    mesh.m_quantizedPos = std::move(quantized);
+    mesh.m_positionScale = extent;
+    mesh.m_positionOffset = boundsMin;
+    mesh.m_vertexFormat = Mesh::VertexFormat::Quantized;
+    mesh.clearVertices();
+    return error;
+}
+
+/*static*/ uint32_t MeshOptimizer::countCacheMisses(std::span<const uint32_t> indices, const size_t vertexCount,
+                                                    const uint32_t cacheSize) noexcept {
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    return simulateCache(indices, timestamps, time, cacheSize);
+}
+
+/*static*/ float MeshOptimizer::computeACMR(std::span<const uint32_t> indices, const size_t vertexCount,
+                                           const uint32_t cacheSize) noexcept {
+    if (indices.size() < 3) return 0.f;
+    return static_cast<float>(countCacheMisses(indices, vertexCount, cacheSize)) / (indices.size() / 3);
+}
+
+/*static*/ float MeshOptimizer::computeATVR(std::span<const uint32_t> indices, const size_t vertexCount,
+                                           const uint32_t cacheSize) noexcept {
+    if (vertexCount == 0) return 0.f;
+    return static_cast<float>(countCacheMisses(indices, vertexCount, cacheSize)) / vertexCount;
+}
+
+/*static*/ float MeshOptimizer::computeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                                               const uint32_t gridSize) noexcept {
+    if (vertices.empty() || indices.size() < 3 || gridSize == 0) return 0.f;
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, glm::vec3(vertex.m_position));
+        boundsMax = glm::max(boundsMax, glm::vec3(vertex.m_position));
+    }
+
+    std::vector<float> depth(static_cast<size_t>(gridSize) * gridSize);
+    uint64_t shaded = 0;
+    uint64_t covered = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        // (u, v, axis) stays right-handed, so the projected area of a counter-clockwise triangle has the sign of
+        // its normal along the axis
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        const float extent = std::max(boundsMax[u] - boundsMin[u], boundsMax[v] - boundsMin[v]);
+        const float scale = extent > 0.f ? static_cast<float>(gridSize) / extent : 0.f;
+        // The viewer looks along +axis for side 1, faces pointing back at it have a negative area
+        for (const float side : {1.f, -1.f}) {
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                glm::vec3 p[3];
+                for (int k = 0; k < 3; ++k) {
+                    const glm::vec3 position = vertices[indices[i + k]].m_position;
+                    p[k] = {(position[u] - boundsMin[u]) * scale, (position[v] - boundsMin[v]) * scale,
+                            position[axis] * side};
+                }
+                const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+                if (area * side >= 0.f) continue;
+
+                const auto toPixel = [gridSize](const float value) {
+                    return static_cast<uint32_t>(std::clamp(value, 0.f, static_cast<float>(gridSize - 1)));
+                };
+                const uint32_t minX = toPixel(std::min({p[0].x, p[1].x, p[2].x}));
+                const uint32_t maxX = toPixel(std::max({p[0].x, p[1].x, p[2].x}));
+                const uint32_t minY = toPixel(std::min({p[0].y, p[1].y, p[2].y}));
+                const uint32_t maxY = toPixel(std::max({p[0].y, p[1].y, p[2].y}));
+                for (uint32_t y = minY; y <= maxY; ++y) {
+                    for (uint32_t x = minX; x <= maxX; ++x) {
+                        const float px = static_cast<float>(x) + 0.5f;
+                        const float py = static_cast<float>(y) + 0.5f;
+                        // Barycentric weights, all non-negative inside the triangle
+                        const float w0 = ((p[1].x - px) * (p[2].y - py) - (p[2].x - px) * (p[1].y - py)) / area;
+                        const float w1 = ((p[2].x - px) * (p[0].y - py) - (p[0].x - px) * (p[2].y - py)) / area;
+                        const float w2 = 1.f - w0 - w1;
+                        if (w0 < 0.f || w1 < 0.f || w2 < 0.f) continue;
+                        const float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+                        float& pixelDepth = depth[static_cast<size_t>(y) * gridSize + x];
+                        if (z < pixelDepth) {
+                            if (pixelDepth == std::numeric_limits<float>::max()) ++covered;
+                            pixelDepth = z;
+                            ++shaded;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return covered != 0 ? static_cast<float>(shaded) / static_cast<float>(covered) : 0.f;
+}
+}  // namespace sge
@@ -3,98 +3,170 @@
 #include "App.h"
 #include "Buffer.h"
 #include "MeshMGR.h"
+#include "TextureCache.h"
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 using namespace std::chrono;
 
 namespace sge {
 static PFN_vkSetDebugUtilsObjectNameEXT SetDebugUtilsObjectNameEXT;
 
+namespace {
+//! CPU fallback for formats without linear blit support, filtered like the TextureCache bakes. Levels follow each
+//! other with all layers of a level packed together, one copy region per level
+std::vector<uint8_t> buildMipChain(const Texture& texture, uint32_t width, uint32_t height, uint32_t layerCount,
+                                   uint32_t mipLevels, std::vector<VkBufferImageCopy>& regions) {
+    std::vector<uint8_t> chain(static_cast<size_t>(width) * height * 4 * layerCount);
+    texture.copyPixelsTo(chain.data());
+    size_t levelOffset = 0;
+    for (uint32_t level = 0; level < mipLevels; ++level) {
+        if (level > 0) {
+            const uint32_t nextWidth = std::max(width / 2, 1u);
+            const uint32_t nextHeight = std::max(height / 2, 1u);
+            const size_t srcLayerSize = static_cast<size_t>(width) * height * 4;
+            const size_t dstLayerSize = static_cast<size_t>(nextWidth) * nextHeight * 4;
+            const size_t nextOffset = levelOffset + srcLayerSize * layerCount;
+            chain.resize(nextOffset + dstLayerSize * layerCount);
+            for (uint32_t layer = 0; layer < layerCount; ++layer)
+                TextureCache::downsample(chain.data() + levelOffset + srcLayerSize * layer, width, height,
+                                         chain.data() + nextOffset + dstLayerSize * layer, texture.getRole());
+            levelOffset = nextOffset;
+            width = nextWidth;
+            height = nextHeight;
+        }
+        VkBufferImageCopy region{};
+        region.bufferOffset = levelOffset;
+        region.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                   .mipLevel = level,
+                                   .baseArrayLayer = 0,
+                                   .layerCount = layerCount};
+        region.imageExtent = {width, height, 1};
+        regions.push_back(region);
+    }
+    return chain;
+}
+
+//! Sub-images are packed back to back, every size is a whole number of blocks so each offset stays block aligned
+void packCompressedImage(const CompressedImage& image, std::byte* staging, std::vector<VkBufferImageCopy>& regions) {
+    size_t offset = 0;
+    for (const auto& subImage : image.getSubImages()) {
+        std::copy(subImage.data.begin(), subImage.data.end(), staging + offset);
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                   .mipLevel = subImage.level,
+                                   .baseArrayLayer = subImage.layer,
+                                   .layerCount = 1};
+        region.imageExtent = {subImage.width, subImage.height, 1};
+        regions.push_back(region);
+        offset += subImage.data.size();
+    }
+}
+}  // namespace
+
 Model::~Model() {}
 
-void Model::createBuffers() noexcept {
+void Model::createBuffers(UploadContext& uploadContext) noexcept {
     auto& meshes = MeshMGR::Instance().m_meshes;
     for (auto& mesh : meshes) {
-        createVertexBuffers(mesh.m_pos, mesh);
-        createIndexBuffers(mesh.m_ind, mesh);
+        if (!mesh.m_vertexAllocation.isValid()) createMeshBuffers(mesh, uploadContext);
     }
     for (auto& mesh : MeshMGR::Instance().m_systemMeshes) {
-        createVertexBuffers(mesh.m_pos, mesh);
-        createIndexBuffers(mesh.m_ind, mesh);
+        if (!mesh.m_vertexAllocation.isValid()) createMeshBuffers(mesh, uploadContext);
     }
 }
 
+void Model::createMeshBuffers(Mesh& mesh, UploadContext& uploadContext) noexcept {
+    createVertexBuffers(mesh.getVertexData(), mesh.getVertexStride(), mesh, uploadContext);
+    createIndexBuffers(mesh.getIndices(), mesh, uploadContext);
+    createInstanceBuffers(mesh, uploadContext);
+}
+
+GeometryPool::Statistics Model::getGeometryStatistics() const { return m_geometryPool.getStatistics(); }
+
 void Model::bind(const VkCommandBuffer commandBuffer, const Mesh& mesh) const noexcept {
-    const VkBuffer buffers[] = {mesh.m_vertexBuffer->getBuffer()};
-    const VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, mesh.m_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    GeometryBinding bound;
+    bind(commandBuffer, mesh, bound);
+}
+
+void Model::bind(const VkCommandBuffer commandBuffer, const Mesh& mesh, GeometryBinding& bound) const noexcept {
+    if (mesh.m_vertexAllocation.buffer != bound.vertexBuffer ||
+        mesh.m_instanceAllocation.buffer != bound.instanceBuffer) {
+        const VkBuffer buffers[] = {mesh.m_vertexAllocation.buffer, mesh.m_instanceAllocation.buffer};
+        const VkDeviceSize offsets[] = {0, 0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+        bound.vertexBuffer = mesh.m_vertexAllocation.buffer;
+        bound.instanceBuffer = mesh.m_instanceAllocation.buffer;
+    }
+    if (mesh.m_indexAllocation.buffer != bound.indexBuffer || mesh.m_indexType != bound.indexType) {
+        vkCmdBindIndexBuffer(commandBuffer, mesh.m_indexAllocation.buffer, 0, mesh.m_indexType);
+        bound.indexBuffer = mesh.m_indexAllocation.buffer;
+        bound.indexType = mesh.m_indexType;
+    }
 }
 
 void Model::draw(const VkCommandBuffer commandBuffer, const Mesh& mesh) const noexcept {
     assert(mesh.getIndexCount() != 0 && "Mesh must use index drawing");
-    vkCmdDrawIndexed(commandBuffer, mesh.getIndexCount(), 1, 0, 0, 0);
+    const auto vertexOffset = static_cast<int32_t>(mesh.m_vertexAllocation.offset);
+    const uint32_t firstInstance = mesh.m_instanceAllocation.offset;
+    if (mesh.m_lods.empty()) {
+        vkCmdDrawIndexed(commandBuffer, mesh.getIndexCount(), mesh.getInstanceCount(), mesh.m_indexAllocation.offset,
+                         vertexOffset, firstInstance);
+        return;
+    }
+    const auto& lod = mesh.m_lods[std::min<size_t>(mesh.m_currentLod, mesh.m_lods.size() - 1)];
+    vkCmdDrawIndexed(commandBuffer, lod.indexCount, mesh.getInstanceCount(),
+                     mesh.m_indexAllocation.offset + lod.firstIndex, vertexOffset, firstInstance);
 }
 
-void Model::createVertexBuffers(const std::vector<Vertex>& vertices, Mesh& mesh) noexcept {
-    const uint32_t vertexSize = sizeof(vertices[0]);
-    const VkDeviceSize bufferSize = static_cast<uint64_t>(vertexSize) * mesh.getVertexCount();
-
-    Buffer stagingBuffer{
-        m_device,
-        vertexSize,
-        mesh.getVertexCount(),
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer(vertices.data());
-    mesh.m_vertexBuffer = std::make_unique<Buffer>(m_device, vertexSize, mesh.getVertexCount(),
-                                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    m_device.copyBuffer(stagingBuffer.getBuffer(), mesh.m_vertexBuffer->getBuffer(), bufferSize);
+void Model::createVertexBuffers(std::span<const std::byte> vertexData, const uint32_t vertexStride, Mesh& mesh,
+                                UploadContext& uploadContext) noexcept {
+    mesh.m_vertexAllocation =
+        m_geometryPool.allocate(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexStride, mesh.getVertexCount());
+    m_geometryPool.upload(mesh.m_vertexAllocation, vertexStride, vertexData.data(), uploadContext);
 }
 
-void Model::createIndexBuffers(const std::vector<uint32_t>& indices, Mesh& mesh) noexcept {
+void Model::createIndexBuffers(std::span<const uint32_t> indices, Mesh& mesh, UploadContext& uploadContext) noexcept {
     assert(indices.empty() == 0 && "Mesh must use index drawing");
 
-    const uint32_t indexSize = sizeof(indices[0]);
-    const VkDeviceSize bufferSize = static_cast<uint64_t>(indexSize) * mesh.getIndexCount();
-
-    Buffer stagingBuffer{
-        m_device,
-        indexSize,
-        mesh.getIndexCount(),
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer(indices.data());
-    mesh.m_indexBuffer = std::make_unique<Buffer>(m_device, indexSize, mesh.getIndexCount(),
-                                                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    m_device.copyBuffer(stagingBuffer.getBuffer(), mesh.m_indexBuffer->getBuffer(), bufferSize);
-}
+    // Indices stay relative to the mesh, the pool offset is applied through vertexOffset at draw time,
+    // so small meshes can still be narrowed to 16 bits
+    const bool useShortIndices = mesh.getVertexCount() <= std::numeric_limits<uint16_t>::max();
+    mesh.m_indexType = useShortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    const uint32_t indexSize = useShortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
 
-void Model::createTexture(Texture& texture) noexcept {
-    Buffer stagingBuffer{
-        m_device,
-        texture.getImageSize(),
-        1,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
+    mesh.m_indexAllocation =
+        m_geometryPool.allocate(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexSize, mesh.getIndexCount());
+    if (useShortIndices) {
+        std::vector<uint16_t> shortIndices(indices.size());
+        std::transform(indices.begin(), indices.end(), shortIndices.begin(),
+                       [](const uint32_t index) { return static_cast<uint16_t>(index); });
+        m_geometryPool.upload(mesh.m_indexAllocation, indexSize, shortIndices.data(), uploadContext);
+    } else {
+        m_geometryPool.upload(mesh.m_indexAllocation, indexSize, indices.data(), uploadContext);
+    }
+}
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer(texture.getData());
+void Model::createInstanceBuffers(Mesh& mesh, UploadContext& uploadContext) noexcept {
+    // The instances are final once they are uploaded
+    mesh.updateInstanceBounds();
+    const InstanceData identity{};
+    const std::span<const InstanceData> instances =
+        mesh.m_instances.empty() ? std::span<const InstanceData>(&identity, 1) : std::span(mesh.m_instances);
 
-    texture.clearDataOnCPU();
+    mesh.m_instanceAllocation = m_geometryPool.allocate(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(InstanceData),
+                                                        static_cast<uint32_t>(instances.size()));
+    m_geometryPool.upload(mesh.m_instanceAllocation, sizeof(InstanceData), instances.data(), uploadContext);
+}
 
+void Model::createTexture(Texture& texture, UploadContext& uploadContext) noexcept {
     VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
+    MemoryAllocation textureImageMemory;
 
     uint32_t arrLayers = 1;
     switch (texture.getTextureType()) {
@@ -102,50 +174,81 @@ void Model::createTexture(Texture& texture) noexcept {
         case Texture::TextureType::Cubemap: arrLayers = 6; break;
         default: break;
     }
+    const auto width = static_cast<uint32_t>(texture.getWidth());
+    const auto height = static_cast<uint32_t>(texture.getHeight());
+    const uint32_t mipLevels = texture.getMipLevels();
+    const VkFormat format = texture.getFormat();
+    // Colors are sampled through a UNORM view as the shaders decode sRGB themselves, but their image is sRGB so
+    // the blits average them in linear light
+    const VkFormat blitFormat =
+        texture.getRole() == Texture::Role::Color && !texture.isCompressed() ? VK_FORMAT_R8G8B8A8_SRGB : format;
+    // Block-compressed files carry their own chain, BC formats can't be blitted anyway
+    const bool blitMips = !texture.isCompressed() && mipLevels > 1 && m_device.supportsLinearBlit(blitFormat);
+
+    std::vector<VkBufferImageCopy> regions;
+    Buffer* stagingBuffer = nullptr;
+    if (texture.isCompressed()) {
+        stagingBuffer = &uploadContext.createStagingBuffer(texture.getImageSize());
+        packCompressedImage(texture.getCompressedImage(), static_cast<std::byte*>(stagingBuffer->getMappedMemory()),
+                            regions);
+    } else if (mipLevels > 1 && !blitMips) {
+        const auto chain = buildMipChain(texture, width, height, arrLayers, mipLevels, regions);
+        stagingBuffer = &uploadContext.createStagingBuffer(chain.size());
+        stagingBuffer->writeToBuffer(chain.data());
+    } else {
+        stagingBuffer = &uploadContext.createStagingBuffer(texture.getImageSize());
+        texture.copyPixelsTo(stagingBuffer->getMappedMemory());
+    }
+
+    texture.clearDataOnCPU();
     VkImageCreateFlags image_flags = (texture.getTextureType() == Texture::TextureType::Cubemap) ?
                                          VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT :
                                          0;
+    if (blitMips && blitFormat != format) image_flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = texture.getWidth();
     imageInfo.extent.height = texture.getHeight();
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = arrLayers;
-    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.format = blitMips ? blitFormat : format;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (blitMips) imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = image_flags;
 
     m_device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-    m_device.transitionImageLayout(
+    uploadContext.transitionImageLayout(
         textureImage,
-        VK_FORMAT_R8G8B8A8_UNORM,
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        arrLayers);
-    m_device.copyBufferToImage(
-        stagingBuffer.getBuffer(),
-        textureImage,
-        static_cast<uint32_t>(texture.getWidth()),
-        static_cast<uint32_t>(texture.getHeight()),
-        arrLayers);
-    m_device.transitionImageLayout(
-        textureImage,
-        VK_FORMAT_R8G8B8A8_UNORM,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        arrLayers);
+        arrLayers,
+        mipLevels);
+    if (regions.empty())
+        uploadContext.copyBufferToImage(stagingBuffer->getBuffer(), textureImage, width, height, arrLayers);
+    else
+        uploadContext.copyBufferToImage(stagingBuffer->getBuffer(), textureImage, regions);
+    if (blitMips)
+        uploadContext.generateMipmaps(textureImage, width, height, mipLevels, arrLayers);
+    else
+        uploadContext.transitionImageLayout(
+            textureImage,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            arrLayers,
+            mipLevels);
 
     auto textureImageView = m_device.createImageView(
         textureImage,
-        VK_FORMAT_R8G8B8A8_UNORM,
-        texture.getTextureType() == Texture::TextureType::Cubemap);
+        format,
+        texture.getTextureType() == Texture::TextureType::Cubemap,
+        mipLevels);
 
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -163,7 +266,7 @@ void Model::createTexture(Texture& texture) noexcept {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(mipLevels);
 
     auto sampler = m_device.createTextureSampler(samplerInfo);
 
@@ -173,6 +276,6 @@ void Model::createTexture(Texture& texture) noexcept {
     texture.setSampler(sampler);
 }
 
-Model::Model(Device& device) : m_device(device) {}
+Model::Model(Device& device) : m_device(device), m_geometryPool(device) {}
 
 }  // namespace sge
@@ -0,0 +1,68 @@
+#include "ObjectBuffer.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace sge {
+ObjectBuffer::ObjectBuffer(Device& device, uint32_t frameCount, uint32_t capacity)
+    : m_capacity(capacity), m_dirtyRanges(frameCount) {
+    const VkDeviceSize alignment =
+        std::max<VkDeviceSize>(device.getPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment, 1);
+    m_regionSize = (sizeof(ObjectData) * m_capacity + alignment - 1) / alignment * alignment;
+    m_buffer = std::make_unique<Buffer>(device, m_regionSize, frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer->map();
+    m_objects.reserve(m_capacity);
+}
+
+std::optional<uint32_t> ObjectBuffer::add(const ObjectData& object) {
+    if (m_objects.size() == m_capacity) {
+        LOG_ERROR("ObjectBuffer: all " << m_capacity << " objects are in use")
+        return std::nullopt;
+    }
+    const auto index = static_cast<uint32_t>(m_objects.size());
+    m_objects.push_back(object);
+    markDirty(index, index + 1);
+    return index;
+}
+
+void ObjectBuffer::update(uint32_t index, const ObjectData& object) {
+    assert(index < m_objects.size() && "Object index is out of range");
+    m_objects[index] = object;
+    markDirty(index, index + 1);
+}
+
+const ObjectData& ObjectBuffer::get(uint32_t index) const noexcept {
+    assert(index < m_objects.size() && "Object index is out of range");
+    return m_objects[index];
+}
+
+void ObjectBuffer::markDirty(uint32_t begin, uint32_t end) noexcept {
+    for (auto& range : m_dirtyRanges) {
+        if (range.begin == range.end) {
+            range = {begin, end};
+            continue;
+        }
+        range.begin = std::min(range.begin, begin);
+        range.end = std::max(range.end, end);
+    }
+}
+
+void ObjectBuffer::beginFrame(uint32_t frameIndex) noexcept {
+    assert(frameIndex < m_dirtyRanges.size() && "Frame index is out of the ring");
+    m_frameIndex = frameIndex;
+    auto& range = m_dirtyRanges[frameIndex];
+    if (range.begin == range.end) return;
+    auto* region = static_cast<char*>(m_buffer->getMappedMemory()) + m_regionSize * frameIndex;
+    std::memcpy(region + sizeof(ObjectData) * range.begin, m_objects.data() + range.begin,
+                sizeof(ObjectData) * (range.end - range.begin));
+    range = {};
+}
+
+VkDescriptorBufferInfo ObjectBuffer::descriptorInfo() const {
+    return VkDescriptorBufferInfo{.buffer = m_buffer->getBuffer(), .offset = 0, .range = m_regionSize};
+}
+}  // namespace sge
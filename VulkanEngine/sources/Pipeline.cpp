@@ -5,6 +5,7 @@
 #include "VulkanHelpUtils.h"
 
 #include <cassert>
+#include <chrono>
 
 namespace sge {
 
@@ -45,6 +46,17 @@ void Pipeline::crateGraphicsPipeline() {
     fragShaderStageInfo.pNext = nullptr;
     fragShaderStageInfo.pSpecializationInfo = nullptr;
 
+    const auto& fragmentSpecialization = m_pipelineData.getShader().getDefines().fragmentSpecialization;
+    std::vector<VkSpecializationMapEntry> specializationEntries(fragmentSpecialization.size());
+    for (uint32_t i = 0; i < specializationEntries.size(); ++i)
+        specializationEntries[i] = {.constantID = i, .offset = i * sizeof(uint32_t), .size = sizeof(uint32_t)};
+    const VkSpecializationInfo specializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+        .pMapEntries = specializationEntries.data(),
+        .dataSize = fragmentSpecialization.size() * sizeof(uint32_t),
+        .pData = fragmentSpecialization.data()};
+    if (!fragmentSpecialization.empty()) fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
     VkPipelineShaderStageCreateInfo geometryShaderStageInfo{};
     if (m_pipelineData.getShader().isGeometryShaderPresent()) {
         geometryShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -152,9 +164,19 @@ void Pipeline::crateGraphicsPipeline() {
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    auto result = vkCreateGraphicsPipelines(m_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                            &m_graphicsPipeline);
+    auto& pipelineCache = m_device.getPipelineCache();
+    VkPipelineCreationFeedback creationFeedback{};
+    VkPipelineCreationFeedbackCreateInfo creationFeedbackInfo{};
+    creationFeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    creationFeedbackInfo.pPipelineCreationFeedback = &creationFeedback;
+    if (pipelineCache.hasCreationFeedback()) pipelineInfo.pNext = &creationFeedbackInfo;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto result = vkCreateGraphicsPipelines(m_device.device(), pipelineCache.getPipelineCache(), 1, &pipelineInfo,
+                                            nullptr, &m_graphicsPipeline);
     VK_CHECK_RESULT(result, "Failed to create graphics pipeline")
+    pipelineCache.recordCreation(pipelineCache.hasCreationFeedback() ? &creationFeedback : nullptr,
+                                 std::chrono::steady_clock::now() - start);
     vkDestroyShaderModule(m_device.device(), vertShaderModule, nullptr);
     vkDestroyShaderModule(m_device.device(), fragShaderModule, nullptr);
     if (m_pipelineData.getShader().isGeometryShaderPresent())
@@ -189,15 +211,21 @@ std::vector<VkPipelineColorBlendAttachmentState> Pipeline::createDefaultColorAtt
     return colorBlendAttachment;
 }
 
-/*static*/ const VkPipelineLayout Pipeline::createPipeLineLayout(const VkDevice device, VkDescriptorSetLayout setLayout) {
+/*static*/ const VkPipelineLayout Pipeline::createPipeLineLayout(
+    const VkDevice device, VkDescriptorSetLayout setLayout, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+    return createPipeLineLayout(device, std::vector<VkDescriptorSetLayout>{setLayout}, pushConstantRanges);
+}
+
+/*static*/ const VkPipelineLayout Pipeline::createPipeLineLayout(
+    const VkDevice device, const std::vector<VkDescriptorSetLayout>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstantRanges) {
     VkPipelineLayout pipelineLayout;
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{setLayout};
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.empty() ? nullptr : pushConstantRanges.data();
     auto result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
     VK_CHECK_RESULT(result, "Failed to create pipeline layout");
     return pipelineLayout;
@@ -210,7 +238,7 @@ bool Pipeline::recreatePipelineShaders(const VkRenderPass renderPass) {
                      m_pipelineData.getShader().getGeometryShaderPath(), m_pipelineData.getShader().getDefines());
     if (newShader.isValid() == true) {
         m_pipelineData.getShader() = std::move(newShader);
-        VK_CHECK_RESULT(vkDeviceWaitIdle(m_device.device()), "Failed to wait idle during recreationg pipeline shaders");
+        m_device.waitIdle();
         vkDestroyPipeline(m_device.device(), m_graphicsPipeline, nullptr);
         crateGraphicsPipeline();
       } else {
@@ -0,0 +1,131 @@
+#include "PipelineCache.h"
+
+#include "Logger.h"
+#include "MappedFile.h"
+#include "VulkanHelpUtils.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+namespace sge {
+PipelineCache::PipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties,
+                             const bool hasCreationFeedback, std::filesystem::path cachePath) noexcept
+    : m_device(device),
+      m_properties(properties),
+      m_hasCreationFeedback(hasCreationFeedback),
+      m_cachePath(std::move(cachePath)) {
+    const std::vector<std::byte> data = load();
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.data();
+    VkResult result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        LOG_ERROR("Pipeline cache: the driver rejected " << m_cachePath.string() << ", starting empty")
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+    } else if (!data.empty()) {
+        m_statistics.loadedBytes = data.size();
+        LOG_MSG("Pipeline cache: loaded " << data.size() << " bytes from " << m_cachePath.string())
+    }
+    VK_CHECK_RESULT(result, "Failed to create pipeline cache")
+}
+
+PipelineCache::~PipelineCache() { vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr); }
+
+VkPipelineCache PipelineCache::getPipelineCache() const noexcept { return m_pipelineCache; }
+
+bool PipelineCache::hasCreationFeedback() const noexcept { return m_hasCreationFeedback; }
+
+void PipelineCache::recordCreation(const VkPipelineCreationFeedback* feedback,
+                                   std::chrono::duration<double, std::milli> creationTime) {
+    std::lock_guard lock(m_mutex);
+    if (feedback == nullptr || !(feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT)) {
+        ++m_statistics.unknownCount;
+    } else {
+        // The driver's own measurement leaves out the feedback bookkeeping around the call
+        creationTime = std::chrono::nanoseconds(feedback->duration);
+        if (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+            ++m_statistics.hitCount;
+        else
+            ++m_statistics.missCount;
+    }
+    m_statistics.creationTime += creationTime;
+}
+
+PipelineCache::Statistics PipelineCache::getStatistics() const {
+    std::lock_guard lock(m_mutex);
+    return m_statistics;
+}
+
+std::vector<std::byte> PipelineCache::load() const noexcept {
+    std::error_code ec;
+    if (!std::filesystem::exists(m_cachePath, ec)) return {};
+    const MappedFile file(m_cachePath);
+    if (!file.isValid()) return {};
+    VkPipelineCacheHeaderVersionOne header;
+    if (file.size() < sizeof(header)) {
+        LOG_MSG("Pipeline cache: " << m_cachePath.string() << " is truncated, ignoring it")
+        return {};
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.headerSize < sizeof(header) || header.headerSize > file.size() ||
+        header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        LOG_MSG("Pipeline cache: " << m_cachePath.string() << " has an unknown header, ignoring it")
+        return {};
+    }
+    // The UUID changes with the driver version, pipelines of an older driver would be compiled again anyway
+    if (header.vendorID != m_properties.vendorID || header.deviceID != m_properties.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        LOG_MSG("Pipeline cache: " << m_cachePath.string() << " is from another device or driver, ignoring it")
+        return {};
+    }
+    return std::vector<std::byte>(file.data(), file.data() + file.size());
+}
+
+bool PipelineCache::save() const noexcept {
+    const Statistics statistics = getStatistics();
+    LOG_MSG("Pipeline cache: " << statistics.hitCount << " hits, " << statistics.missCount << " misses, "
+                               << statistics.unknownCount << " without feedback, "
+                               << statistics.creationTime.count() << " ms creating pipelines")
+    if (statistics.loadedBytes != 0 && statistics.missCount == 0 && statistics.unknownCount == 0) return true;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) return false;
+    std::vector<char> data(size);
+    // VK_INCOMPLETE can't happen, nothing creates pipelines on shutdown
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &size, data.data()) != VK_SUCCESS) {
+        LOG_ERROR("Pipeline cache: failed to get the cache data")
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_cachePath.parent_path(), ec);
+    // Written under another name and renamed, a crash while writing leaves the previous file intact
+    auto tempPath = m_cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR("Pipeline cache: can't create file " << tempPath.string())
+            return false;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        if (!file.good()) {
+            LOG_ERROR("Pipeline cache: failed to write file " << tempPath.string())
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, m_cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    LOG_MSG("Pipeline cache: saved " << size << " bytes to " << m_cachePath.string())
+    return true;
+}
+}  // namespace sge
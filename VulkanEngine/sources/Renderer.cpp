@@ -29,7 +29,7 @@ void Renderer::recreateSwapChain() noexcept {
         extent = m_window.getExtent();
         glfwWaitEvents();
     }
-    VK_CHECK_RESULT(vkDeviceWaitIdle(m_device.device()), "Failed to device wait idle while recreating swapchain");
+    m_device.waitIdle();
     m_swapChain = nullptr;
     m_swapChain = std::make_unique<SwapChain>(m_device, extent);
     LOG_MSG("New SwapChain has been created!");
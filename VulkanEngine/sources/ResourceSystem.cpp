@@ -14,6 +14,13 @@ void ResourceSystem::init(const Device* device) noexcept
     m_isInitilized = true;
 }
 
+void ResourceSystem::clear() noexcept {
+    m_workFlows.clear();
+    m_pipelines.clear();
+    m_descriptors.clear();
+    m_constBuffers.clear();
+}
+
 uint32_t ResourceSystem::addFramebuffer(FrameBuffer&& framebuffer) {
     assert(framebuffer.valid() && "FrameBuffer is not valid!");
     m_frameBuffers.emplace_back(std::move(framebuffer));
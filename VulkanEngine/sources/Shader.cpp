@@ -1,18 +1,101 @@
 #include "Shader.h"
 
 #include "Logger.h"
+#include "ThreadPool.h"
+#ifdef SGE_EMBEDDED_SHADERS
+#include "EmbeddedShaders.h"
+#else
+#include "Hash.h"
+#include "ShaderCache.h"
 
 #include <shaderc/shaderc.hpp>
+#endif
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <utility>
 
 namespace sge {
+namespace {
+#ifdef SGE_EMBEDDED_SHADERS
+bool loadEmbeddedShader(const std::string_view path, const std::string_view defines,
+                        std::vector<uint32_t>& spirv) noexcept {
+    for (const auto& shader : getEmbeddedShaders()) {
+        if (shader.path != path || shader.defines != defines) continue;
+        spirv.resize(shader.spirv.size() / sizeof(uint32_t));
+        std::memcpy(spirv.data(), shader.spirv.data(), shader.spirv.size());
+        return true;
+    }
+    LOG_ERROR("Shader permutation isn't embedded: " << path << "\nDefines:\n" << defines)
+    return false;
+}
+#else
+constexpr shaderc_optimization_level OPTIMIZATION_LEVEL = shaderc_optimization_level_performance;
+constexpr shaderc_env_version TARGET_ENVIRONMENT = shaderc_env_version_vulkan_1_2;
+constexpr shaderc_spirv_version TARGET_SPIRV = shaderc_spirv_version_1_5;
+constexpr bool GENERATE_DEBUG_INFO = true;
+
+//! Every compiler option that changes the SPIR-V, part of the shader cache key
+uint64_t compilerOptionsHash(const bool isHLSL) noexcept {
+    uint64_t hash = hashValue(OPTIMIZATION_LEVEL);
+    hash = hashValue(TARGET_ENVIRONMENT, hash);
+    hash = hashValue(TARGET_SPIRV, hash);
+    hash = hashValue(GENERATE_DEBUG_INFO, hash);
+    return hashValue(isHLSL, hash);
+}
+
+//! Resolves #include relative to the including file and records every file it opens
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+ public:
+    explicit ShaderIncluder(std::vector<std::string>& includedFiles) : m_includedFiles(includedFiles) {}
+
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type, const char* requestingSource,
+                                       size_t) override {
+        auto include = std::make_unique<Include>();
+        const auto path = (std::filesystem::path(requestingSource).parent_path() / requestedSource).lexically_normal();
+        include->path = path.generic_string();
+        if (std::ifstream file(path, std::ios::binary); file.is_open()) {
+            std::stringstream content;
+            content << file.rdbuf();
+            include->content = content.str();
+            m_includedFiles.push_back(include->path);
+        } else {
+            // shaderc reports an empty source name as a failed include, with the content as the message
+            include->content = "Can't open include file " + include->path;
+            include->path.clear();
+        }
+        include->result = {include->path.c_str(), include->path.size(), include->content.c_str(),
+                           include->content.size(), include.get()};
+        return &include.release()->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* data) override { delete static_cast<Include*>(data->user_data); }
+
+ private:
+    struct Include {
+        std::string path;
+        std::string content;
+        shaderc_include_result result;
+    };
+
+    std::vector<std::string>& m_includedFiles;
+};
+#endif
+}  // namespace
+
 std::string Shader::readFile(const std::string_view filePath) noexcept {
     std::ifstream file(filePath.data(), std::ios::ate | std::ios::binary);
     if (!file.is_open()) {
         LOG_ERROR("Failed to open file: " << filePath << "!")
-        m_isValid = false;
         assert(false);
         return "";
     }
@@ -25,110 +108,174 @@ std::string Shader::readFile(const std::string_view filePath) noexcept {
     return buffer;
 }
 
-bool Shader::processShader(const ShaderType type, bool isHLSL) noexcept {
-    shaderc::CompileOptions compilerOptions;
-    compilerOptions.SetOptimizationLevel(shaderc_optimization_level_performance);
-    compilerOptions.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
-    compilerOptions.SetTargetSpirv(shaderc_spirv_version_1_5);
-    compilerOptions.SetWarningsAsErrors();
-    compilerOptions.SetGenerateDebugInfo();
+#ifdef SGE_EMBEDDED_SHADERS
+bool Shader::processShader(const ShaderType type, bool) noexcept {
+    switch (type) {
+        case ShaderType::VertexShader:
+            return loadEmbeddedShader(m_vertShaderPath, m_defines.vertShaderDefines, m_vertexShaderSpirV);
+        case ShaderType::FragmentShader:
+            return loadEmbeddedShader(m_fragShaderPath, m_defines.fragmentShaderDefines, m_fragShaderSpirV);
+        case ShaderType::GeometryShader:
+            return loadEmbeddedShader(m_geometryShaderPath, m_defines.geometryShaderDefines, m_geometryShaderSpirV);
+    }
+    return false;
+}
 
-    const shaderc_source_language lang = isHLSL ? shaderc_source_language_hlsl : shaderc_source_language_glsl;
-    compilerOptions.SetSourceLanguage(lang);
-    shaderc::SpvCompilationResult result;
-    switch (shaderc::Compiler compiler; type) {
+//! Every permutation the app requests is compiled at build time, the sources aren't read at all
+bool Shader::compileStage(const ShaderType type) noexcept { return processShader(type); }
+#else
+bool Shader::processShader(const ShaderType type, bool isHLSL) noexcept {
+    const std::string* source = nullptr;
+    const std::string* sourcePath = nullptr;
+    std::vector<uint32_t>* spirv = nullptr;
+    shaderc_shader_kind kind = shaderc_vertex_shader;
+    switch (type) {
         case ShaderType::VertexShader:
-            result = compiler.CompileGlslToSpv(m_vertShader, shaderc_vertex_shader, "sh.vert", "main", compilerOptions);
-            m_vertexShaderSpirV = {result.cbegin(), result.cend()};
+            source = &m_vertShader;
+            sourcePath = &m_vertShaderPath;
+            spirv = &m_vertexShaderSpirV;
+            kind = shaderc_vertex_shader;
             break;
         case ShaderType::FragmentShader:
-            result = compiler.CompileGlslToSpv(m_fragShader, shaderc_fragment_shader, "sh.frag", "main",
-                                               compilerOptions);
-#if 0
-			{auto preresult = compiler.PreprocessGlsl(m_fragShader, shaderc_fragment_shader, "sh.frag", compilerOptions);
-			LOG_MSG(std::string{ preresult.begin(), preresult.end() });
-		}
-#endif
-            m_fragShaderSpirV = {result.cbegin(), result.cend()};
+            source = &m_fragShader;
+            sourcePath = &m_fragShaderPath;
+            spirv = &m_fragShaderSpirV;
+            kind = shaderc_fragment_shader;
             break;
         case ShaderType::GeometryShader:
-            result = compiler.CompileGlslToSpv(m_geometryShader, shaderc_geometry_shader, "sh.geom", "main",
-                                               compilerOptions);
-            m_geometryShaderSpirV = {result.cbegin(), result.cend()};
+            source = &m_geometryShader;
+            sourcePath = &m_geometryShaderPath;
+            spirv = &m_geometryShaderSpirV;
+            kind = shaderc_geometry_shader;
+            break;
     }
+
+    const ShaderCache cache(*source, *sourcePath, static_cast<uint32_t>(type), compilerOptionsHash(isHLSL));
+    if (auto cached = cache.load()) {
+        *spirv = std::move(*cached);
+        return true;
+    }
+
+    std::vector<std::string> includedFiles;
+    shaderc::CompileOptions compilerOptions;
+    compilerOptions.SetOptimizationLevel(OPTIMIZATION_LEVEL);
+    compilerOptions.SetTargetEnvironment(shaderc_target_env_vulkan, TARGET_ENVIRONMENT);
+    compilerOptions.SetTargetSpirv(TARGET_SPIRV);
+    compilerOptions.SetWarningsAsErrors();
+    if (GENERATE_DEBUG_INFO) compilerOptions.SetGenerateDebugInfo();
+    compilerOptions.SetIncluder(std::make_unique<ShaderIncluder>(includedFiles));
+
+    const shaderc_source_language lang = isHLSL ? shaderc_source_language_hlsl : shaderc_source_language_glsl;
+    compilerOptions.SetSourceLanguage(lang);
+    // The real path lets the includer resolve relative includes
+    const shaderc::SpvCompilationResult result =
+        shaderc::Compiler().CompileGlslToSpv(*source, kind, sourcePath->c_str(), "main", compilerOptions);
+    *spirv = {result.cbegin(), result.cend()};
     if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
         LOG_ERROR("Error message: " << result.GetErrorMessage());
         LOG_ERROR("Shader compile status: " << result.GetCompilationStatus());
         return false;
     }
+    cache.store(*spirv, includedFiles);
     return true;
 }
 
-bool Shader::compileShaders() noexcept {
-    const auto vertexExtenstionPos = m_vertShaderPath.rfind('.');
-    if (vertexExtenstionPos == std::string::npos) {
-        LOG_ERROR("Can't open vertex shader file without extenstion!\nFile: " << m_vertShaderPath);
-        return (false);
+bool Shader::compileStage(const ShaderType type) noexcept {
+    const std::string* path = nullptr;
+    const std::string* defines = nullptr;
+    std::string* source = nullptr;
+    std::string_view stageName;
+    switch (type) {
+        case ShaderType::VertexShader:
+            path = &m_vertShaderPath;
+            defines = &m_defines.vertShaderDefines;
+            source = &m_vertShader;
+            stageName = "vertex";
+            break;
+        case ShaderType::FragmentShader:
+            path = &m_fragShaderPath;
+            defines = &m_defines.fragmentShaderDefines;
+            source = &m_fragShader;
+            stageName = "fragment";
+            break;
+        case ShaderType::GeometryShader:
+            path = &m_geometryShaderPath;
+            defines = &m_defines.geometryShaderDefines;
+            source = &m_geometryShader;
+            stageName = "geometry";
+            break;
     }
 
-    const auto fragmentExtenstionPos = m_fragShaderPath.rfind('.');
-    if (fragmentExtenstionPos == std::string::npos) {
-        LOG_ERROR("Can't open fragment shader file without extenstion!\nFile: " << m_fragShaderPath);
-        return (false);
+    const auto extenstionPos = path->rfind('.');
+    if (extenstionPos == std::string::npos) {
+        LOG_ERROR("Can't open " << stageName << " shader file without extenstion!\nFile: " << *path);
+        return false;
     }
+    const bool isHLSL = (path->substr(extenstionPos) == ".hlsl");
 
-    const auto geometryExtenstionPos = m_geometryShaderPath.rfind('.');
-    if (!m_geometryShaderPath.empty()) {
-        if (geometryExtenstionPos == std::string::npos) {
-            LOG_ERROR("Can't open geometry shader file without extenstion!\nFile: " << m_geometryShaderPath);
-            return (false);
+    const std::string shaderText = readFile(*path);
+    if (shaderText.empty()) return false;
+    if (!isHLSL) {
+        const auto versionPos = shaderText.find("#version ");
+        if (versionPos == std::string::npos) {
+            LOG_ERROR("Can't found \"#version\" in " << stageName << " shader!\nFile: " << *path);
+            return false;
         }
-    }
-
-    bool isHLSL = (m_vertShaderPath.substr(vertexExtenstionPos) == ".hlsl");
-
-    if (auto vertShaderText = readFile(m_vertShaderPath); !isHLSL) {
-        auto versionPos = vertShaderText.find("#version ");
-        m_vertShader = vertShaderText.substr(0, versionPos + 12) + "\n" + m_defines.vertShaderDefines +
-                       vertShaderText.substr(versionPos + 12);
+        *source = shaderText.substr(0, versionPos + 12) + "\n" + *defines + shaderText.substr(versionPos + 12);
     } else
-        m_vertShader = m_defines.vertShaderDefines + vertShaderText;
+        *source = *defines + shaderText;
 
-    if (processShader(ShaderType::VertexShader, isHLSL) == false) return false;
+    return processShader(type, isHLSL);
+}
+#endif
 
-    isHLSL = (m_fragShaderPath.substr(fragmentExtenstionPos) == ".hlsl");
+bool Shader::compileShaders() noexcept {
+    return compileStage(ShaderType::VertexShader) && compileStage(ShaderType::FragmentShader) &&
+           (m_geometryShaderPath.empty() || compileStage(ShaderType::GeometryShader));
+}
 
-    if (auto fragShaderText = readFile(m_fragShaderPath); !isHLSL) {
-        auto versionPos = fragShaderText.find("#version ");
-        if (versionPos == std::string::npos) {
-            LOG_ERROR("Can't found \"#version\" in fragment shader!\nFile: " << m_fragShaderPath);
-            return (false);
+/*static*/ void Shader::compileAll(const std::span<Shader> shaders) noexcept {
+    // Stages are claimed in order by the pool tasks and by the calling thread alike. A task queued behind long
+    // work finds nothing left when it starts, so the caller only ever waits for stages a worker is compiling
+    struct Batch {
+        std::vector<std::pair<Shader*, ShaderType>> stages;
+        std::vector<char> results;
+        std::atomic<size_t> next{0};
+        size_t doneCount = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto batch = std::make_shared<Batch>();
+    for (auto& shader : shaders) {
+        shader.m_isValid = true;
+        batch->stages.emplace_back(&shader, ShaderType::VertexShader);
+        batch->stages.emplace_back(&shader, ShaderType::FragmentShader);
+        if (!shader.m_geometryShaderPath.empty()) batch->stages.emplace_back(&shader, ShaderType::GeometryShader);
+    }
+    if (batch->stages.empty()) return;
+    batch->results.resize(batch->stages.size());
+    const auto compileClaimed = [](Batch& batch) {
+        for (size_t i = batch.next++; i < batch.stages.size(); i = batch.next++) {
+            const bool result = batch.stages[i].first->compileStage(batch.stages[i].second);
+            std::scoped_lock lock(batch.mutex);
+            batch.results[i] = result;
+            if (++batch.doneCount == batch.stages.size()) batch.done.notify_one();
         }
-        m_fragShader = fragShaderText.substr(0, versionPos + 12) + "\n" + m_defines.fragmentShaderDefines +
-                       fragShaderText.substr(versionPos + 12);
-    } else
-        m_fragShader = m_defines.fragmentShaderDefines + fragShaderText;
-
-    if (processShader(ShaderType::FragmentShader, isHLSL) == false) return false;
-
-    if (!m_geometryShaderPath.empty()) {
-        isHLSL = (m_geometryShaderPath.substr(geometryExtenstionPos) == ".hlsl");
-
-        if (auto geometryShaderText = readFile(m_geometryShaderPath); !isHLSL) {
-            auto versionPos = geometryShaderText.find("#version ");
-            if (versionPos == std::string::npos) {
-                LOG_ERROR("Can't found \"#version\" in geometry shader!\nFile: " << m_geometryShaderPath);
-                return (false);
-            }
-            m_geometryShader = geometryShaderText.substr(0, versionPos + 12) + "\n" + m_defines.geometryShaderDefines +
-                               geometryShaderText.substr(versionPos + 12);
-        } else
-            m_geometryShader = m_defines.geometryShaderDefines + geometryShaderText;
-        if (processShader(ShaderType::GeometryShader, isHLSL) == false) return false;
+    };
+
+    const size_t helperCount = std::min(batch->stages.size(), ThreadPool::Instance().size() + 1) - 1;
+    for (size_t i = 0; i < helperCount && !ThreadPool::isWorkerThread(); ++i)
+        static_cast<void>(ThreadPool::Instance().submit([batch, compileClaimed]() { compileClaimed(*batch); }));
+    compileClaimed(*batch);
+    {
+        std::unique_lock lock(batch->mutex);
+        batch->done.wait(lock, [&batch]() { return batch->doneCount == batch->stages.size(); });
     }
 
-    return true;
+    for (size_t i = 0; i < batch->stages.size(); ++i)
+        batch->stages[i].first->m_isValid = batch->results[i] && batch->stages[i].first->m_isValid;
 }
+
 /*!
     Shader constructor
     \param vertexShaderPath - path to vertex shader source
@@ -144,6 +291,11 @@ Shader::Shader(const std::string_view vertexShaderPath, const std::string_view f
     m_isValid = compileShaders();
 }
 
+Shader::Shader(Deferred, const std::string_view vertexShaderPath, const std::string_view fragmentShaderPath,
+               const std::string_view geometryShaderPath, const ShaderDefines& defines) noexcept
+    : m_vertShaderPath(vertexShaderPath), m_fragShaderPath(fragmentShaderPath),
+      m_geometryShaderPath(geometryShaderPath), m_defines(defines), m_isValid(false) {}
+
 Shader::Shader(const Shader& other)
     : m_vertShaderPath(other.m_vertShaderPath),
       m_fragShaderPath(other.m_fragShaderPath),
@@ -154,7 +306,8 @@ Shader::Shader(const Shader& other)
       m_vertexShaderSpirV(other.m_vertexShaderSpirV),
       m_fragShaderSpirV(other.m_fragShaderSpirV),
       m_geometryShaderSpirV(other.m_geometryShaderSpirV),
-      m_defines(other.m_defines) {}
+      m_defines(other.m_defines),
+      m_isValid(other.m_isValid) {}
 
 Shader::Shader(Shader&& other) noexcept
     : m_vertShaderPath(std::move(other.m_vertShaderPath)),
@@ -166,7 +319,8 @@ Shader::Shader(Shader&& other) noexcept
       m_vertexShaderSpirV(std::move(other.m_vertexShaderSpirV)),
       m_fragShaderSpirV(std::move(other.m_fragShaderSpirV)),
       m_geometryShaderSpirV(std::move(other.m_geometryShaderSpirV)),
-      m_defines(std::move(other.m_defines)) {}
+      m_defines(std::move(other.m_defines)),
+      m_isValid(other.m_isValid) {}
 
 Shader& Shader::operator=(const Shader& other) {
     m_vertShaderPath = other.m_vertShaderPath;
@@ -179,6 +333,7 @@ Shader& Shader::operator=(const Shader& other) {
     m_fragShaderSpirV = other.m_fragShaderSpirV;
     m_geometryShaderSpirV = other.m_geometryShaderSpirV;
     m_defines = other.m_defines;
+    m_isValid = other.m_isValid;
     return *this;
 }
 Shader& Shader::operator=(Shader&& other) noexcept {
@@ -192,6 +347,7 @@ Shader& Shader::operator=(Shader&& other) noexcept {
     m_fragShaderSpirV = std::move(other.m_fragShaderSpirV);
     m_geometryShaderSpirV = std::move(other.m_geometryShaderSpirV);
     m_defines = std::move(other.m_defines);
+    m_isValid = other.m_isValid;
     return *this;
 }
 const std::vector<uint32_t>& Shader::getVertexShader() const noexcept {
@@ -212,6 +368,11 @@ const std::string& Shader::getGeometryShaderPath() const noexcept { return m_geo
 const ShaderDefines& Shader::getDefines() const noexcept { return m_defines; }
 const bool Shader::isGeometryShaderPresent() const noexcept { return !m_geometryShaderPath.empty(); }
 const bool Shader::isValid() const noexcept { return m_isValid; }
+Shader Shader::specialize(std::vector<uint32_t> fragmentSpecialization) const {
+    Shader shader(*this);
+    shader.m_defines.fragmentSpecialization = std::move(fragmentSpecialization);
+    return shader;
+}
 bool Shader::recompile() noexcept {
     m_isValid = compileShaders();
     assert(m_isValid);
@@ -0,0 +1,145 @@
+#include "ShaderCache.h"
+
+#include "Hash.h"
+#include "Logger.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace sge {
+namespace {
+constexpr char CACHE_MAGIC[4] = {'S', 'G', 'E', 'S'};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t fileSize;
+    uint32_t dependencyCount;
+    uint32_t spirvWordCount;
+    uint64_t spirvOffset;
+};
+
+struct DependencyRecord {
+    uint64_t pathOffset;
+    uint64_t pathSize;
+    uint64_t contentHash;
+};
+
+bool isInFile(const MappedFile& file, const uint64_t offset, const uint64_t size) noexcept {
+    return offset <= file.size() && size <= file.size() - offset;
+}
+
+//! Empty when the file can't be read
+std::optional<uint64_t> hashFile(const std::filesystem::path& path) noexcept {
+    const MappedFile file(path);
+    if (!file.isValid()) return std::nullopt;
+    return hashBytes(file.data(), file.size());
+}
+}  // namespace
+
+ShaderCache::ShaderCache(const std::string_view source, const std::string_view sourcePath, const uint32_t stage,
+                         const uint64_t optionsHash, std::filesystem::path cacheDirectory) noexcept {
+    // The path is part of the key, relative includes of equal sources may resolve to different files
+    m_key = hashString(source);
+    m_key = hashString(sourcePath, m_key);
+    m_key = hashValue(stage, m_key);
+    m_key = hashValue(optionsHash, m_key);
+    m_key = hashValue(VERSION, m_key);
+    std::stringstream fileName;
+    fileName << std::hex << m_key << ".sgeshader";
+    m_cachePath = std::move(cacheDirectory) / fileName.str();
+}
+
+const std::filesystem::path& ShaderCache::getCachePath() const noexcept { return m_cachePath; }
+
+std::optional<std::vector<uint32_t>> ShaderCache::load() const noexcept {
+    std::error_code ec;
+    if (!std::filesystem::exists(m_cachePath, ec)) return std::nullopt;
+    const MappedFile file(m_cachePath);
+    if (!file.isValid() || file.size() < sizeof(FileHeader)) return std::nullopt;
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const uint64_t spirvBytes = static_cast<uint64_t>(header.spirvWordCount) * sizeof(uint32_t);
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != VERSION ||
+        header.key != m_key || header.fileSize != file.size() || header.spirvWordCount == 0 ||
+        !isInFile(file, sizeof(FileHeader), static_cast<uint64_t>(header.dependencyCount) * sizeof(DependencyRecord)) ||
+        !isInFile(file, header.spirvOffset, spirvBytes)) {
+        LOG_MSG("Shader cache: stale or corrupted file " << m_cachePath.string() << ", recompiling")
+        return std::nullopt;
+    }
+    for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+        DependencyRecord record;
+        std::memcpy(&record, file.data() + sizeof(FileHeader) + sizeof(DependencyRecord) * i, sizeof(record));
+        if (!isInFile(file, record.pathOffset, record.pathSize)) return std::nullopt;
+        const std::string path(reinterpret_cast<const char*>(file.data() + record.pathOffset), record.pathSize);
+        if (hashFile(path) != record.contentHash) {
+            LOG_MSG("Shader cache: " << path << " changed, recompiling " << m_cachePath.filename().string())
+            return std::nullopt;
+        }
+    }
+    std::vector<uint32_t> spirv(header.spirvWordCount);
+    std::memcpy(spirv.data(), file.data() + header.spirvOffset, spirvBytes);
+    return spirv;
+}
+
+bool ShaderCache::store(const std::vector<uint32_t>& spirv, const std::vector<std::string>& includedFiles) const
+    noexcept {
+    std::vector<DependencyRecord> records;
+    records.reserve(includedFiles.size());
+    uint64_t offset = sizeof(FileHeader) + sizeof(DependencyRecord) * includedFiles.size();
+    for (const auto& path : includedFiles) {
+        const auto contentHash = hashFile(path);
+        // Can't be validated later, the next run has to compile anyway
+        if (!contentHash) return false;
+        records.push_back({.pathOffset = offset, .pathSize = path.size(), .contentHash = *contentHash});
+        offset += path.size();
+    }
+    // Keeps the SPIR-V words 4-byte aligned
+    const uint64_t padding = (sizeof(uint32_t) - offset % sizeof(uint32_t)) % sizeof(uint32_t);
+    FileHeader header{.version = VERSION,
+                      .key = m_key,
+                      .fileSize = offset + padding + spirv.size() * sizeof(uint32_t),
+                      .dependencyCount = static_cast<uint32_t>(records.size()),
+                      .spirvWordCount = static_cast<uint32_t>(spirv.size()),
+                      .spirvOffset = offset + padding};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_cachePath.parent_path(), ec);
+    // Written under a unique name and renamed, so shaders compiled in parallel never see a partial entry
+    std::stringstream tempName;
+    tempName << m_cachePath.filename().string() << "." << std::this_thread::get_id() << ".tmp";
+    const auto tempPath = m_cachePath.parent_path() / tempName.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR("Shader cache: can't create file " << tempPath.string())
+            return false;
+        }
+        constexpr char zeros[sizeof(uint32_t)] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()),
+                   static_cast<std::streamsize>(sizeof(DependencyRecord) * records.size()));
+        for (const auto& path : includedFiles) file.write(path.data(), static_cast<std::streamsize>(path.size()));
+        file.write(zeros, static_cast<std::streamsize>(padding));
+        file.write(reinterpret_cast<const char*>(spirv.data()),
+                   static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+        if (!file.good()) {
+            LOG_ERROR("Shader cache: failed to write file " << tempPath.string())
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, m_cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+}  // namespace sge
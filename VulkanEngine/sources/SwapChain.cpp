@@ -30,7 +30,7 @@ SwapChain::~SwapChain() {
     for (size_t i = 0; i < m_depthImages.size(); ++i) {
         vkDestroyImageView(m_device.device(), m_depthImageViews[i], nullptr);
         vkDestroyImage(m_device.device(), m_depthImages[i], nullptr);
-        vkFreeMemory(m_device.device(), m_depthImageMemorys[i], nullptr);
+        m_device.freeMemory(m_depthImageMemorys[i]);
     }
 
     for (auto framebuffer : m_swapChainFramebuffers) vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
@@ -270,6 +270,7 @@ VkResult SwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_
     VK_CHECK_RESULT(vkResetFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame]),
                     "Failed to reset fence");  // Сброс fence
 
+    std::scoped_lock queueLock(m_device.queueMutex());
     auto result = vkQueueSubmit(
         m_device.graphicsQueue(), 1, &submitInfo,
         m_inFlightFences[m_currentFrame]);  // Отправляем командный буффер, причём в waitStages будет стоять семофор
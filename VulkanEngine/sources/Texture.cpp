@@ -3,86 +3,231 @@
 #include "Logger.h"
 
 #include <Texture.h>
+#include <TextureCache.h>
+#include <ThreadPool.h>
 #include <stb_image.h>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <utility>
+
 namespace sge {
 enum CubemapTextures { back = 0, front = 1, bottom = 2, top = 3, right = 4, left = 5 };
 
-Texture::Texture(const std::string_view texturePath) : m_texturePath(texturePath), m_cubemapData{} {
+namespace {
+std::atomic<bool> blockCompressionSupported = false;
+
+bool isFormatAllowed(VkFormat format, Texture::Role role) noexcept {
+    switch (role) {
+        // Two channels keep the full block precision for X and Y, Z is rebuilt in the shader
+        case Texture::Role::Normal: return format == VK_FORMAT_BC5_UNORM_BLOCK;
+        case Texture::Role::Color:
+            return format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ||
+                   format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK;
+        // Metallic and roughness live in B and G, BC3 / BC5 would spend their bits on the wrong channels
+        case Texture::Role::Data:
+            return format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ||
+                   format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    }
+    return false;
+}
+
+//! In layer order
+std::array<const std::string*, 6> cubemapFacePaths(const Texture::CubemapData& data) {
+    std::array<const std::string*, 6> paths;
+    paths[back] = &data.backTexturePath;
+    paths[front] = &data.frontTexturePath;
+    paths[bottom] = &data.bottomTexturePath;
+    paths[top] = &data.topTexturePath;
+    paths[right] = &data.rightTexturePath;
+    paths[left] = &data.leftTexturePath;
+    return paths;
+}
+
+bool isCompressedFile(const std::filesystem::path& path) {
+    return path.extension() == ".ktx2" || path.extension() == ".dds";
+}
+}  // namespace
+
+/*static*/ void Texture::setBlockCompressionSupported(bool supported) noexcept {
+    blockCompressionSupported = supported;
+}
+
+Texture::Texture(const std::string_view texturePath, Role role) : m_texturePath(texturePath), m_role(role) {
+    m_textureType = TextureType::Texture2D;
+    if (loadCompressed(role)) return;
     int texChannels;
-    stbi_set_flip_vertically_on_load(false);
+    // Per thread: textures are decoded on the pool while other workers may be loading flipped cubemap faces
+    stbi_set_flip_vertically_on_load_thread(false);
     m_data = stbi_load(m_texturePath.c_str(), &m_texWidth, &m_texHeight, &texChannels, STBI_rgb_alpha);
     if (!m_data) {
         assert(false);
         LOG_ERROR("Failed to load texture: " << m_texturePath << "!")
     }
     m_imageSize = static_cast<size_t>(m_texWidth) * m_texHeight * 4;
-    m_textureType = TextureType::Texture2D;
 }
 
-Texture::Texture(CubemapData&& texturePath) : m_cubemapPath(std::move(texturePath)) {
-    int texChannels;
-    stbi_set_flip_vertically_on_load(true);
-    m_cubemapData[CubemapTextures::back] = stbi_load(m_cubemapPath.backTexturePath.data(), &m_texWidth, &m_texHeight,
-                                                     &texChannels, STBI_rgb_alpha);
-    if (!m_cubemapData[CubemapTextures::back]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.backTexturePath << "!")
-        assert(false);
-    }
-    m_cubemapData[front] = stbi_load(m_cubemapPath.frontTexturePath.data(), &m_texWidth, &m_texHeight, &texChannels,
-                                     STBI_rgb_alpha);
-    if (!m_cubemapData[front]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.frontTexturePath << "!")
-        assert(false);
+bool Texture::loadCompressed(Role role) {
+    const std::filesystem::path path(m_texturePath);
+    std::vector<std::filesystem::path> candidates;
+    if (isCompressedFile(path)) {
+        if (blockCompressionSupported) {
+            candidates.push_back(path);
+        } else {
+            LOG_ERROR("Device doesn't support BC formats, " << m_texturePath << " is replaced with a white texture")
+        }
+    } else if (blockCompressionSupported) {
+        // Baked by sge_texbake
+        if (const TextureCache cache(path, role); cache.isBaked()) candidates.push_back(cache.getCachePath());
+        candidates.push_back(std::filesystem::path(path).replace_extension(".ktx2"));
+        candidates.push_back(std::filesystem::path(path).replace_extension(".dds"));
     }
-    m_cubemapData[left] = stbi_load(m_cubemapPath.leftTexturePath.data(), &m_texWidth, &m_texHeight, &texChannels,
-                                    STBI_rgb_alpha);
-    if (!m_cubemapData[left]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.leftTexturePath << "!")
-        assert(false);
-    }
-    m_cubemapData[right] = stbi_load(m_cubemapPath.rightTexturePath.data(), &m_texWidth, &m_texHeight, &texChannels,
-                                     STBI_rgb_alpha);
-    if (!m_cubemapData[right]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.rightTexturePath << "!")
-        assert(false);
-    }
-    m_cubemapData[bottom] = stbi_load(m_cubemapPath.bottomTexturePath.data(), &m_texWidth, &m_texHeight, &texChannels,
-                                      STBI_rgb_alpha);
-    if (!m_cubemapData[bottom]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.bottomTexturePath << "!")
-        assert(false);
+
+    for (const auto& candidate : candidates) {
+        std::error_code error;
+        if (!std::filesystem::exists(candidate, error)) continue;
+        auto image = CompressedImage::load(candidate);
+        if (!image) continue;
+        if (!isFormatAllowed(image->getFormat(), role) || image->getLayerCount() != 1) {
+            LOG_ERROR("Skipping " << candidate.string() << ": its BC format or layout doesn't suit the texture")
+            continue;
+        }
+        m_texWidth = static_cast<int>(image->getWidth());
+        m_texHeight = static_cast<int>(image->getHeight());
+        m_imageSize = image->getDataSize();
+        m_compressedImage = std::move(image);
+        return true;
     }
-    m_cubemapData[top] = stbi_load(m_cubemapPath.topTexturePath.data(), &m_texWidth, &m_texHeight, &texChannels,
-                                   STBI_rgb_alpha);
-    if (!m_cubemapData[top]) {
-        LOG_ERROR("Failed to load texture: " << m_cubemapPath.topTexturePath << "!")
-        assert(false);
+    if (!isCompressedFile(path)) return false;
+
+    // stbi can't read the file, keep the material usable. Released with stbi_image_free like a decoded image
+    constexpr uint8_t white[4] = {255, 255, 255, 255};
+    m_data = std::malloc(sizeof(white));
+    std::memcpy(m_data, white, sizeof(white));
+    m_texWidth = 1;
+    m_texHeight = 1;
+    m_imageSize = sizeof(white);
+    return true;
+}
+
+Texture::Texture(CubemapData&& texturePath) : m_cubemapPath(std::move(texturePath)) {
+    m_texWidth = 0;
+    m_texHeight = 0;
+    for (const auto* facePath : cubemapFacePaths(m_cubemapPath)) {
+        int width;
+        int height;
+        int texChannels;
+        if (!stbi_info(facePath->c_str(), &width, &height, &texChannels)) {
+            LOG_ERROR("Failed to load texture: " << *facePath << "!")
+            assert(false);
+        } else if (m_texWidth == 0) {
+            m_texWidth = width;
+            m_texHeight = height;
+        } else if (width != m_texWidth || height != m_texHeight) {
+            LOG_ERROR("Cubemap face " << *facePath << " differs in size from the other faces!")
+            assert(false);
+        }
     }
     m_imageSize = static_cast<size_t>(m_texWidth) * m_texHeight * 4 * 6;
-    size_t singleImageSize = static_cast<size_t>(m_texWidth) * m_texHeight * 4;
-    m_dataCubemap.resize(m_imageSize);
-    for (int i = 0; i < 6; ++i) memcpy(m_dataCubemap.data() + singleImageSize * i, m_cubemapData[i], singleImageSize);
-    m_data = m_dataCubemap.data();
-    for (int i = 0; i < 6; ++i) stbi_image_free(m_cubemapData[i]);
     m_textureType = TextureType::Cubemap;
 }
 
+Texture::Texture(const std::array<uint8_t, 4>& color) {
+    // Released with stbi_image_free like a decoded image
+    m_data = std::malloc(color.size());
+    std::memcpy(m_data, color.data(), color.size());
+    m_texWidth = 1;
+    m_texHeight = 1;
+    m_imageSize = color.size();
+    m_generateMips = false;
+}
+
+Texture::Texture(Texture&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_texWidth(other.m_texWidth),
+      m_texHeight(other.m_texHeight),
+      m_imageSize(other.m_imageSize),
+      m_texturePath(std::move(other.m_texturePath)),
+      m_compressedImage(std::move(other.m_compressedImage)),
+      m_cubemapPath(std::move(other.m_cubemapPath)),
+      m_textureType(other.m_textureType),
+      m_role(other.m_role),
+      m_isCPUdataPresent(std::exchange(other.m_isCPUdataPresent, false)),
+      m_generateMips(other.m_generateMips),
+      m_textureImage(std::exchange(other.m_textureImage, nullptr)),
+      m_textureImageMemory(other.m_textureImageMemory),
+      m_imageView(std::exchange(other.m_imageView, nullptr)),
+      m_sampler(std::exchange(other.m_sampler, nullptr)) {}
+
 const void* Texture::getData() const noexcept { return m_data; }
 
+void Texture::copyPixelsTo(void* destination) const {
+    if (m_textureType == TextureType::Texture2D) {
+        std::memcpy(destination, m_data, m_imageSize);
+        return;
+    }
+    const size_t faceSize = m_imageSize / 6;
+    const auto facePaths = cubemapFacePaths(m_cubemapPath);
+    std::array<std::future<void>, 6> decodes;
+    for (size_t face = 0; face < facePaths.size(); ++face) {
+        decodes[face] = ThreadPool::Instance().submit([&, face]() {
+            auto* faceDestination = static_cast<uint8_t*>(destination) + faceSize * face;
+            int width;
+            int height;
+            int texChannels;
+            stbi_set_flip_vertically_on_load_thread(true);
+            stbi_uc* pixels = stbi_load(facePaths[face]->c_str(), &width, &height, &texChannels, STBI_rgb_alpha);
+            if (!pixels || width != m_texWidth || height != m_texHeight) {
+                LOG_ERROR("Failed to load texture: " << *facePaths[face] << "!")
+                assert(false);
+                std::memset(faceDestination, 0, faceSize);
+            } else {
+                std::memcpy(faceDestination, pixels, faceSize);
+            }
+            stbi_image_free(pixels);
+        });
+    }
+    for (auto& decode : decodes) decode.get();
+}
+
 size_t Texture::getImageSize() const noexcept { return m_imageSize; }
 
 int Texture::getWidth() const noexcept { return m_texWidth; }
 
 int Texture::getHeight() const noexcept { return m_texHeight; }
 
+uint32_t Texture::getMipLevels() const noexcept {
+    if (m_compressedImage) return m_compressedImage->getMipLevels();
+    if (!m_generateMips) return 1;
+    return static_cast<uint32_t>(std::bit_width(static_cast<uint32_t>(std::max(m_texWidth, m_texHeight))));
+}
+
+void Texture::setGenerateMips(bool generateMips) noexcept { m_generateMips = generateMips; }
+
+bool Texture::isCompressed() const noexcept { return m_compressedImage.has_value(); }
+
+Texture::Role Texture::getRole() const noexcept { return m_role; }
+
+VkFormat Texture::getFormat() const noexcept {
+    return m_compressedImage ? m_compressedImage->getFormat() : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+const CompressedImage& Texture::getCompressedImage() const noexcept {
+    assert(m_compressedImage);
+    return *m_compressedImage;
+}
+
 void Texture::clearDataOnCPU() noexcept {
+    m_compressedImage.reset();
     switch (m_textureType) {
         case sge::Texture::TextureType::Texture2D: stbi_image_free(m_data); break;
-        case sge::Texture::TextureType::Cubemap:
-            m_dataCubemap.clear();
-            m_dataCubemap.shrink_to_fit();
-            break;
+        // Faces are never held in memory
+        case sge::Texture::TextureType::Cubemap: break;
     }
 
     m_isCPUdataPresent = false;
@@ -90,11 +235,13 @@ void Texture::clearDataOnCPU() noexcept {
 
 void Texture::setTextureImage(VkImage image) noexcept { m_textureImage = image; }
 
-void Texture::setTextureImageMemory(VkDeviceMemory imageMemory) noexcept { m_textureImageMemory = imageMemory; }
+void Texture::setTextureImageMemory(const MemoryAllocation& imageMemory) noexcept {
+    m_textureImageMemory = imageMemory;
+}
 
 VkImage Texture::getTextureImage() noexcept { return m_textureImage; }
 
-VkDeviceMemory Texture::getTextureImageMemory() noexcept { return m_textureImageMemory; }
+MemoryAllocation& Texture::getTextureImageMemory() noexcept { return m_textureImageMemory; }
 
 VkImageView Texture::getImageView() noexcept { return m_imageView; }
 
@@ -106,11 +253,6 @@ bool Texture::isProcessed() const noexcept {
     return (m_sampler != nullptr) && (m_imageView != nullptr) && (m_textureImage != nullptr);
 }
 
-std::array<void*, 6> Texture::getCubemapData() const noexcept {
-    assert(m_textureType == TextureType::Cubemap);
-    return m_cubemapData;
-}
-
 const Texture::TextureType Texture::getTextureType() const noexcept { return m_textureType; }
 
 VkDescriptorImageInfo Texture::getDescriptorInfo() const noexcept {
@@ -0,0 +1,455 @@
+#include "TextureCache.h"
+
+#include "Hash.h"
+#include "Logger.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace sge {
+namespace {
+constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos data format descriptor values for the block formats written here
+constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+constexpr uint32_t KHR_DF_CHANNEL_RED = 0;
+constexpr uint32_t KHR_DF_CHANNEL_GREEN = 1;
+constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+//! RGBA8 mip level
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+uint8_t toUnorm8(float value) noexcept { return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f); }
+
+float srgbToLinear(uint8_t value) noexcept {
+    static const auto table = [] {
+        std::array<float, 256> result{};
+        for (size_t i = 0; i < result.size(); ++i) {
+            const float c = static_cast<float>(i) / 255.f;
+            result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table[value];
+}
+
+uint8_t linearToSrgb(float value) noexcept {
+    value = std::clamp(value, 0.f, 1.f);
+    return toUnorm8(value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f);
+}
+
+Image downsample(const Image& src, Texture::Role role) {
+    Image dst{.width = std::max(src.width / 2, 1u), .height = std::max(src.height / 2, 1u)};
+    dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+    TextureCache::downsample(src.pixels.data(), src.width, src.height, dst.pixels.data(), role);
+    return dst;
+}
+
+//! 4x4 texels starting at the block, clamped at the right and bottom edges
+void fetchBlock(const Image& image, uint32_t blockX, uint32_t blockY, uint8_t block[64]) noexcept {
+    for (uint32_t i = 0; i < 16; ++i) {
+        const uint32_t x = std::min(blockX * 4 + i % 4, image.width - 1);
+        const uint32_t y = std::min(blockY * 4 + i / 4, image.height - 1);
+        std::memcpy(block + i * 4, image.pixels.data() + (static_cast<size_t>(y) * image.width + x) * 4, 4);
+    }
+}
+
+uint16_t packRgb565(const float color[3]) noexcept {
+    const auto r = static_cast<uint16_t>(std::clamp(color[0], 0.f, 255.f) * 31.f / 255.f + 0.5f);
+    const auto g = static_cast<uint16_t>(std::clamp(color[1], 0.f, 255.f) * 63.f / 255.f + 0.5f);
+    const auto b = static_cast<uint16_t>(std::clamp(color[2], 0.f, 255.f) * 31.f / 255.f + 0.5f);
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+void unpackRgb565(uint16_t packed, float color[3]) noexcept {
+    const uint32_t r = packed >> 11 & 31;
+    const uint32_t g = packed >> 5 & 63;
+    const uint32_t b = packed & 31;
+    color[0] = static_cast<float>(r << 3 | r >> 2);
+    color[1] = static_cast<float>(g << 2 | g >> 4);
+    color[2] = static_cast<float>(b << 3 | b >> 2);
+}
+
+//! Endpoints at the ends of the principal axis of the block colors, always in the four color mode
+void encodeBc1(const uint8_t block[64], uint8_t out[8]) noexcept {
+    float mean[3] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+        for (size_t c = 0; c < 3; ++c) mean[c] += block[i * 4 + c] / 16.f;
+
+    // xx, xy, xz, yy, yz, zz
+    float covariance[6] = {};
+    for (uint32_t i = 0; i < 16; ++i) {
+        const float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2]};
+        covariance[0] += d[0] * d[0];
+        covariance[1] += d[0] * d[1];
+        covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1];
+        covariance[4] += d[1] * d[2];
+        covariance[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.f, 1.f, 1.f};
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        const float next[3] = {covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                               covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                               covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+        const float length = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+        if (length < 1e-6f) break;
+        for (size_t c = 0; c < 3; ++c) axis[c] = next[c] / length;
+    }
+
+    float minProjection = FLT_MAX;
+    float maxProjection = -FLT_MAX;
+    for (uint32_t i = 0; i < 16; ++i) {
+        float projection = 0.f;
+        for (size_t c = 0; c < 3; ++c) projection += (block[i * 4 + c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    // Pulled in by 1/16 of the range, the outermost texels rarely sit exactly on the axis
+    const float inset = (maxProjection - minProjection) / 16.f;
+    float endpoints[2][3];
+    for (size_t c = 0; c < 3; ++c) {
+        endpoints[0][c] = mean[c] + axis[c] * (maxProjection - inset);
+        endpoints[1][c] = mean[c] + axis[c] * (minProjection + inset);
+    }
+
+    uint16_t color0 = packRgb565(endpoints[0]);
+    uint16_t color1 = packRgb565(endpoints[1]);
+    if (color0 < color1) std::swap(color0, color1);
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        float palette[4][3];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for (size_t c = 0; c < 3; ++c) {
+            palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+            palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+        }
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t best = 0;
+            float bestDistance = FLT_MAX;
+            for (uint32_t p = 0; p < 4; ++p) {
+                float distance = 0.f;
+                for (size_t c = 0; c < 3; ++c) {
+                    const float d = block[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    for (size_t i = 0; i < 4; ++i) out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+//! One channel of the block in the eight value mode, as used by the BC3 alpha and both BC5 channels
+void encodeBc4(const uint8_t block[64], size_t channel, uint8_t out[8]) noexcept {
+    uint8_t minValue = 255;
+    uint8_t maxValue = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        minValue = std::min(minValue, block[i * 4 + channel]);
+        maxValue = std::max(maxValue, block[i * 4 + channel]);
+    }
+    uint64_t indices = 0;
+    if (maxValue > minValue) {
+        const float range = static_cast<float>(maxValue - minValue);
+        for (uint32_t i = 0; i < 16; ++i) {
+            // Steps run from maxValue to minValue, the two endpoints own indices 0 and 1
+            const auto step = static_cast<uint64_t>(std::lround((maxValue - block[i * 4 + channel]) / range * 7.f));
+            const uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            indices |= index << (3 * i);
+        }
+    }
+    out[0] = maxValue;
+    out[1] = minValue;
+    for (size_t i = 0; i < 6; ++i) out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+std::vector<uint8_t> encodeLevel(const Image& image, VkFormat format) {
+    const uint32_t blocksX = (image.width + 3) / 4;
+    const uint32_t blocksY = (image.height + 3) / 4;
+    const uint32_t blockSize = CompressedImage::getBlockSize(format);
+    std::vector<uint8_t> data(static_cast<size_t>(blocksX) * blocksY * blockSize);
+    uint8_t* out = data.data();
+    uint8_t block[64];
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY) {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX, out += blockSize) {
+            fetchBlock(image, blockX, blockY, block);
+            switch (format) {
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                    encodeBc4(block, 3, out);
+                    encodeBc1(block, out + 8);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    encodeBc4(block, 0, out);
+                    encodeBc4(block, 1, out + 8);
+                    break;
+                default: encodeBc1(block, out); break;
+            }
+        }
+    }
+    return data;
+}
+
+std::vector<uint32_t> makeDataFormatDescriptor(VkFormat format) {
+    struct Sample {
+        uint32_t bitOffset;
+        uint32_t channel;
+    };
+    uint32_t colorModel = KHR_DF_MODEL_BC1A;
+    uint32_t transfer = KHR_DF_TRANSFER_LINEAR;
+    std::vector<Sample> samples;
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            transfer = KHR_DF_TRANSFER_SRGB;
+            samples = {{0, KHR_DF_CHANNEL_RED}};
+            break;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC3;
+            transfer = KHR_DF_TRANSFER_SRGB;
+            samples = {{0, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_DATATYPE_LINEAR}, {64, KHR_DF_CHANNEL_RED}};
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            colorModel = KHR_DF_MODEL_BC5;
+            samples = {{0, KHR_DF_CHANNEL_RED}, {64, KHR_DF_CHANNEL_GREEN}};
+            break;
+        default: samples = {{0, KHR_DF_CHANNEL_RED}}; break;
+    }
+    const auto blockSize = static_cast<uint32_t>(24 + 16 * samples.size());
+    std::vector<uint32_t> words = {4 + blockSize,
+                                   0,
+                                   2 | blockSize << 16,
+                                   colorModel | KHR_DF_PRIMARIES_BT709 << 8 | transfer << 16,
+                                   3 | 3 << 8,
+                                   CompressedImage::getBlockSize(format),
+                                   0};
+    for (const auto& sample : samples) {
+        words.push_back(sample.bitOffset | 63 << 16 | sample.channel << 24);
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(0xFFFFFFFF);
+    }
+    return words;
+}
+
+VkFormat chooseFormat(const Image& image, Texture::Role role) noexcept {
+    switch (role) {
+        case Texture::Role::Normal: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case Texture::Role::Data: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case Texture::Role::Color: break;
+    }
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+        if (image.pixels[i] != 255) return VK_FORMAT_BC3_SRGB_BLOCK;
+    return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+}
+
+void append(std::vector<uint8_t>& file, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    file.insert(file.end(), bytes, bytes + size);
+}
+}  // namespace
+
+TextureCache::TextureCache(const std::filesystem::path& sourcePath, Texture::Role role,
+                           std::filesystem::path cacheDirectory) noexcept
+    : m_sourcePath(sourcePath), m_role(role) {
+    // Looked up for every texture load, so the source is only stat'ed. Editing it changes its size or time and
+    // with them the key, the previous bake is simply not found anymore
+    std::error_code ec;
+    const auto absolutePath = std::filesystem::absolute(sourcePath, ec);
+    if (ec) return;
+    const uint64_t size = std::filesystem::file_size(absolutePath, ec);
+    if (ec) return;
+    const auto modifiedTime = std::filesystem::last_write_time(absolutePath, ec);
+    if (ec) return;
+
+    uint64_t hash = hashString(absolutePath.generic_string());
+    hash = hashValue(size, hash);
+    hash = hashValue(modifiedTime.time_since_epoch().count(), hash);
+    hash = hashValue(role, hash);
+    hash = hashValue(VERSION, hash);
+
+    std::stringstream fileName;
+    fileName << std::hex << hash << ".ktx2";
+    m_cachePath = std::move(cacheDirectory) / fileName.str();
+    m_isValid = true;
+}
+
+bool TextureCache::isValid() const noexcept { return m_isValid; }
+
+bool TextureCache::isBaked() const noexcept {
+    std::error_code ec;
+    return m_isValid && std::filesystem::exists(m_cachePath, ec);
+}
+
+const std::filesystem::path& TextureCache::getCachePath() const noexcept { return m_cachePath; }
+
+bool TextureCache::bake() const noexcept {
+    if (!m_isValid) return false;
+
+    int width;
+    int height;
+    int channels;
+    stbi_set_flip_vertically_on_load_thread(false);
+    stbi_uc* pixels = stbi_load(reinterpret_cast<const char*>(m_sourcePath.u8string().c_str()), &width, &height,
+                                &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        LOG_ERROR("Texture cache: can't decode " << m_sourcePath.string())
+        return false;
+    }
+    Image level{.width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height)};
+    level.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    const VkFormat format = chooseFormat(level, m_role);
+    std::vector<std::vector<uint8_t>> levels;
+    while (true) {
+        levels.push_back(encodeLevel(level, format));
+        if (level.width == 1 && level.height == 1) break;
+        level = downsample(level, m_role);
+    }
+
+    const auto dataFormatDescriptor = makeDataFormatDescriptor(format);
+    const size_t levelIndexOffset = sizeof(Ktx2Header);
+    const size_t dfdOffset = levelIndexOffset + sizeof(Ktx2Level) * levels.size();
+    const size_t dfdSize = dataFormatDescriptor.size() * sizeof(uint32_t);
+    Ktx2Header header{.vkFormat = static_cast<uint32_t>(format),
+                      .typeSize = 1,
+                      .pixelWidth = static_cast<uint32_t>(width),
+                      .pixelHeight = static_cast<uint32_t>(height),
+                      .pixelDepth = 0,
+                      .layerCount = 0,
+                      .faceCount = 1,
+                      .levelCount = static_cast<uint32_t>(levels.size()),
+                      .supercompressionScheme = 0,
+                      .dfdByteOffset = static_cast<uint32_t>(dfdOffset),
+                      .dfdByteLength = static_cast<uint32_t>(dfdSize),
+                      .kvdByteOffset = 0,
+                      .kvdByteLength = 0,
+                      .sgdByteOffset = 0,
+                      .sgdByteLength = 0};
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+    std::vector<uint8_t> file;
+    append(file, &header, sizeof(header));
+    file.resize(dfdOffset);
+    append(file, dataFormatDescriptor.data(), dfdSize);
+    // KTX2 stores the smallest level first, every level aligned to the block size
+    const size_t alignment = CompressedImage::getBlockSize(format);
+    for (size_t i = levels.size(); i-- > 0;) {
+        file.resize((file.size() + alignment - 1) / alignment * alignment);
+        const Ktx2Level levelIndex{.byteOffset = file.size(),
+                                   .byteLength = levels[i].size(),
+                                   .uncompressedByteLength = levels[i].size()};
+        std::memcpy(file.data() + levelIndexOffset + sizeof(Ktx2Level) * i, &levelIndex, sizeof(levelIndex));
+        append(file, levels[i].data(), levels[i].size());
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_cachePath.parent_path(), ec);
+    // Written under a unique name and renamed, so a running app never maps a partial file
+    std::stringstream tempName;
+    tempName << m_cachePath.filename().string() << "." << std::this_thread::get_id() << ".tmp";
+    const auto tempPath = m_cachePath.parent_path() / tempName.str();
+    {
+        std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (!output.good()) {
+            LOG_ERROR("Texture cache: failed to write file " << tempPath.string())
+            output.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, m_cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+/*static*/ void TextureCache::downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst,
+                                         Texture::Role role) noexcept {
+    const uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+    const uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            float sum[4] = {};
+            for (uint32_t i = 0; i < 4; ++i) {
+                const uint32_t srcX = std::min(2 * x + (i & 1), srcWidth - 1);
+                const uint32_t srcY = std::min(2 * y + (i >> 1), srcHeight - 1);
+                const uint8_t* texel = src + (static_cast<size_t>(srcY) * srcWidth + srcX) * 4;
+                for (size_t c = 0; c < 4; ++c)
+                    sum[c] += role == Texture::Role::Color && c < 3 ? srgbToLinear(texel[c]) : texel[c] / 255.f;
+            }
+            for (float& value : sum) value /= 4.f;
+
+            if (role == Texture::Role::Normal) {
+                float n[3] = {sum[0] * 2.f - 1.f, sum[1] * 2.f - 1.f, sum[2] * 2.f - 1.f};
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length > 1e-6f) {
+                    for (float& value : n) value /= length;
+                } else {
+                    n[0] = n[1] = 0.f;
+                    n[2] = 1.f;
+                }
+                for (size_t c = 0; c < 3; ++c) sum[c] = n[c] * 0.5f + 0.5f;
+            }
+            for (size_t c = 0; c < 4; ++c)
+                *dst++ = role == Texture::Role::Color && c < 3 ? linearToSrgb(sum[c]) : toUnorm8(sum[c]);
+        }
+    }
+}
+}  // namespace sge
@@ -0,0 +1,45 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace sge {
+static thread_local bool isPoolWorker = false;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) m_workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (auto& worker : m_workers) worker.join();
+}
+
+/*static*/ ThreadPool& ThreadPool::Instance() noexcept {
+    static ThreadPool threadPool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return threadPool;
+}
+
+/*static*/ bool ThreadPool::isWorkerThread() noexcept { return isPoolWorker; }
+
+size_t ThreadPool::size() const noexcept { return m_workers.size(); }
+
+void ThreadPool::workerLoop() noexcept {
+    isPoolWorker = true;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+}  // namespace sge
@@ -0,0 +1,42 @@
+#include "UniformRing.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace sge {
+UniformRing::UniformRing(Device& device, uint32_t frameCount, VkDeviceSize frameSize)
+    : m_alignment(std::max<VkDeviceSize>(device.getPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment,
+                                         1)),
+      m_frameSize((frameSize + m_alignment - 1) / m_alignment * m_alignment),
+      m_frameCount(frameCount) {
+    // Coherent memory, so nothing has to be flushed between push() and the submit
+    m_buffer = std::make_unique<Buffer>(device, m_frameSize, m_frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_buffer->map();
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) noexcept {
+    assert(frameIndex < m_frameCount && "Frame index is out of the ring");
+    m_frameBegin = m_frameSize * frameIndex;
+    m_head = m_frameBegin;
+}
+
+uint32_t UniformRing::push(const void* data, VkDeviceSize size) {
+    if (m_head + size > m_frameBegin + m_frameSize) {
+        LOG_ERROR("UniformRing: frame region of " << m_frameSize << " bytes is exhausted")
+        assert(false);
+        m_head = m_frameBegin;
+    }
+    const VkDeviceSize offset = m_head;
+    std::memcpy(static_cast<char*>(m_buffer->getMappedMemory()) + offset, data, size);
+    m_head += (size + m_alignment - 1) / m_alignment * m_alignment;
+    return static_cast<uint32_t>(offset);
+}
+
+VkDescriptorBufferInfo UniformRing::descriptorInfo(VkDeviceSize range) const {
+    return VkDescriptorBufferInfo{.buffer = m_buffer->getBuffer(), .offset = 0, .range = range};
+}
+}  // namespace sge
@@ -0,0 +1,415 @@
+#include "UploadContext.h"
+
+#include "Logger.h"
+#include "VulkanHelpUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+namespace sge {
+namespace {
+VkCommandPool createCommandPool(const Device& device, const uint32_t queueFamily) {
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VkCommandPool commandPool;
+    auto result = vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool);
+    VK_CHECK_RESULT(result, "UploadContext: failed to create command pool")
+    return commandPool;
+}
+
+VkCommandBuffer allocateCommandBuffer(const Device& device, const VkCommandPool commandPool) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer;
+    auto result = vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer);
+    VK_CHECK_RESULT(result, "UploadContext: failed to allocate command buffer")
+    return commandBuffer;
+}
+
+void beginCommandBuffer(const VkCommandBuffer commandBuffer) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    VK_CHECK_RESULT(result, "UploadContext: failed to begin command buffer")
+}
+
+constexpr VkAccessFlags UPLOAD_READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                             VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+constexpr VkPipelineStageFlags UPLOAD_READ_STAGES =
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+}  // namespace
+
+UploadContext::UploadContext(Device& device) : m_device(device) {
+    const auto queueFamilies = m_device.findPhysicalQueueFamilies();
+    m_graphicsFamily = queueFamilies.graphicsFamily;
+    m_dedicatedTransfer = m_device.hasDedicatedTransferQueue() && queueFamilies.transferFamilyHasValue;
+    m_transferFamily = m_dedicatedTransfer ? queueFamilies.transferFamily : m_graphicsFamily;
+    m_commandPool = createCommandPool(m_device, m_transferFamily);
+    if (m_dedicatedTransfer) m_acquireCommandPool = createCommandPool(m_device, m_graphicsFamily);
+}
+
+UploadContext::~UploadContext() {
+    flush();
+    for (auto& batch : m_freeBatches) {
+        vkDestroyFence(m_device.device(), batch.fence, nullptr);
+        if (batch.transferDone != VK_NULL_HANDLE) vkDestroySemaphore(m_device.device(), batch.transferDone, nullptr);
+    }
+    vkDestroyCommandPool(m_device.device(), m_commandPool, nullptr);
+    if (m_acquireCommandPool != VK_NULL_HANDLE) vkDestroyCommandPool(m_device.device(), m_acquireCommandPool, nullptr);
+}
+
+UploadContext::Batch& UploadContext::getRecordingBatch() {
+    if (m_recordingBatch) return *m_recordingBatch;
+
+    releaseFinishedBatches(false);
+    if (!m_freeBatches.empty()) {
+        m_recordingBatch = std::move(m_freeBatches.back());
+        m_freeBatches.pop_back();
+        vkResetCommandBuffer(m_recordingBatch->commandBuffer, 0);
+        if (m_dedicatedTransfer) vkResetCommandBuffer(m_recordingBatch->acquireCommandBuffer, 0);
+        vkResetFences(m_device.device(), 1, &m_recordingBatch->fence);
+    } else {
+        m_recordingBatch.emplace();
+        m_recordingBatch->commandBuffer = allocateCommandBuffer(m_device, m_commandPool);
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        auto result = vkCreateFence(m_device.device(), &fenceInfo, nullptr, &m_recordingBatch->fence);
+        VK_CHECK_RESULT(result, "UploadContext: failed to create fence")
+
+        if (m_dedicatedTransfer) {
+            m_recordingBatch->acquireCommandBuffer = allocateCommandBuffer(m_device, m_acquireCommandPool);
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            result = vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_recordingBatch->transferDone);
+            VK_CHECK_RESULT(result, "UploadContext: failed to create semaphore")
+        }
+    }
+    beginCommandBuffer(m_recordingBatch->commandBuffer);
+    return *m_recordingBatch;
+}
+
+VkCommandBuffer UploadContext::getCommandBuffer() { return getRecordingBatch().commandBuffer; }
+
+Buffer& UploadContext::createStagingBuffer(const VkDeviceSize size) {
+    // Commands recorded so far are complete uploads, so this is a safe point to cut the batch
+    if (m_recordingBatch && m_recordingBatch->stagingSize + size > MAX_BATCH_STAGING_SIZE) submit();
+
+    auto& batch = getRecordingBatch();
+    auto& stagingBuffer = batch.stagingBuffers.emplace_back(std::make_unique<Buffer>(
+        m_device, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    stagingBuffer->map();
+    batch.stagingSize += size;
+    return *stagingBuffer;
+}
+
+void UploadContext::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset) {
+    auto& batch = getRecordingBatch();
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+    if (m_dedicatedTransfer) {
+        VkBufferMemoryBarrier transfer{};
+        transfer.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        transfer.srcQueueFamilyIndex = m_transferFamily;
+        transfer.dstQueueFamilyIndex = m_graphicsFamily;
+        transfer.buffer = dstBuffer;
+        transfer.offset = dstOffset;
+        transfer.size = size;
+        batch.bufferTransfers.push_back(transfer);
+    }
+}
+
+void UploadContext::copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
+                                      uint32_t layerCount) {
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = layerCount;
+
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+
+    vkCmdCopyBufferToImage(getCommandBuffer(), srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void UploadContext::copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage,
+                                      const std::vector<VkBufferImageCopy>& regions) {
+    vkCmdCopyBufferToImage(getCommandBuffer(), srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void UploadContext::transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                          uint32_t layerCount, uint32_t mipLevels) {
+    auto& batch = getRecordingBatch();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+
+    VkPipelineStageFlags sourceStage;
+    VkPipelineStageFlags destinationStage;
+
+    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+               newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        // The fragment shader stage doesn't exist on a transfer queue, the graphics queue does this transition
+        // as part of acquiring the image
+        if (m_dedicatedTransfer) {
+            barrier.srcQueueFamilyIndex = m_transferFamily;
+            barrier.dstQueueFamilyIndex = m_graphicsFamily;
+            batch.imageTransfers.push_back(barrier);
+            return;
+        }
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else {
+        LOG_ERROR("unsupported layout transition!");
+        assert(false);
+        return;
+    }
+
+    vkCmdPipelineBarrier(batch.commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadContext::generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+                                    uint32_t layerCount) {
+    auto& batch = getRecordingBatch();
+    const MipChain chain{
+        .image = image, .width = width, .height = height, .mipLevels = mipLevels, .layerCount = layerCount};
+    if (!m_dedicatedTransfer) {
+        recordMipChain(batch.commandBuffer, chain);
+        return;
+    }
+
+    // Ownership moves with the image still in TRANSFER_DST, the graphics queue blits and finishes the transition
+    VkImageMemoryBarrier transfer{};
+    transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    transfer.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    transfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    transfer.srcQueueFamilyIndex = m_transferFamily;
+    transfer.dstQueueFamilyIndex = m_graphicsFamily;
+    transfer.image = image;
+    transfer.subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                 .baseMipLevel = 0,
+                                 .levelCount = mipLevels,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = layerCount};
+    batch.imageTransfers.push_back(transfer);
+    batch.mipChains.push_back(chain);
+}
+
+/*static*/ void UploadContext::recordMipChain(VkCommandBuffer commandBuffer, const MipChain& chain) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = chain.image;
+    barrier.subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                .baseMipLevel = 0,
+                                .levelCount = 1,
+                                .baseArrayLayer = 0,
+                                .layerCount = chain.layerCount};
+
+    auto width = static_cast<int32_t>(chain.width);
+    auto height = static_cast<int32_t>(chain.height);
+    for (uint32_t level = 1; level < chain.mipLevels; ++level) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barrier);
+
+        const int32_t nextWidth = std::max(width / 2, 1);
+        const int32_t nextHeight = std::max(height / 2, 1);
+        VkImageBlit blit{};
+        blit.srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                               .mipLevel = level - 1,
+                               .baseArrayLayer = 0,
+                               .layerCount = chain.layerCount};
+        blit.srcOffsets[1] = {width, height, 1};
+        blit.dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                               .mipLevel = level,
+                               .baseArrayLayer = 0,
+                               .layerCount = chain.layerCount};
+        blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+        vkCmdBlitImage(commandBuffer, chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, chain.image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    barrier.subresourceRange.baseMipLevel = chain.mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadContext::submit() {
+    if (!m_recordingBatch) return;
+    Batch batch = std::move(*m_recordingBatch);
+    m_recordingBatch.reset();
+
+    if (m_dedicatedTransfer) {
+        submitOwnershipTransfer(batch);
+        m_submittedBatches.push_back(std::move(batch));
+        return;
+    }
+
+    // Buffer copies become visible to every later submission on the queue, frames included
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, UPLOAD_READ_STAGES, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+    auto result = vkEndCommandBuffer(batch.commandBuffer);
+    VK_CHECK_RESULT(result, "UploadContext: failed to end command buffer")
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    {
+        std::scoped_lock lock(m_device.queueMutex());
+        result = vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, batch.fence);
+        VK_CHECK_RESULT(result, "UploadContext: failed to submit")
+    }
+    m_submittedBatches.push_back(std::move(batch));
+}
+
+// Release on the transfer queue, then acquire on the graphics queue once the semaphore signals.
+// Both halves carry identical barriers, only the access masks differ.
+void UploadContext::submitOwnershipTransfer(Batch& batch) {
+    for (auto& transfer : batch.bufferTransfers) {
+        transfer.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        transfer.dstAccessMask = 0;
+    }
+    for (auto& transfer : batch.imageTransfers) {
+        transfer.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        transfer.dstAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, static_cast<uint32_t>(batch.bufferTransfers.size()),
+                         batch.bufferTransfers.data(), static_cast<uint32_t>(batch.imageTransfers.size()),
+                         batch.imageTransfers.data());
+    auto result = vkEndCommandBuffer(batch.commandBuffer);
+    VK_CHECK_RESULT(result, "UploadContext: failed to end command buffer")
+
+    VkSubmitInfo transferSubmit{};
+    transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmit.commandBufferCount = 1;
+    transferSubmit.pCommandBuffers = &batch.commandBuffer;
+    transferSubmit.signalSemaphoreCount = 1;
+    transferSubmit.pSignalSemaphores = &batch.transferDone;
+    {
+        std::scoped_lock lock(m_device.transferQueueMutex());
+        result = vkQueueSubmit(m_device.transferQueue(), 1, &transferSubmit, VK_NULL_HANDLE);
+        VK_CHECK_RESULT(result, "UploadContext: failed to submit to the transfer queue")
+    }
+
+    beginCommandBuffer(batch.acquireCommandBuffer);
+    for (auto& transfer : batch.bufferTransfers) {
+        transfer.srcAccessMask = 0;
+        transfer.dstAccessMask = UPLOAD_READ_ACCESS;
+    }
+    for (auto& transfer : batch.imageTransfers) {
+        transfer.srcAccessMask = 0;
+        // Images still in TRANSFER_DST get their mip chain blitted right below
+        transfer.dstAccessMask = transfer.newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ?
+                                     VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT :
+                                     VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(batch.acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         UPLOAD_READ_STAGES | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(batch.bufferTransfers.size()), batch.bufferTransfers.data(),
+                         static_cast<uint32_t>(batch.imageTransfers.size()), batch.imageTransfers.data());
+    for (const auto& chain : batch.mipChains) recordMipChain(batch.acquireCommandBuffer, chain);
+    result = vkEndCommandBuffer(batch.acquireCommandBuffer);
+    VK_CHECK_RESULT(result, "UploadContext: failed to end command buffer")
+    batch.bufferTransfers.clear();
+    batch.imageTransfers.clear();
+    batch.mipChains.clear();
+
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo acquireSubmit{};
+    acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireSubmit.waitSemaphoreCount = 1;
+    acquireSubmit.pWaitSemaphores = &batch.transferDone;
+    acquireSubmit.pWaitDstStageMask = &waitStage;
+    acquireSubmit.commandBufferCount = 1;
+    acquireSubmit.pCommandBuffers = &batch.acquireCommandBuffer;
+    {
+        std::scoped_lock lock(m_device.queueMutex());
+        result = vkQueueSubmit(m_device.graphicsQueue(), 1, &acquireSubmit, batch.fence);
+        VK_CHECK_RESULT(result, "UploadContext: failed to submit the ownership acquire")
+    }
+}
+
+void UploadContext::flush() {
+    submit();
+    releaseFinishedBatches(true);
+}
+
+void UploadContext::releaseFinishedBatches(const bool wait) {
+    for (auto it = m_submittedBatches.begin(); it != m_submittedBatches.end();) {
+        const VkResult status =
+            wait ? vkWaitForFences(m_device.device(), 1, &it->fence, VK_TRUE, UINT64_MAX)
+                 : vkGetFenceStatus(m_device.device(), it->fence);
+        if (status != VK_SUCCESS) {
+            ++it;
+            continue;
+        }
+        it->stagingBuffers.clear();
+        it->stagingSize = 0;
+        m_freeBatches.push_back(std::move(*it));
+        it = m_submittedBatches.erase(it);
+    }
+}
+}  // namespace sge
@@ -69,6 +69,13 @@ void Window::init() noexcept {
         data.m_eventCallback(event);
     });
 
+    glfwSetDropCallback(m_pWindow, [](GLFWwindow* pWindow, int count, const char** paths) {
+        Window& data = *static_cast<Window*>(glfwGetWindowUserPointer(pWindow));
+
+        EventFileDrop event(std::vector<std::string>(paths, paths + count));
+        data.m_eventCallback(event);
+    });
+
     glfwSetWindowSizeCallback(m_pWindow, [](GLFWwindow* pWindow, int width, int height) {
         Window& data = *static_cast<Window*>(glfwGetWindowUserPointer(pWindow));
         data.m_width = width;
@@ -1,5 +1,8 @@
 //
 #version 450
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout (location = 0) in vec3 worldPos_in;
 layout (location = 1) in vec3 norm_in;
@@ -8,7 +11,15 @@ layout (location = 3) in vec2 texCoords_in;
 
 layout (location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 1) uniform MeshUbo
+layout(push_constant) uniform MeshPushConstants
+{
+	vec4 positionScale;
+	vec4 positionOffset;
+	vec4 lodDebugColor;
+	uint objectIndex;
+} meshPC;
+
+struct ObjectData
 {
 	mat4 modelMatrix;
 	mat3 normalMatrix;
@@ -16,7 +27,18 @@ layout(set = 0, binding = 1) uniform MeshUbo
 	vec4 lightDirection;
 	float metallic;
 	float roughness;
-} localUBO;
+	uint baseColorTexture;
+	uint metallicRoughnessTexture;
+	uint normalTexture;
+	uint emissiveTexture;
+	uint occlusionTexture;
+	uint materialFlags;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
 layout(set = 0, binding = 100) uniform DebugUBO
 {
 	uint outType;
@@ -26,20 +48,74 @@ const float M_PI = 3.141592653589793;
 const vec3 lightPoint = vec3(1.f, -2.f, 1.f);
 const float gamma = 2.2f;
 const float scaleIBL = 1.f;
-#ifdef HAS_COLOR_MAP
-	layout(set = 0, binding = 2) uniform sampler2D baseColorSampler;
+#if defined(MATERIAL_SPECIALIZATION) || defined(MATERIAL_DYNAMIC)
+	// One shader for every material: all maps are bound, missing ones to the default textures, and the flags
+	// below pick the code paths
+	#define HAS_COLOR_MAP
+	#define HAS_METALLIC_ROUGHNESS_MAP
+	#define HAS_NORMAL_MAP
+	#define HAS_EMISSIVE_MAP
+	#define HAS_OCCLUSION_MAP
 #endif
+#ifdef BINDLESS
+	// Every map is present, missing ones point at the default textures in the first slots of the array
+	#define HAS_COLOR_MAP
+	#define HAS_METALLIC_ROUGHNESS_MAP
+	#define HAS_NORMAL_MAP
+	#define HAS_EMISSIVE_MAP
+	#define HAS_OCCLUSION_MAP
+	const uint FLAT_NORMAL_TEXTURE = 2;
+
+	layout(set = 1, binding = 0) uniform sampler2D textures[];
+	#define materialTexture(slot) textures[nonuniformEXT(objects[meshPC.objectIndex].slot)]
+	#define baseColorSampler materialTexture(baseColorTexture)
+	#define MRSampler materialTexture(metallicRoughnessTexture)
+	#define NormalSampler materialTexture(normalTexture)
+	#define EmissiveSampler materialTexture(emissiveTexture)
+	#define OcclusionSampler materialTexture(occlusionTexture)
+#else
+	#ifdef HAS_COLOR_MAP
+		layout(set = 0, binding = 2) uniform sampler2D baseColorSampler;
+	#endif
 
-#ifdef HAS_METALLIC_ROUGHNESS_MAP
-	layout(set = 0, binding = 3) uniform sampler2D MRSampler;
-#endif
+	#ifdef HAS_METALLIC_ROUGHNESS_MAP
+		layout(set = 0, binding = 3) uniform sampler2D MRSampler;
+	#endif
 
-#ifdef HAS_NORMAL_MAP
-	layout(set = 0, binding = 4) uniform sampler2D NormalSampler;
+	#ifdef HAS_NORMAL_MAP
+		layout(set = 0, binding = 4) uniform sampler2D NormalSampler;
+	#endif
+
+	#ifdef HAS_EMISSIVE_MAP
+		layout(set = 0, binding = 5) uniform sampler2D EmissiveSampler;
+	#endif
+
+	// Occlusion is packed into the red channel of the metallic-roughness map
+	#define OcclusionSampler MRSampler
 #endif
 
-#ifdef HAS_EMISSIVE_MAP
-	layout(set = 0, binding = 5) uniform sampler2D EmissiveSampler;
+#if defined(MATERIAL_SPECIALIZATION)
+	// Set per pipeline, the driver folds the branches away
+	layout(constant_id = 0) const bool hasColorMap = false;
+	layout(constant_id = 1) const bool hasMetallicRoughnessMap = false;
+	layout(constant_id = 2) const bool hasNormalMap = false;
+	layout(constant_id = 3) const bool hasEmissiveMap = false;
+	layout(constant_id = 4) const bool hasOcclusionMap = false;
+#elif defined(MATERIAL_DYNAMIC)
+	// Uniform across a draw, see MaterialFlags in ObjectBuffer.h
+	#define materialFlag(bit) ((objects[meshPC.objectIndex].materialFlags & (1u << bit)) != 0u)
+	#define hasColorMap materialFlag(0)
+	#define hasMetallicRoughnessMap materialFlag(1)
+	#define hasNormalMap materialFlag(2)
+	#define hasEmissiveMap materialFlag(3)
+	#define hasOcclusionMap materialFlag(4)
+#else
+	// The defines already left out the code of missing maps
+	const bool hasColorMap = true;
+	const bool hasMetallicRoughnessMap = true;
+	const bool hasNormalMap = true;
+	const bool hasEmissiveMap = true;
+	const bool hasOcclusionMap = true;
 #endif
 
 layout(set = 0, binding = 8) uniform samplerCube skybox;
@@ -79,23 +155,29 @@ vec3 getPointLightColor()
 vec3 getNormal()
 {
 #ifdef HAS_NORMAL_MAP
-	vec3 normalMap = texture(NormalSampler, texCoords_in).xyz * 2.0 - 1.0;
-
-	vec3 q1 = dFdx(worldPos_in);
-	vec3 q2 = dFdy(worldPos_in);
-	vec2 st1 = dFdx(texCoords_in);
-	vec2 st2 = dFdy(texCoords_in);
-
-	vec3 N = normalize(norm_in);
-	vec3 T = normalize(q1 * st2.t - q2 * st1.t);
-	vec3 B = -normalize(cross(N, T));
-	mat3 TBN = mat3(T, B, N);
-
-	vec3 n = TBN * normalMap;
-#else
-	vec3 n = norm_in;
+#ifdef BINDLESS
+	// Skips the tangent frame, it degenerates on meshes without texture coordinates
+	if (objects[meshPC.objectIndex].normalTexture == FLAT_NORMAL_TEXTURE) return normalize(norm_in);
+#endif
+	if (hasNormalMap) {
+		vec3 normalMap = texture(NormalSampler, texCoords_in).xyz * 2.0 - 1.0;
+		// BC5 normal maps only store X and Y
+		normalMap.z = sqrt(clamp(1.0 - dot(normalMap.xy, normalMap.xy), 0.0, 1.0));
+
+		vec3 q1 = dFdx(worldPos_in);
+		vec3 q2 = dFdy(worldPos_in);
+		vec2 st1 = dFdx(texCoords_in);
+		vec2 st2 = dFdy(texCoords_in);
+
+		vec3 N = normalize(norm_in);
+		vec3 T = normalize(q1 * st2.t - q2 * st1.t);
+		vec3 B = -normalize(cross(N, T));
+		mat3 TBN = mat3(T, B, N);
+
+		return normalize(TBN * normalMap);
+	}
 #endif
-	return normalize(n);
+	return normalize(norm_in);
 }
 
 vec4 SRGBtoLINEAR(vec4 srgbIn)
@@ -122,8 +204,9 @@ vec3 getIBLContribution(vec3 diffuseColor, vec3 specularColor, vec3 n, vec3 refl
 }
 
 void main() {
+	const ObjectData object = objects[meshPC.objectIndex];
                                                                                 
-	const vec3 L = normalize(localUBO.lightDirection.xyz);//normalize(lightPoint - worldPos_in);
+	const vec3 L = normalize(object.lightDirection.xyz);//normalize(lightPoint - worldPos_in);
 	const vec3 V = normalize(cameraPosition_in - worldPos_in);
 
 	const vec3 N = getNormal();
@@ -135,19 +218,19 @@ void main() {
 	const float LdotH = clamp(dot(L, H), 0.0, 1.0);
 	const float VdotH = clamp(dot(V, H), 0.0, 1.0);
 	
+	vec4 basecolor = object.baseColor;
 #ifdef HAS_COLOR_MAP
-	vec4 basecolor = localUBO.baseColor * SRGBtoLINEAR(texture(baseColorSampler, texCoords_in));
-#else
-	vec4 basecolor = localUBO.baseColor;
+	if (hasColorMap) basecolor *= SRGBtoLINEAR(texture(baseColorSampler, texCoords_in));
 #endif
 
+	float metallic = object.metallic;
+	float roughness = object.roughness;
 #ifdef HAS_METALLIC_ROUGHNESS_MAP
-	vec3 value = texture(MRSampler, texCoords_in).rgb;
-	float metallic = value.b * localUBO.metallic;
-	float roughness = value.g * localUBO.roughness;
-#else
-	float metallic = localUBO.metallic;
-	float roughness = localUBO.roughness;
+	if (hasMetallicRoughnessMap) {
+		vec3 value = texture(MRSampler, texCoords_in).rgb;
+		metallic *= value.b;
+		roughness *= value.g;
+	}
 #endif
 
 	roughness = clamp(roughness, 0.04, 1.0);
@@ -179,12 +262,16 @@ void main() {
 	color += getIBLContribution(diffuseColor, specularColor, N, reflection, NdotV, roughness);
 
 #ifdef HAS_OCCLUSION_MAP
-	float ao = texture(MRSampler, texCoords_in).r;
-	color = mix(color, color * ao, 1.f);
+	if (hasOcclusionMap) {
+		float ao = texture(OcclusionSampler, texCoords_in).r;
+		color = mix(color, color * ao, 1.f);
+	}
 #endif
 #ifdef HAS_EMISSIVE_MAP
-	vec3 emissive = SRGBtoLINEAR(texture(EmissiveSampler, texCoords_in)).rgb;
-	color += emissive;
+	if (hasEmissiveMap) {
+		vec3 emissive = SRGBtoLINEAR(texture(EmissiveSampler, texCoords_in)).rgb;
+		color += emissive;
+	}
 #endif
 	
 	outColor = vec4(color, basecolor.a);
@@ -200,39 +287,41 @@ void main() {
 	case 2:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_COLOR_MAP
-		outColor = vec4(texture(baseColorSampler, texCoords_in));
+		if (hasColorMap) outColor = vec4(texture(baseColorSampler, texCoords_in));
 #endif
 		break;
 	case 3:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_NORMAL_MAP
-		outColor = vec4(texture(NormalSampler, texCoords_in).xyz, 1.f);
+		if (hasNormalMap) outColor = vec4(texture(NormalSampler, texCoords_in).xyz, 1.f);
 #endif
 		break;
 	case 4:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_OCCLUSION_MAP
-		outColor = vec4((texture(MRSampler, texCoords_in).rrr), 1.f);
+		if (hasOcclusionMap) outColor = vec4((texture(OcclusionSampler, texCoords_in).rrr), 1.f);
 #endif
 		break;
 	case 5:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_EMISSIVE_MAP
-		outColor = vec4(texture(EmissiveSampler, texCoords_in).rgb, 1.f);
+		if (hasEmissiveMap) outColor = vec4(texture(EmissiveSampler, texCoords_in).rgb, 1.f);
 #endif
 		break;
 	case 6:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_METALLIC_ROUGHNESS_MAP
-		outColor = vec4((texture(MRSampler, texCoords_in).bbb), 1.f);
+		if (hasMetallicRoughnessMap) outColor = vec4((texture(MRSampler, texCoords_in).bbb), 1.f);
 #endif
 		break;
 	case 7:
 		outColor = vec4(1.f, 0.f, 0.f, 1.f);
 #ifdef HAS_METALLIC_ROUGHNESS_MAP
-		outColor = vec4((texture(MRSampler, texCoords_in).ggg), 1.f);
+		if (hasMetallicRoughnessMap) outColor = vec4((texture(MRSampler, texCoords_in).ggg), 1.f);
 #endif
 		break;
 	}
 	outColor.rgb = pow(outColor.rgb, vec3(1.f/gamma));
+	if (meshPC.lodDebugColor.a > 0.0)
+		outColor = vec4(mix(outColor.rgb, meshPC.lodDebugColor.rgb, meshPC.lodDebugColor.a), 1.0);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 //
 #version 450
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout (location = 0) in vec3 worldPos_in;
 layout (location = 1) in vec3 norm_in;
@@ -8,7 +11,15 @@ layout (location = 3) in vec2 texCoords_in;
 
 layout (location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 1) uniform MeshUbo
+layout(push_constant) uniform MeshPushConstants
+{
+	vec4 positionScale;
+	vec4 positionOffset;
+	vec4 lodDebugColor;
+	uint objectIndex;
+} meshPC;
+
+struct ObjectData
 {
 	mat4 modelMatrix;
 	mat3 normalMatrix;
@@ -16,19 +27,50 @@ layout(set = 0, binding = 1) uniform MeshUbo
 	vec4 lightDirection;
 	float metallic;
 	float roughness;
-} localUBO;
+	uint baseColorTexture;
+	uint metallicRoughnessTexture;
+	uint normalTexture;
+	uint emissiveTexture;
+	uint occlusionTexture;
+	uint materialFlags;
+};
 
-#ifdef HAS_COLOR_MAP
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+#if defined(MATERIAL_SPECIALIZATION) || defined(MATERIAL_DYNAMIC)
+	// One shader for every material, the color map is always bound and the flag below picks the code path
+	#define HAS_COLOR_MAP
+#endif
+#ifdef BINDLESS
+	// Meshes without a color map point at the white default texture
+	#define HAS_COLOR_MAP
+	layout(set = 1, binding = 0) uniform sampler2D textures[];
+	#define baseColorSampler textures[nonuniformEXT(objects[meshPC.objectIndex].baseColorTexture)]
+#elif defined(HAS_COLOR_MAP)
 	layout(set = 0, binding = 2) uniform sampler2D baseColorSampler;
 #endif
 
+#if defined(MATERIAL_SPECIALIZATION)
+	// Set per pipeline, the driver folds the branch away
+	layout(constant_id = 0) const bool hasColorMap = false;
+#elif defined(MATERIAL_DYNAMIC)
+	// Uniform across a draw, see MaterialFlags in ObjectBuffer.h
+	#define hasColorMap ((objects[meshPC.objectIndex].materialFlags & 1u) != 0u)
+#else
+	const bool hasColorMap = true;
+#endif
+
 const float M_PI = 3.141592653589793;
 const vec3 lightPoint = vec3(1.f,-2.f,1.f);
 const float gamma = 2.2f;
 
 void main() {
+	const ObjectData object = objects[meshPC.objectIndex];
 
-	const vec3 L = normalize(lightPoint - worldPos_in); //normalize(localUBO.lightDirection.xyz);
+	const vec3 L = normalize(lightPoint - worldPos_in); //normalize(object.lightDirection.xyz);
 	const vec3 V = normalize(cameraPosition_in - worldPos_in);
 	const vec3 N = normalize(norm_in);
      	
@@ -38,12 +80,13 @@ void main() {
 	float spec = pow(max(dot(V, reflectDir), 0.0), 32);
 	const float R = length(lightPoint - worldPos_in);
 
+	vec4 basecolor = object.baseColor;
 #ifdef HAS_COLOR_MAP
-	vec4 basecolor = localUBO.baseColor * texture(baseColorSampler, texCoords_in);
-#else
-	vec4 basecolor = localUBO.baseColor;
+	if (hasColorMap) basecolor *= texture(baseColorSampler, texCoords_in);
 #endif
 
 	vec3 Color = ((0.1f + diffuse + spec) / (R*R) * basecolor).xyz;
 	outColor = vec4(pow(Color, vec3(1.f/gamma)), 1.f);
+	if (meshPC.lodDebugColor.a > 0.0)
+		outColor = vec4(mix(outColor.rgb, meshPC.lodDebugColor.rgb, meshPC.lodDebugColor.a), 1.0);
 }
\ No newline at end of file
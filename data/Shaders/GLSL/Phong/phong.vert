@@ -1,16 +1,37 @@
 //
 #version 450
 
+#ifdef QUANTIZED_VERTEX
+layout(location = 0) in vec4 position_in;
+layout(location = 1) in vec2 normal_in;
+layout(location = 2) in vec2 texCoords_in;
+
+vec3 decodeOctahedral(vec2 e) {
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+#else
 layout(location = 0) in vec3 position_in;
 layout(location = 1) in vec3 normal_in;
 layout(location = 2) in vec2 texCoords_in;
-
+#endif
+layout(location = 3) in mat4 instanceMatrix_in;
+layout(location = 7) in mat3 instanceNormalMatrix_in;
 
 layout(location = 0) out vec3 worldPos_out;
 layout(location = 1) out vec3 norm_out;
 layout(location = 2) out vec3 cameraPosition_out;
 layout(location = 3) out vec2 texCoords_out;
 
+layout(push_constant) uniform MeshPushConstants
+{
+	vec4 positionScale;
+	vec4 positionOffset;
+	vec4 lodDebugColor;
+	uint objectIndex;
+} meshPC;
+
 layout(set = 0, binding = 0) uniform GlobalUbo
 {
 	mat4 projectionMatrix;
@@ -18,7 +39,7 @@ layout(set = 0, binding = 0) uniform GlobalUbo
 	vec3 cameraPosition;
 } globalUBO;
 
-layout(set = 0, binding = 1) uniform MeshUbo
+struct ObjectData
 {
 	mat4 modelMatrix;
 	mat3 normalMatrix;
@@ -26,13 +47,33 @@ layout(set = 0, binding = 1) uniform MeshUbo
 	vec4 lightDirection;
 	float metallic;
 	float roughness;
-} localUBO;
+	uint baseColorTexture;
+	uint metallicRoughnessTexture;
+	uint normalTexture;
+	uint emissiveTexture;
+	uint occlusionTexture;
+	uint materialFlags;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
 
 void main(){
+	const ObjectData object = objects[meshPC.objectIndex];
+#ifdef QUANTIZED_VERTEX
+	const vec3 position = position_in.xyz * meshPC.positionScale.xyz + meshPC.positionOffset.xyz;
+	const vec3 normal = decodeOctahedral(normal_in);
+#else
+	const vec3 position = position_in;
+	const vec3 normal = normal_in;
+#endif
 	float a;
-	norm_out = normalize(localUBO.normalMatrix * normal_in); //(M^-1)^T
+	const mat4 modelMatrix = object.modelMatrix * instanceMatrix_in;
+	norm_out = normalize(object.normalMatrix * instanceNormalMatrix_in * normal); //(M^-1)^T
 	cameraPosition_out = globalUBO.cameraPosition;
-	worldPos_out = vec3(localUBO.modelMatrix * vec4(position_in, 1.0));
+	worldPos_out = vec3(modelMatrix * vec4(position, 1.0));
 	texCoords_out = texCoords_in;
-	gl_Position = globalUBO.projectionMatrix * globalUBO.viewMatrix * localUBO.modelMatrix * vec4(position_in, 1.0);
+	gl_Position = globalUBO.projectionMatrix * globalUBO.viewMatrix * modelMatrix * vec4(position, 1.0);
 }
\ No newline at end of file